@@ -1,15 +1,21 @@
 #ifndef APU_HPP
 #define APU_HPP
 
-#include <pulse/simple.h>
-#include <pulse/error.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <algorithm>
+#include <memory>
 
 #include "Memory.hpp"
+#include "RingBuffer.hpp"
+#include "BlipBuffer.hpp"
+#include "AudioMixer.hpp"
+#include "audio/AudioSink.hpp"
 
 #define NR10 0xFF10 // Channel 1 Sweep Register
 #define NR11 0xFF11 // Channel 1 Sound length/Wave Pattern duty
@@ -44,12 +50,34 @@
 
 #define WAVE_RAM 0xFF30
 
+// Output sequence lengths of the noise channel's LFSR in its 15-bit and 7-bit modes.
+#define LFSR15_SEQUENCE_LENGTH 32767
+#define LFSR7_SEQUENCE_LENGTH 127
+
 #define SQUARE_WAVE_MAX_FREQUENCY_HZ 2048
 #define FRAME_SEQUENCER_FREQUENCY_HZ 512
 #define AUDIO_SAMPLING_FREQUENCY_HZ 48000
 #define CPU_FREQUENCY_HZ 4194304
 
-#define AUDIO_BUFFER_SIZE 1024
+// Sizes are in stereo sample frames, whose size in bytes depends on the
+// output's sample format (at most 2 floats).
+#define AUDIO_BUFFER_FRAMES 512
+#define AUDIO_MAX_FRAME_SIZE 8
+#define AUDIO_RING_BUFFER_SIZE (AUDIO_BUFFER_FRAMES * AUDIO_MAX_FRAME_SIZE * 16)
+
+// Dynamic rate control: the sampling rate is nudged by at most
+// AUDIO_MAX_RATE_DELTA to keep the ring around AUDIO_RING_TARGET_FILL.
+#define AUDIO_RING_TARGET_FILL (AUDIO_BUFFER_FRAMES * 4)
+#define AUDIO_MAX_RATE_DELTA 0.005
+
+// Amount of samples of each channel mixed at once.
+#define AUDIO_MIX_CHUNK_SIZE 256
+
+// Amount of channels mixed into the output.
+#define APU_CHANNEL_COUNT 4
+
+// Shortest amount of cycles between two reported edges of the noise channel.
+#define APU_NOISE_EDGE_SPACING 64
 
 #define INCREASING true
 #define DECREASING false
@@ -61,34 +89,148 @@ public:
     Apu();
     ~Apu();
 
+    // Snapshot of the channels and frame sequencer. Samples already
+    // buffered for playback are output rather than state.
+    struct State {
+        int frameSequencerTimer;
+        int frameSequencerStep;
+
+        // How far into the frame the apu is, and the level each channel
+        // last output, which the next change is recorded relative to.
+        int frameTime;
+        uBYTE channelOutput[APU_CHANNEL_COUNT];
+
+        bool ch1Disabled;
+        bool ch1SweepEnabled;
+        int ch1ShadowFrequency;
+        int ch1FrequencyTimer;
+        int ch1VolumeTimer;
+        uBYTE ch1CurrentVolume;
+        uBYTE ch1SweepTimer;
+        uBYTE ch1LengthTimer;
+        uBYTE ch1WaveDutyPointer;
+
+        bool ch2Disabled;
+        int ch2VolumeTimer;
+        int ch2FrequencyTimer;
+        uBYTE ch2LengthTimer;
+        uBYTE ch2WaveDutyPointer;
+        uBYTE ch2CurrentVolume;
+
+        bool ch3Disabled;
+        int ch3FrequencyTimer;
+        uBYTE ch3LengthTimer;
+        uBYTE ch3WavePointer;
+        uBYTE ch3SamplePointer;
+
+        bool ch4Disabled;
+        int ch4FrequencyTimer;
+        int ch4VolumeTimer;
+        int ch4LfsrPosition;
+        uBYTE ch4LengthTimer;
+        uBYTE ch4CurrentVolume;
+    };
+
     void UpdateSound(int cycles);
+    void EndFrame();
     void SetMemory(Memory* memRef);
+    void WriteRegister(uWORD addr, uBYTE data);
+    void RefreshRegisters();
+    void SetOutputFormat(AudioMixer::SampleFormat format, int sampleRate);
+    void SetAudioSink(std::unique_ptr<AudioSink> sink);
+    void SaveState(State& state);
+    void LoadState(const State& state);
+
+    void SetSyncToAudio(bool enabled);
+    bool HasAudioOutput();
+    bool HasRealTimeAudioOutput();
+    double GetRateAdjustment();
+    double GetAudioRingFill();
+    uint64_t GetUnderrunCount();
+    uint64_t GetOverrunCount();
+
+    // How many cycles the apu can be updated by, in steps of any size,
+    // without the frame sequencer ticking before the last of them.
+    inline int CyclesUntilFrameSequencerTick() {
+        return frameSequencerTimer - pendingCycles - 1;
+    }
 
 private:
     void FlushBuffer();
+    void FlusherRoutine();
+    void CatchUp();
+    void RunCycles(int cycles);
     void UpdateFrameSequencer(int cycles);
-    uBYTE ComputeChannel1Amplitude(int cycles);
-    uBYTE ComputeChannel2Amplitude(int cycles);
-    uBYTE ComputeChannel3Amplitude(int cycles);
+    void DecodeRegister(uWORD addr, uBYTE data);
+    void TriggerChannel1();
+    void TriggerChannel2();
+    void TriggerChannel3();
+    void TriggerChannel4();
+    void UpdateChannel1(int cycles);
+    void UpdateChannel2(int cycles);
+    void UpdateChannel3(int cycles);
+    void UpdateChannel4(int cycles);
+    void SetChannelOutput(int channel, uBYTE amplitude, int time);
+    void UpdateMixerGains();
 
     // Emulator specific channel toggles
     bool debuggerCh1Toggle;
     bool debuggerCh2Toggle;
+    bool debuggerCh4Toggle;
 
     Memory* memRef;
 
-    // Audio buffer flusher thread routine
-    bool flusherRunning;
+    // Audio buffer flusher thread routine. Full sample buffers are handed
+    // over through a lock-free ring, the mutex and condition variable are
+    // only used to wake up the flusher when it ran out of samples.
+    std::atomic<bool> flusherRunning;
     std::mutex flusherMtx;
     std::unique_ptr<std::thread> apuFlusher;
-    std::unique_lock<std::mutex> flusherLock;
     std::condition_variable flusherCv;
+    std::condition_variable ringSpaceCv;
+    RingBuffer audioRing;
+
+    // When synced to audio, the emulation thread waits for room in the ring
+    // instead of dropping samples, which paces it to the audio device's clock.
+    bool syncToAudio;
+
+    // Underruns: the flusher had nothing to play for a whole buffer period.
+    // Overruns: the ring was full and a buffer of samples had to be dropped.
+    std::atomic<uint64_t> underrunCount;
+    std::atomic<uint64_t> overrunCount;
 
     // Audio sample buffer variables
-    std::mutex bufferLock;
-    uBYTE audioBuffer[AUDIO_BUFFER_SIZE];
+    AudioMixer::SampleFormat sampleFormat;
+    int sampleRate;
+    int frameSize;
+    uBYTE audioBuffer[AUDIO_BUFFER_FRAMES * AUDIO_MAX_FRAME_SIZE];
     int currentSampleBufferPosition;
-    int addToBufferTimer;
+    double rateAdjustment;
+
+    // Band-limited synthesis. Channels only report their output when it
+    // changes, at the cycle within the frame at which it changed. Each
+    // channel's changes are turned into samples at the host's rate once per
+    // frame by EndFrame, and then mixed together.
+    BlipBuffer channelBuffers[APU_CHANNEL_COUNT];
+    AudioMixer mixer;
+    int frameTime;
+    uBYTE channelOutput[APU_CHANNEL_COUNT];
+
+    // Whether there is an audio output to synthesize samples for. Without
+    // one, the channels still run, as the sweep writes to NR13 and NR14.
+    bool synthesizing;
+
+    // Cycles the channels have yet to be run for, see UpdateSound, and
+    // whether a register was written to by the instruction they end with.
+    int pendingCycles;
+    bool registerWritten;
+
+    // Register values and settings decoded from them are kept up to date by
+    // WriteRegister as the cpu writes them, rather than being read back and
+    // decoded every time the channels are updated.
+    uBYTE nr50;
+    uBYTE nr51;
+    uBYTE nr52;
 
     // Frame sequencer variables
     int frameSequencerTimer;
@@ -99,6 +241,12 @@ private:
 
     // Square Channel 1 variables
     bool ch1Disabled;
+    bool ch1SweepEnabled;
+    bool ch1SweepDirection;
+    bool ch1VolumeDirection;
+    bool ch1LengthEnabled;
+    int ch1Frequency;
+    int ch1Period;
     int ch1ShadowFrequency;
     int ch1FrequencyTimer;
     int ch1VolumeTimer;
@@ -106,26 +254,62 @@ private:
     uBYTE ch1SweepTimer;
     uBYTE ch1LengthTimer;
     uBYTE ch1WaveDutyPointer;
+    uBYTE ch1WavePattern;
+    uBYTE ch1SweepPeriod;
+    uBYTE ch1SweepShift;
+    uBYTE ch1LengthPeriod;
+    uBYTE ch1VolumePeriod;
+    uBYTE ch1InitialVolume;
 
     // Square Channel 2 variables
     bool ch2Disabled;
+    bool ch2VolumeDirection;
+    bool ch2LengthEnabled;
+    int ch2Frequency;
+    int ch2Period;
     int ch2VolumeTimer;
     int ch2FrequencyTimer;
     uBYTE ch2LengthTimer;
     uBYTE ch2WaveDutyPointer;
     uBYTE ch2CurrentVolume;
+    uBYTE ch2WavePattern;
+    uBYTE ch2LengthPeriod;
+    uBYTE ch2VolumePeriod;
+    uBYTE ch2InitialVolume;
 
     // Wave RAM Channel 3 variables
     bool ch3Disabled;
+    bool ch3Enabled;
+    bool ch3LengthEnabled;
+    int ch3Frequency;
+    int ch3Period;
     int ch3FrequencyTimer;
     uBYTE ch3LengthTimer;
     uBYTE ch3WavePointer;
     uBYTE ch3SamplePointer;
+    uBYTE ch3LengthPeriod;
+    uBYTE ch3VolumeShift;
+    uBYTE ch3WaveSamples[32];
 
-#ifdef FUUGB_SYSTEM_LINUX
-    pa_simple* audioClient;
-#endif
+    // Noise Channel 4 variables
+    // Rather than clocking the LFSR, the channel keeps its position within
+    // the LFSR's precomputed output sequence.
+    bool ch4Disabled;
+    bool ch4VolumeDirection;
+    bool ch4LengthEnabled;
+    bool ch4WidthMode;
+    int ch4Period;
+    int ch4FrequencyTimer;
+    int ch4VolumeTimer;
+    int ch4LfsrPosition;
+    uBYTE ch4LengthTimer;
+    uBYTE ch4CurrentVolume;
+    uBYTE ch4LengthPeriod;
+    uBYTE ch4VolumePeriod;
+    uBYTE ch4InitialVolume;
 
+    // Destination of the mixed samples, NULL until one is attached.
+    std::unique_ptr<AudioSink> sink;
 };
 
 #endif
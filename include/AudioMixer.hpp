@@ -0,0 +1,53 @@
+#ifndef AUDIO_MIXER_HPP
+#define AUDIO_MIXER_HPP
+
+#include <stdint.h>
+#include <math.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Maximum amount of channels that can be mixed together.
+#define AUDIO_MIXER_MAX_CHANNELS 8
+
+// Cutoff of the DC-blocking filter. The channels' outputs are all positive,
+// which leaves a large, volume dependent offset in the mixed signal.
+#define AUDIO_MIXER_DC_CUTOFF_HZ 20.0
+
+// Mixes blocks of per-channel samples into a stereo stream in the
+// host's sample format. Mixing and format conversion work on several
+// samples at once with SSE2 (or AVX2, when compiled with it).
+class AudioMixer {
+
+public:
+    enum SampleFormat {
+        SAMPLE_FORMAT_S16,
+        SAMPLE_FORMAT_F32
+    };
+
+    AudioMixer();
+
+    void SetSampleRate(int sampleRate);
+    void SetGains(int channel, float left, float right);
+    void Mix(const float* const* channels, int channelCount, int count, float* left, float* right);
+    void Filter(float* left, float* right, int count);
+
+    static int FrameSize(SampleFormat format);
+    static void Interleave(const float* left, const float* right, int count, SampleFormat format, void* out);
+
+private:
+    float leftGains[AUDIO_MIXER_MAX_CHANNELS];
+    float rightGains[AUDIO_MIXER_MAX_CHANNELS];
+
+    // DC-blocking filter state: y[n] = x[n] - x[n-1] + (pole * y[n-1])
+    float pole;
+    float leftInput;
+    float leftOutput;
+    float rightInput;
+    float rightOutput;
+};
+
+#endif
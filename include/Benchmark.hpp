@@ -0,0 +1,51 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+// Timing zones used by the fuugb-bench tool, which builds the core with
+// FUUGB_BENCHMARK defined. Zones only read the timestamp counter while
+// benchmarkCounters.enabled is set, and compile to nothing in other builds.
+#ifdef FUUGB_BENCHMARK
+
+#include <stdint.h>
+#include <x86intrin.h>
+
+struct BenchmarkCounters {
+    bool enabled;
+    uint64_t instructions;
+    uint64_t cpuTicks;
+    uint64_t memoryTicks;
+    uint64_t ppuTicks;
+    uint64_t apuTicks;
+};
+
+// Defined by the benchmark tool.
+extern BenchmarkCounters benchmarkCounters;
+
+class BenchmarkZone {
+
+public:
+    BenchmarkZone(uint64_t& ticks) : ticks(ticks) {
+        start = benchmarkCounters.enabled ? __rdtsc() : 0;
+    }
+
+    ~BenchmarkZone() {
+        if (benchmarkCounters.enabled)
+            ticks += __rdtsc() - start;
+    }
+
+private:
+    uint64_t& ticks;
+    uint64_t start;
+};
+
+#define BENCHMARK_ZONE(counter) BenchmarkZone benchmarkZone(benchmarkCounters.counter)
+#define BENCHMARK_ADD(counter, amount) if (benchmarkCounters.enabled) benchmarkCounters.counter += (amount)
+
+#else
+
+#define BENCHMARK_ZONE(counter)
+#define BENCHMARK_ADD(counter, amount)
+
+#endif
+
+#endif
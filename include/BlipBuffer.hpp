@@ -0,0 +1,44 @@
+#ifndef BLIP_BUFFER_HPP
+#define BLIP_BUFFER_HPP
+
+#include <math.h>
+#include <string.h>
+
+// Width (in output samples) and sub-sample resolution of the band-limited
+// step used to synthesize amplitude changes.
+#define BLIP_KERNEL_WIDTH 16
+#define BLIP_PHASE_COUNT 64
+
+// Maximum amount of output samples that can be pending before being read.
+#define BLIP_BUFFER_CAPACITY 4096
+
+// Band-limited sound synthesis buffer.
+// Instead of sampling a waveform at the output rate (which aliases every
+// harmonic above half the sampling rate back into the audible range), the
+// waveform is described by the amplitude deltas it goes through, each at its
+// exact clock time. Every delta is added as a band-limited step, and reading
+// the buffer integrates those steps back into alias-free samples.
+class BlipBuffer {
+
+public:
+    BlipBuffer();
+    ~BlipBuffer();
+
+    void SetRates(double clockRate, double sampleRate);
+    void AddDelta(int clockTime, float delta);
+    void EndFrame(int clockDuration);
+    int SamplesAvailable();
+    int ReadSamples(float* out, int count);
+    void Clear();
+
+private:
+    float* buffer;
+    float integrator;
+
+    // Output samples per clock, and the position (in output samples)
+    // of clock time 0 of the current frame.
+    double factor;
+    double offset;
+};
+
+#endif
@@ -2,8 +2,13 @@
 #define CPU_H
 
 #include "Memory.hpp"
+#include "Profiler.hpp"
 
 #include <stdio.h>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <utility>
 
 #define Z_FLAG 7
 #define N_FLAG 6
@@ -25,6 +30,16 @@
 #define SER_TRF_INTERUPT_VECTOR 0x0058
 #define CONTROL_INTERUPT_VECTOR 0x0060
 
+// Hot instruction sequences the cpu can execute as a single one, see Cpu::Fusion.
+#define FUSION_COUNT 3
+#define FUSION_MAX_LENGTH 8
+#define FUSION_ALL ((1 << FUSION_COUNT) - 1)
+
+static_assert(FUSION_COUNT <= PROFILER_FUSION_COUNT, "fusions are enabled through a bit mask");
+
+// The longest an instruction takes, CALL with the call taken.
+#define CPU_MAX_INSTRUCTION_CYCLES 24
+
 class Cpu
 {
     friend class SideNav;
@@ -36,12 +51,49 @@ public:
     bool Halted;
     bool Paused;
 
+    // Snapshot of the architectural state of the cpu, used for
+    // saving and restoring the emulation (e.g. run-ahead).
+    struct State {
+        uWORD AF;
+        uWORD BC;
+        uWORD DE;
+        uWORD HL;
+        uWORD SP;
+        uWORD PC;
+        bool IME;
+        bool halted;
+        bool paused;
+        bool buggedHalt;
+    };
+
+    // A sequence of instructions commonly looped over, executed in one go when
+    // found in full at the program counter. Its instructions still take the same
+    // time and make the same data accesses as they would on their own; what is
+    // saved is the trip back to the emulation loop in between. Operand bytes are -1 in
+    // the pattern, and cycles is the total with the closing jump taken.
+    struct Fusion {
+        const char* name;
+        int length;
+        int pattern[FUSION_MAX_LENGTH];
+        int cycles;
+        int (Cpu::*execute)();
+    };
+
     void Pause();
-    void CheckInterupts();
+    bool CheckInterupts();
     void Halt();
     void SetMemory(Memory* memory);
-    int ExecuteNextOpCode();
+    void SetProfiler(Profiler* profiler);
+    int Execute(int budget = 0);
+    void EndBatch();
+    void SetFusions(unsigned int enabled);
+    void SetBatchWindowHook(std::function<int()> hook);
+    uint64_t TakeExecutedInstructions();
+    static int FindFusion(const std::string& name);
+    static const char* FusionName(int fusion);
     void SetPostBootRomState();
+    void SaveState(State& state);
+    void LoadState(const State& state);
 
     enum opCode {
         NOP = 0x00,             //No instruction
@@ -604,6 +656,100 @@ private:
     Memory* memoryUnit;
     uBYTE byte;
 
+    // Only recorded into by builds made with FUUGB_PROFILE defined.
+    Profiler* profiler;
+
+    static const Fusion fusions[FUSION_COUNT];
+
+    // For every opcode, the enabled fusions starting with it, one bit each.
+    unsigned int fusionHeads[0x100];
+
+    // Instructions executed, fused ones included, since the last take.
+    uint64_t executedInstructions;
+
+    // Cycles the batch being executed may have taken and still start
+    // another instruction, see Execute. The window is the budget lowered
+    // to what the hook allows, -1 until it is needed.
+    int batchBudget;
+    int batchWindow;
+
+    // Asked, once a batch is to go past its first instruction, for how
+    // many cycles the rest of the machine can go without an update in
+    // between instructions.
+    std::function<int()> batchWindowHook;
+
+#ifdef FUUGB_PROFILE
+    unsigned int profiledLocation;
+    int profiledOpcode;
+#endif
+
+    bool fetchInstruction(int& cycles);
+    bool nextInstruction(int& cycles);
+    int executeFusion(unsigned int candidates, int cycles);
+    bool matchFusion(const Fusion& fusion);
+    int finishFusion(int cycles, int instructions);
+    int fuseCopyLoop();
+    int fusePollCompare();
+    int fusePollMask();
+
+    // Handlers of the LD r,r', ALU and CB-prefixed opcodes, generated in
+    // Cpu.cpp from each opcode's encoding.
+    typedef int (Cpu::*OpHandler)();
+    static const std::array<OpHandler, 0x80> registerOpHandlers;
+    static const std::array<OpHandler, 0x100> extendedOpHandlers;
+
+    template <int r> uBYTE& registerByIndex();
+    template <int r> uBYTE readOperand();
+    template <int opcode> int executeRegisterOp();
+    template <int opcode> int executeExtendedOp();
+    template <int opcode> static constexpr OpHandler registerOpHandler();
+    template <size_t... opcodes> static constexpr std::array<OpHandler, sizeof...(opcodes)> registerOpTable(std::index_sequence<opcodes...>);
+    template <size_t... opcodes> static constexpr std::array<OpHandler, sizeof...(opcodes)> extendedOpTable(std::index_sequence<opcodes...>);
+
+    // The opcodes of a fusion are known once it matched, so fetching
+    // them again only has to take the time a fetch does.
+    inline void fetchFusedOpcode() {
+        PC++;
+        memoryUnit->UpdateTimers(4);
+    }
+
+    // Whether an interrupt would be serviced were the current instruction over.
+    inline bool interruptDispatchable() {
+        return IME && (memoryUnit->GetPendingInterrupts() != 0);
+    }
+
+    // Index of the lowest bit set in value, which must not be 0.
+    static inline int lowestBit(unsigned int value) {
+#if defined(__GNUC__)
+        return __builtin_ctz(value);
+#else
+        int bit = 0;
+        while (!(value & 1)) {
+            value >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    // Cycles left in the window once cycles were executed.
+    inline int windowLeft(int cycles) {
+        if (batchWindow < 0) {
+            batchWindow = batchWindowHook ? std::max(0, std::min(batchBudget, batchWindowHook())) : batchBudget;
+        }
+        return batchWindow - cycles;
+    }
+
+    // Whether the batch can go on with another instruction: it must start
+    // within the window, and nothing executed so far may need the rest of
+    // the machine updated, or an interrupt serviced, before it.
+    inline bool continueBatch(int cycles) {
+        if (cycles > batchBudget || windowLeft(cycles) < 0)
+            return false;
+
+        return !Halted && !buggedHalt && !memoryUnit->TakeRegisterWrite() && !interruptDispatchable();
+    }
+
     uWORD increment16BitRegister(uWORD);
     uWORD decrement16BitRegister(uWORD);
     uWORD add16BitRegister(uWORD, uWORD);
@@ -5,6 +5,9 @@
 #include "Cpu.hpp"
 #include "Ppu.hpp"
 #include "Apu.hpp"
+#include "InstructionTrace.hpp"
+#include "TraceComparator.hpp"
+#include "video/VideoSink.hpp"
 
 #include <thread>
 #include <iostream>
@@ -12,14 +15,97 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
 #include <condition_variable>
+#include <algorithm>
+
+// Amount of frames whose statistics are kept for the side panel.
+#define FRAME_STATS_HISTORY 256
+
+// Debugger snapshots hold the upper half of the address space, copied in
+// chunks of 256 bytes, only for the chunks the debugger asked for.
+#define DEBUG_SNAPSHOT_BASE 0x8000
+#define DEBUG_SNAPSHOT_SIZE 0x8000
+#define DEBUG_CHUNK_SHIFT 8
+#define DEBUG_CHUNK_COUNT (DEBUG_SNAPSHOT_SIZE >> DEBUG_CHUNK_SHIFT)
+#define DEBUG_SNAPSHOT_FRESH 0x4
+
+// How often snapshots are still published while the emulation is paused.
+#define DEBUG_SNAPSHOT_PAUSED_PERIOD std::chrono::milliseconds(50)
 
 class Gameboy {
 
     friend class SideNav;
 
 public:
+    // Snapshot of the whole emulated machine.
+    struct State {
+        Cpu::State cpu;
+        Memory::State memory;
+        Ppu::State ppu;
+        Apu::State apu;
+    };
+
+    // What the emulation is paced against. Video sync caps the emulation at
+    // 60 frames per second using the host's timer, audio sync lets the audio
+    // device's consumption of samples set the pace.
+    enum SyncMode {
+        SYNC_VIDEO,
+        SYNC_AUDIO
+    };
+
+    // Timings, in seconds, and counters of a displayed frame. emulatedTime is
+    // the amount of gameboy time emulated for it, run-ahead frames included.
+    struct FrameStats {
+        float frameTime;
+        float emulationTime;
+        float capTime;
+        float renderWaitTime;
+        float emulatedTime;
+        float audioRingFill;
+        uint32_t instructions;
+        uint32_t interrupts;
+        uint64_t underruns;
+    };
+
+    // Set of chunks of the snapshotted address range.
+    struct DebugRegions {
+        uint64_t chunks[DEBUG_CHUNK_COUNT / 64];
+
+        void Clear();
+        void Add(uWORD base, int length);
+        bool Contains(uWORD base, int length) const;
+    };
+
+    // Range of addresses, both included, to stop at when reading, writing
+    // or executing from any of them. Executing makes a PC breakpoint.
+    struct Watchpoint {
+        uWORD first;
+        uWORD last;
+        bool read;
+        bool write;
+        bool execute;
+    };
+
+    // State visible to the debugger, as of the end of a frame or of the
+    // instruction the emulation was paused at. watchHit is the last
+    // watchpoint hit, if watchHitCount is not 0.
+    struct DebugSnapshot {
+        Cpu::State cpu;
+        Memory::WatchHit watchHit;
+        uint32_t watchHitCount;
+        DebugRegions regions;
+        uBYTE memory[DEBUG_SNAPSHOT_SIZE];
+
+        // For each block of VRAM, the snapshot as of which it was last
+        // written to, kept up to date while VRAM is among the regions.
+        uint32_t vramSerials[VRAM_BLOCK_COUNT];
+    };
+
     Gameboy();
+    Gameboy(uBYTE* romData);
     Gameboy(uBYTE* romData, GLFWwindow* context);
     ~Gameboy();
 
@@ -29,6 +115,25 @@ public:
     void Resume();
     void SkipBootRom();
     void Render();
+    void SaveState(State& state);
+    void LoadState(const State& state);
+    void InitializeAudio(std::unique_ptr<AudioSink> sink, AudioMixer::SampleFormat format, int sampleRate);
+    void SetVideoSink(std::unique_ptr<VideoSink> sink);
+    void SetSerialHook(std::function<void(uBYTE)> hook);
+    void SetProfiler(Profiler* profiler);
+    void SetInstructionTrace(InstructionTrace* trace);
+    void SetTraceComparator(TraceComparator* comparator);
+    void SetFusions(unsigned int enabled);
+    void SetRunAheadFrames(int frames);
+    void SetSyncMode(SyncMode mode);
+    void RunFrames(int frames);
+    uint64_t GetCycleCount();
+    int GetFrameStats(FrameStats* stats, int count);
+    void SetDebugRegions(const DebugRegions& regions);
+    const DebugSnapshot& AcquireDebugSnapshot();
+    void QueueDebugWrite(uWORD addr, uBYTE data);
+    void SetWatchpoints(const std::vector<Watchpoint>& watchpoints);
+    std::unique_ptr<Gameboy> Fork();
 
     bool RequiresRender();
     void HandleKeyboardInput(int key, int scancode, int action, int modBits);
@@ -43,7 +148,7 @@ private:
     Memory memory;
 
     bool running;
-    bool pause;
+    std::atomic<bool> pause;
     bool requireRender;
     bool finished;
 
@@ -53,7 +158,84 @@ private:
 
     std::unique_ptr<std::thread> thread;
 
+    // Run-ahead: number of frames emulated past the current one
+    // before presenting, and the snapshot used to rewind afterwards.
+    int runAheadFrames;
+    std::unique_ptr<State> runAheadState;
+
+    SyncMode syncMode;
+
+    // Clock cycles, instructions and interrupts emulated since the gameboy
+    // was created, rewound frames included.
+    uint64_t cycleCount;
+    uint64_t instructionCount;
+    uint64_t interruptCount;
+
+    // Statistics of the last frames, written only by the emulation thread.
+    // A frame's entry is filled in before the count is published, so readers
+    // never see an entry that is being written, as long as they stay clear
+    // of the oldest one, which is the next to be overwritten.
+    FrameStats frameStats[FRAME_STATS_HISTORY];
+    std::atomic<uint64_t> frameStatsCount;
+
+    // Debugger snapshots are triple buffered: the emulation thread fills the
+    // back buffer, the side panel reads the front one, and the third is
+    // swapped between them through debugSnapshotSlot, which also tells
+    // whether it holds a snapshot the panel has not acquired yet. Neither
+    // side ever waits for the other.
+    DebugSnapshot debugSnapshots[3];
+    int debugBackBuffer;
+    int debugFrontBuffer;
+    std::atomic<int> debugSnapshotSlot;
+    std::atomic<uint64_t> debugRegions[DEBUG_CHUNK_COUNT / 64];
+
+    // Snapshots are numbered, so that the video pane can tell which blocks
+    // of VRAM changed since the one it last saw, even if it skipped some.
+    uint32_t debugSnapshotCount;
+    uint32_t vramSerials[VRAM_BLOCK_COUNT];
+
+    // Memory edits made from the debugger, applied by the emulation thread.
+    std::mutex debugWritesMtx;
+    std::atomic<bool> hasDebugWrites;
+    std::vector<std::pair<uWORD, uBYTE>> debugWrites;
+
+    // Watchpoints set from the debugger, applied by the emulation thread
+    // along with the edits. Hits are only touched by the emulation thread.
+    std::atomic<bool> hasWatchpoints;
+    std::vector<Watchpoint> pendingWatchpoints;
+    Memory::WatchHit watchHit;
+    uint32_t watchHitCount;
+
+    // Buttons pressed and released from the window, applied by the
+    // emulation thread at the start of the next frame.
+    std::mutex joypadMtx;
+    std::atomic<bool> hasJoypadInput;
+    std::vector<std::pair<uBYTE, bool>> joypadInput;
+
+    std::unique_ptr<VideoSink> videoSink;
+
+    // Recorded into by the cpu, and reset on the side panel's request.
+    Profiler* profiler;
+
+    // Receive the state of the cpu before each instruction, if set.
+    // Traced cycles leave out those of rewound frames.
+    bool tracingInstructions;
+    InstructionTrace* instructionTrace;
+    TraceComparator* traceComparator;
+    uint64_t lastTracedCycle;
+    uint64_t rewoundCycleCount;
+
     void Run();
+    void RunFrame(bool speculative);
+    void RunAheadFrame();
+    void OutputFrame();
+    void PublishFrameStats(const FrameStats& stats);
+    void PublishDebugSnapshot();
+    void HitWatchpoint(const Memory::WatchHit& hit);
+    void queueJoypadInput(uBYTE buttons, bool pressed);
+    void applyJoypadInput();
+    void traceInstruction(uint64_t cycle, bool halted);
+    int batchWindow();
 };
 
 #endif
@@ -0,0 +1,97 @@
+#ifndef INSTRUCTIONTRACE_HPP
+#define INSTRUCTIONTRACE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Instruction traces record the state of the cpu before every instruction
+// executed. Records are handed to a writer thread through a ring buffer, and
+// written delta encoded: each one starts with a 16-bit mask of the bytes that
+// differ from the previous record, followed by those bytes only.
+
+// Amount of records the ring holds, 16 MiB worth.
+#define INSTRUCTION_TRACE_RING_SIZE (1 << 20)
+#define INSTRUCTION_TRACE_MAGIC "FUUGBITR"
+#define INSTRUCTION_TRACE_MAGIC_SIZE 8
+
+// A halted cpu records nothing, so it is recorded again as executing HALT
+// whenever it stayed halted for this many machine cycles, to keep the 16-bit
+// cycle counter of the records from wrapping around more than once between two.
+#define INSTRUCTION_TRACE_SYNC_CYCLES 0x8000
+
+// cycle is the emulated clock, in machine cycles of 4 clock cycles, modulo
+// 65536. Records are stored in the host's byte order.
+struct InstructionRecord {
+    uint8_t bank;
+    uint8_t opcode;
+    uint16_t pc;
+    uint16_t af;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint16_t sp;
+    uint16_t cycle;
+};
+
+static_assert(sizeof(InstructionRecord) == 16, "instruction records must stay 16 bytes");
+
+class InstructionTrace {
+
+public:
+    InstructionTrace();
+    ~InstructionTrace();
+
+    bool Open(const std::string& path);
+    bool Close();
+
+    // Only one thread may record. Should the writer fall behind, recording
+    // waits for it rather than losing records.
+    inline void Record(const InstructionRecord& record) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        while (index - tail.load(std::memory_order_acquire) >= INSTRUCTION_TRACE_RING_SIZE) {
+            std::this_thread::yield();
+        }
+
+        records[index & (INSTRUCTION_TRACE_RING_SIZE - 1)] = record;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+private:
+    void writeRecords();
+    void encode(const InstructionRecord& record, std::vector<uint8_t>& buffer);
+
+    FILE* output;
+    std::thread writer;
+    std::atomic<bool> closing;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
+    std::vector<InstructionRecord> records;
+    InstructionRecord previous;
+};
+
+// Reads back the records of a trace, in the order they were recorded.
+class InstructionTraceReader {
+
+public:
+    InstructionTraceReader();
+    ~InstructionTraceReader();
+
+    bool Open(const std::string& path);
+    void Close();
+    bool Next(InstructionRecord& record);
+
+    // Machine cycles elapsed from the first record to the last one read.
+    uint64_t GetCycle();
+
+private:
+    FILE* input;
+    InstructionRecord previous;
+    uint64_t cycle;
+    bool first;
+};
+
+#endif
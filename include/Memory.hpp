@@ -9,6 +9,33 @@
 #define CART_HEADER_ROMINFO 0x148
 #define CART_HEADER_RAMINFO 0x149
 
+// Memory is stored in 4 KiB pages, so that forks and snapshots of
+// a memory unit can share them and only copy the ones written to.
+// The cartridge RAM banks are paged right after the address space.
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_MASK (MEMORY_PAGE_SIZE - 1)
+#define CART_RAM_BANK_COUNT 4
+#define CART_RAM_BANK_SIZE 0x2000
+#define CART_RAM_OFFSET NATIVE_ROM_SIZE
+#define MEMORY_PAGE_COUNT ((NATIVE_ROM_SIZE + (CART_RAM_BANK_COUNT * CART_RAM_BANK_SIZE)) >> MEMORY_PAGE_SHIFT)
+
+// Video RAM writes are tracked in blocks of 16 bytes, the size of a tile,
+// so that viewers only decode the tiles and map entries that changed.
+#define VRAM_ADR 0x8000
+#define VRAM_SIZE 0x2000
+#define VRAM_BLOCK_SHIFT 4
+#define VRAM_BLOCK_COUNT (VRAM_SIZE >> VRAM_BLOCK_SHIFT)
+
+// Watchpoints are kept as one bit per address for each kind of access, and
+// one bit per page telling whether any address of the page is watched. Only
+// accesses to watched pages look any further.
+#define WATCH_READ 0
+#define WATCH_WRITE 1
+#define WATCH_EXECUTE 2
+#define WATCH_KIND_COUNT 3
+#define WATCH_BITMAP_WORDS (NATIVE_ROM_SIZE / 64)
+
 typedef unsigned char uBYTE;
 typedef unsigned short uWORD;
 
@@ -16,6 +43,11 @@ typedef unsigned short uWORD;
 #include <map>
 #include <string.h>
 #include <memory>
+#include <atomic>
+#include <functional>
+
+#include "Benchmark.hpp"
+#include "Trace.hpp"
 
 #define VBLANK_INT 0
 #define LCDC_INT 1
@@ -26,6 +58,7 @@ typedef unsigned short uWORD;
 #define LCDC_ADR 0xFF40
 #define STAT_ADR 0xFF41
 #define LY_ADR 0xFF44
+#define LY_STUB_VALUE 0x90
 #define OAM_ADR 0xFE00
 #define SCR_X_ADR 0xFF43
 #define SCR_Y_ADR 0xFF42
@@ -35,10 +68,15 @@ typedef unsigned short uWORD;
 #define TIMA_ADR 0xFF05
 #define TIM_MOD_ADR 0xFF06
 #define IF_ADR 0xFF0F
+#define IE_ADR 0xFFFF
 #define JOYPAD_INPUT_REG 0xFF00
+#define SB_ADR 0xFF01
+#define SC_ADR 0xFF02
 
 using namespace std;
 
+class Apu;
+
 class Memory {
 
     friend class Gameboy;
@@ -51,6 +89,28 @@ public:
 
     int timerCounter;
 
+    // Access that hit a watchpoint. data is the byte written, for writes.
+    struct WatchHit {
+        int kind;
+        uWORD addr;
+        uBYTE data;
+    };
+
+    // Snapshot of all the mutable memory state. The joypad buffer is
+    // deliberately left out since it is owned by the host's input handler.
+    struct State {
+        std::shared_ptr<uBYTE> pages[MEMORY_PAGE_COUNT];
+        int timerCounter;
+        int dmaCyclesCompleted;
+        int dividerRegisterCounter;
+        bool bootRomClosed;
+        bool dmaTransferInProgress;
+        bool ramEnabled;
+        bool romRamMode;
+        uWORD currentRomBank;
+        uWORD currentRamBank;
+    };
+
     void Write(uWORD, uBYTE);
     void DmaWrite(uWORD, uBYTE);
     void RequestInterupt(int);
@@ -60,16 +120,57 @@ public:
     uBYTE Read(uWORD, bool = false);
     uBYTE DmaRead(uWORD);
     void SetPostBootRomState();
+    void SaveState(State& state);
+    void LoadState(const State& state);
+    void Fork(Memory& child);
+    void CopyRange(uWORD addr, int length, uBYTE* dest);
+    void SetSerialHook(std::function<void(uBYTE)> hook);
+    void SetWatchHook(std::function<void(const WatchHit&)> hook);
+    void SetWatch(int kind, uWORD first, uWORD last);
+    void ClearWatches();
+    void SuspendWatches();
+    void ResumeWatches();
+    bool HitExecuteWatch(uWORD addr);
+    void SetLyStubbed(bool stubbed);
+
+    inline bool IsWatchedPage(int kind, uWORD addr) {
+        return watchedPages[kind] & (1 << (addr >> MEMORY_PAGE_SHIFT));
+    }
+
+    inline bool HasWatches() {
+        return (watchedPages[WATCH_READ] | watchedPages[WATCH_WRITE] | watchedPages[WATCH_EXECUTE]) != 0;
+    }
+
+    inline bool IsDmaInProgress() {
+        return dmaTransferInProgress;
+    }
+
+    // IE & IF for the five interrupts, kept up to date by every write to
+    // either, so that checking for an interrupt to service reads nothing.
+    // It is a plain byte, read on every instruction: interrupts may only be
+    // requested from the emulation thread, which is why the joypad's go
+    // through Gameboy's input queue.
+    inline uBYTE GetPendingInterrupts() {
+        return pendingInterrupts;
+    }
 
-    bool RequiresCh1LengthReload();
-    bool RequiresCh2LengthReload();
-    bool RequiresCh3LengthReload();
-    bool RequiresCh4LengthReload();
+    // Whether an I/O register or IE was written to since the last call.
+    // The cpu ends a batch of instructions at such writes.
+    inline bool TakeRegisterWrite() {
+        bool written = registerWritten;
+        registerWritten = false;
+        return written;
+    }
 
-    bool TriggerEventCh1();
-    bool TriggerEventCh2();
-    bool TriggerEventCh3();
-    bool TriggerEventCh4();
+    inline uWORD GetRomBank() {
+        return currentRomBank;
+    }
+
+    // Whether the given block of video RAM was written to since the last
+    // call for it. Safe to call from any thread.
+    inline bool TakeVramDirty(int block) {
+        return vramDirty[block].exchange(0, std::memory_order_relaxed) != 0;
+    }
 
 private:
     void changeRomBank(uWORD, uBYTE);
@@ -80,22 +181,59 @@ private:
     void closeBootRom();
     void handleJoypadTranslation(uBYTE);
     uBYTE getStatMode();
+    void claimPage(unsigned int page);
+    void markVramPagesDirty(const std::shared_ptr<uBYTE>* previousPages);
+    void checkWatch(int kind, uWORD addr, uBYTE data);
+
+    inline void markVramDirty(uWORD addr) {
+        vramDirty[(addr - VRAM_ADR) >> VRAM_BLOCK_SHIFT].store(1, std::memory_order_relaxed);
+    }
+
+    inline uBYTE peek(unsigned int offset) {
+        return pages[offset >> MEMORY_PAGE_SHIFT][offset & MEMORY_PAGE_MASK];
+    }
+
+    inline void poke(unsigned int offset, uBYTE data) {
+        unsigned int page = offset >> MEMORY_PAGE_SHIFT;
+        if (!(dirtyPages & (1 << page))) {
+            claimPage(page);
+        }
+        pages[page][offset & MEMORY_PAGE_MASK] = data;
+    }
+
+    inline void updatePendingInterrupts() {
+        pendingInterrupts = peek(IE_ADR) & peek(IF_ADR) & 0x1F;
+    }
 
     int dmaCyclesCompleted;
     int dividerRegisterCounter;
     bool bootRomClosed;
     bool dmaTransferInProgress;
+    bool registerWritten;
+    uBYTE pendingInterrupts;
     uWORD translatedAddr;
 
-    // APU flags
-    bool reloadCh1LengthTimer = false;
-    bool reloadCh2LengthTimer = false;
-    bool reloadCh3LengthTimer = false;
-    bool reloadCh4LengthTimer = false;
-    bool triggerEventCh1 = false;
-    bool triggerEventCh2 = false;
-    bool triggerEventCh3 = false;
-    bool triggerEventCh4 = false;
+    // Writes to the sound registers and wave RAM are forwarded to the apu.
+    Apu* apuRef = NULL;
+
+    // Receives every byte sent out through the serial port.
+    std::function<void(uBYTE)> serialHook;
+
+    // Told about every access hitting a watchpoint.
+    std::function<void(const WatchHit&)> watchHook;
+    uint32_t watchedPages[WATCH_KIND_COUNT];
+    uint64_t watchBitmap[WATCH_KIND_COUNT][WATCH_BITMAP_WORDS];
+
+    // Watched pages put aside by SuspendWatches.
+    uint32_t suspendedPages[WATCH_KIND_COUNT];
+
+    // When set, the cpu always reads LY as LY_STUB_VALUE, as reference
+    // traces logged by emulators without a ppu expect.
+    bool lyStubbed;
+
+    // Address of the last execute watchpoint hit, which is let through
+    // once so that the emulation can resume past it.
+    int resumeAddress;
 
     enum CartAttributes {
         ramEnabled,
@@ -126,9 +264,18 @@ private:
 
     uBYTE joypadBuffer;
 
-    uBYTE* rom;
+    // Pages that have been written to since the last fork or snapshot
+    // are marked dirty; these are known to be private to this unit.
+    std::shared_ptr<uBYTE> pageRefs[MEMORY_PAGE_COUNT];
+    uBYTE* pages[MEMORY_PAGE_COUNT];
+    uint32_t dirtyPages;
+
+    // Blocks of video RAM written to, cleared by TakeVramDirty.
+    std::atomic<uBYTE> vramDirty[VRAM_BLOCK_COUNT];
+
+    // The cartridge image is read-only and shared between forks.
+    std::shared_ptr<uBYTE> cartridgeRef;
     uBYTE* cartridge;
-    uBYTE cart_ram[4][0x2000];
 
     const uBYTE bootRom[BOOTROM_SIZE] = {
         0x31, 0xFE, 0xFF, 0xAF, 0x21, 0xFF, 0x9F, 0x32, 0xCB, 0x7C,
@@ -23,11 +23,24 @@ public:
     Ppu();
     ~Ppu();
 
+    // Snapshot of the ppu's timing state. The pixel buffer is output
+    // rather than state and is therefore not part of it.
+    struct State {
+        int currentScanline;
+        int scanlineCounter;
+    };
+
     void UpdateGraphics(int);
     void Render();
     void AttachShaders(Shader& vs, Shader& fs);
     void SetMemory(Memory* memory);
     void InitializeGLBuffers();
+    void SetRenderingEnabled(bool enabled);
+    const uBYTE* GetFrameBuffer();
+    void SaveState(State& state);
+    void LoadState(const State& state);
+
+    int CyclesUntilEvent();
 
 private:
 
@@ -55,14 +68,20 @@ private:
             colorCode = colorCode;
         };
     };
+    static_assert(sizeof(pixel) == 4, "pixels are handed out as 4 bytes each");
 
-    pixel** pixels;
+    // Stored contiguously, row by row, so that it can be handed out as is.
+    pixel* pixels;
     uBYTE LCDC;
     uBYTE STAT;
     Memory* memoryRef;
     int currentScanline;
     int scanlineCounter;
 
+    // When disabled, the ppu keeps its timing, LY/STAT and interrupts
+    // up to date but skips drawing scanlines into the pixel buffer.
+    bool renderingEnabled;
+
     void DrawScanline();
     void RenderTiles();
     void RenderSprites();
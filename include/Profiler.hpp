@@ -0,0 +1,94 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Memory.hpp"
+
+// Opcodes are counted in a single table, the CB-prefixed ones after the base ones.
+#define PROFILER_CB_OPCODES 0x100
+#define PROFILER_OPCODE_COUNT 0x200
+
+// Every address an instruction can be fetched from gets a counter: the whole
+// cartridge, bank by bank, followed by the non-banked 0x8000-0xFFFF range.
+#define PROFILER_ROM_BANK_SIZE 0x4000
+#define PROFILER_RAM_LOCATIONS MAX_CART_SIZE
+#define PROFILER_LOCATION_COUNT (MAX_CART_SIZE + 0x8000)
+
+// Fusions are enabled through a bit mask, so there can be no more than this.
+#define PROFILER_FUSION_COUNT 32
+
+// Execution profile of the cpu, filled in by builds made with FUUGB_PROFILE
+// defined. Counters live in flat tables sized up front, so recording an
+// instruction costs a handful of increments and never allocates.
+class Profiler {
+
+public:
+    struct Counter {
+        uint64_t executions;
+        uint64_t cycles;
+    };
+
+    // A fetch address along with the rom bank it was mapped to,
+    // -1 for addresses outside of the cartridge rom.
+    struct HotSpot {
+        int bank;
+        uWORD pc;
+        Counter counter;
+    };
+
+    Profiler();
+    ~Profiler();
+
+    void Reset();
+    void RequestReset();
+    void ResetIfRequested();
+    Counter GetTotal();
+    Counter GetOpcode(int opcode);
+    uint64_t GetFusion(int fusion);
+    void GetHotSpots(std::vector<HotSpot>& hotSpots, size_t count);
+    bool Dump(const std::string& path);
+
+    static std::string OpcodeName(int opcode);
+
+    static inline unsigned int Location(uWORD pc, uWORD romBank) {
+        if (pc < PROFILER_ROM_BANK_SIZE)
+            return pc;
+
+        if (pc < 0x8000)
+            return ((romBank & ((MAX_CART_SIZE / PROFILER_ROM_BANK_SIZE) - 1)) * PROFILER_ROM_BANK_SIZE) +
+                (pc - PROFILER_ROM_BANK_SIZE);
+
+        return PROFILER_RAM_LOCATIONS + (pc - 0x8000);
+    }
+
+    inline void Record(unsigned int location, int opcode, int cycles) {
+        opcodes[opcode].executions++;
+        opcodes[opcode].cycles += cycles;
+        locations[location].executions++;
+        locations[location].cycles += cycles;
+    }
+
+    // Counts a fused sequence of instructions found at the program counter,
+    // whose instructions are then recorded one by one as usual.
+    inline void RecordFusion(int fusion) {
+        fusions[fusion]++;
+    }
+
+private:
+    static HotSpot toHotSpot(unsigned int location, const Counter& counter);
+
+    Counter opcodes[PROFILER_OPCODE_COUNT];
+    uint64_t fusions[PROFILER_FUSION_COUNT];
+    std::vector<Counter> locations;
+
+    // Set from the side panel, which may not clear the counters while
+    // the emulation thread is recording into them.
+    std::atomic<bool> resetRequested;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <atomic>
+#include <stddef.h>
+
+#include "Memory.hpp"
+
+// Lock-free single-producer/single-consumer ring buffer of bytes.
+// The emulation thread is the only producer (Write) and an output thread,
+// for audio samples or video frames, the only consumer (Read). Neither side
+// ever blocks the other.
+class RingBuffer {
+
+public:
+    // Capacity must be a power of two.
+    RingBuffer(size_t capacity);
+    ~RingBuffer();
+
+    size_t Write(const uBYTE* data, size_t length);
+    size_t Read(uBYTE* data, size_t length);
+    // Only an estimate outside of the producer and consumer threads.
+    size_t Size();
+    size_t Capacity();
+
+private:
+    uBYTE* buffer;
+    size_t capacity;
+    size_t mask;
+
+    // Kept on separate cache lines so that the producer and the
+    // consumer do not invalidate each other's line on every update.
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
@@ -2,14 +2,27 @@
 #define SIDENAV_HPP
 
 #include "Gameboy.hpp"
+#include "VramViewer.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "imgui_memory_editor/imgui_memory_editor.h"
 
 #include <GLFW/glfw3.h>
+#include <vector>
 
 #define IMGUI_SIZE_X 550
+#define DEBUGGER_TAB_COUNT 5
+
+// Rows listed in each table of the profiler pane.
+#define PROFILER_PANE_ROWS 32
+
+// Magnification of the tiles and tile maps in the video pane.
+#define VIDEO_PANE_SCALE 2
+#define OAM_SPRITE_COUNT 40
+
+// The LCD registers, from LCDC up to the window position.
+#define LCD_REGISTERS_SIZE 0x0C
 
 class SideNav {
 public:
@@ -25,21 +38,60 @@ private:
     void renderDebuggerWindow();
     void renderDebuggerTabButtons();
     void renderMemoryPane();
+    void renderMemoryRegion(uWORD base, int length);
+    void renderWatchpoints();
+    void renderWatchHit();
     void renderVideoPane();
+    void renderTileMap(int map, bool background);
+    void renderOamTable();
+    uBYTE snapshotRead(uWORD addr);
     void renderAudioPane();
+    void renderProfilerPane();
+    void renderPerformancePane();
 
     Gameboy* gbRef;
+
+    // What the panels show of the cpu and memory comes from the latest
+    // snapshot, which only holds the regions asked for on the previous frame.
+    const Gameboy::DebugSnapshot* snapshot;
+    Gameboy::DebugRegions debugRegions;
+
     MemoryEditor memoryEditor;
+    VramViewer vramViewer;
+    uBYTE memoryView[0x2000];
+    uBYTE memoryViewShadow[0x2000];
+    // Watchpoints as last sent to the gameboy, and the hit last shown,
+    // which the memory editor still has to scroll to if pending.
+    std::vector<Gameboy::Watchpoint> watchpoints;
+    char watchRange[16] = {};
+    bool watchRead = false;
+    bool watchWrite = true;
+    bool watchExecute = false;
+    uint32_t watchHitCount = 0;
+    bool watchHitPending = false;
+
     std::string pauseButtonLabels[2] = { "Pause", "Resume" };
     int pauseLabelIdx = 0;
     enum debuggerTab {
         MEMORY,
         VIDEO,
-        AUDIO
+        AUDIO,
+        PROFILER,
+        PERFORMANCE
     };
 
     debuggerTab selection = MEMORY;
     bool selectedListBox[3] = { true, false, false };
+
+    // Hottest locations shown by the profiler pane, and when they were last gathered.
+    std::vector<Profiler::HotSpot> hotSpots;
+    double hotSpotsTimestamp = 0;
+
+    // Time the main thread spent on the side panel for the last frames,
+    // measured here since the gameboy only sees the emulation thread.
+    float imguiTimes[FRAME_STATS_HISTORY] = {};
+    int imguiTimeIndex = 0;
+    Gameboy::FrameStats frameStats[FRAME_STATS_HISTORY];
 };
 
 #endif
@@ -0,0 +1,111 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Timeline zones, recorded by builds made with FUUGB_TRACE defined and exported
+// in the Chrome trace event format, which chrome://tracing and Perfetto open.
+// Other builds compile the zones to nothing.
+
+// Amount of events kept per thread, the oldest ones are overwritten first.
+#define TRACE_RING_SIZE (1 << 16)
+
+struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Events recorded by a single thread. Only that thread writes to it, so
+// recording an event is a few stores followed by publishing the new head,
+// and exporting never blocks it.
+class TraceRing {
+
+public:
+    TraceRing(int threadId);
+    ~TraceRing();
+
+    inline void Push(const char* name, uint64_t start, uint64_t end) {
+        uint64_t index = head.load(std::memory_order_relaxed);
+        TraceEvent& event = events[index & (TRACE_RING_SIZE - 1)];
+        event.name = name;
+        event.start = start;
+        event.end = end;
+        head.store(index + 1, std::memory_order_release);
+    }
+
+    void Snapshot(std::vector<TraceEvent>& snapshot);
+
+    int threadId;
+    std::string threadName;
+
+private:
+    std::atomic<uint64_t> head;
+    TraceEvent events[TRACE_RING_SIZE];
+};
+
+class Trace {
+
+public:
+    static void SetThreadName(const char* name);
+    static bool Export(const std::string& path);
+
+    // Nanoseconds since the program started.
+    static inline uint64_t Now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    static inline TraceRing* GetRing() {
+        if (threadRing == NULL) {
+            threadRing = registerThread();
+        }
+        return threadRing;
+    }
+
+private:
+    static TraceRing* registerThread();
+
+    static const std::chrono::steady_clock::time_point epoch;
+    static thread_local TraceRing* threadRing;
+
+    // Rings outlive their threads, so that their events can still be exported.
+    static std::mutex ringsMtx;
+    static std::vector<std::unique_ptr<TraceRing>> rings;
+};
+
+class TraceZone {
+
+public:
+    TraceZone(const char* name) : name(name) {
+        start = Trace::Now();
+    }
+
+    ~TraceZone() {
+        Trace::GetRing()->Push(name, start, Trace::Now());
+    }
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#ifdef FUUGB_TRACE
+
+#define TRACE_ZONE(name) TraceZone traceZone(name)
+#define TRACE_THREAD(name) Trace::SetThreadName(name)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_THREAD(name)
+
+#endif
+
+#endif
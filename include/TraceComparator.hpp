@@ -0,0 +1,75 @@
+#ifndef TRACECOMPARATOR_HPP
+#define TRACECOMPARATOR_HPP
+
+#include "Cpu.hpp"
+
+#include <stdio.h>
+#include <atomic>
+#include <string>
+
+// Reference lines kept to show what led to a divergence.
+#define TRACE_COMPARE_CONTEXT 8
+
+// Checks the state of the cpu before every instruction against a reference
+// log in gameboy-doctor's format, one instruction per line:
+//
+//   A:01 F:B0 B:00 C:13 D:00 E:D8 H:01 L:4D SP:FFFE PC:0100 PCMEM:00,C3,13,02
+//
+// The log is memory mapped and parsed a line at a time as the emulation goes,
+// so that its size does not matter. Comparing stops at the first difference.
+class TraceComparator {
+
+public:
+    enum Status {
+        COMPARING,
+        DIVERGED,
+        FINISHED
+    };
+
+    TraceComparator();
+    ~TraceComparator();
+
+    bool Open(const std::string& path);
+    void Close();
+    bool Compare(const Cpu::State& state, const uBYTE* pcmem);
+    void Report(FILE* output);
+
+    // Safe to call from any thread. Once it is no longer COMPARING,
+    // the report is complete.
+    Status GetStatus();
+
+private:
+    // A line of the reference, or the emulator's state in the same terms.
+    struct Line {
+        uWORD af;
+        uWORD bc;
+        uWORD de;
+        uWORD hl;
+        uWORD sp;
+        uWORD pc;
+        uBYTE pcmem[4];
+        bool hasPcmem;
+    };
+
+    bool parseLine(const char* begin, const char* end, Line& line);
+    void printLine(FILE* output, const char* label, const Line& line);
+    const char* lineEnd(const char* begin);
+
+    std::string path;
+    const char* data;
+    size_t size;
+    const char* cursor;
+    uint64_t lineNumber;
+
+    // Starts of the last lines compared, the oldest overwritten first.
+    const char* context[TRACE_COMPARE_CONTEXT];
+
+    // Where the comparison stopped.
+    const char* failedLine;
+    Line expected;
+    Line emulated;
+
+    std::atomic<Status> status;
+};
+
+#endif
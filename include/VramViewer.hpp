@@ -0,0 +1,56 @@
+#ifndef VRAMVIEWER_HPP
+#define VRAMVIEWER_HPP
+
+#include <GL/glew.h>
+
+#include "Gameboy.hpp"
+
+// The 384 tiles are laid out 16 per row, the tile maps are 32 by 32 tiles.
+#define VRAM_TILE_COUNT 384
+#define VRAM_TILES_PER_ROW 16
+#define VRAM_TILES_SIZE_X (VRAM_TILES_PER_ROW * 8)
+#define VRAM_TILES_SIZE_Y ((VRAM_TILE_COUNT / VRAM_TILES_PER_ROW) * 8)
+#define VRAM_MAP_COUNT 2
+#define VRAM_MAP_TILES 32
+#define VRAM_MAP_SIZE (VRAM_MAP_TILES * 8)
+
+// Decodes the tile data and both background tile maps of the video RAM into
+// GL textures for the side panel, out of the debugger snapshots, which must
+// hold VRAM and the LCD registers. Only the tiles and map entries whose video
+// RAM was written to since the last update are decoded and uploaded again,
+// along with the map entries showing a tile that changed. Meant to be used
+// from the thread owning the rendering context.
+class VramViewer {
+
+public:
+    VramViewer();
+    ~VramViewer();
+
+    void Update(const Gameboy::DebugSnapshot& snapshot);
+    void Shutdown();
+
+    GLuint GetTilesTexture();
+    GLuint GetMapTexture(int map);
+
+private:
+    void initializeTextures();
+    void decodeTile(int tile, uBYTE* texels, int stride);
+    void uploadTile(GLuint texture, const uBYTE* texels, int stride, int x, int y);
+    int mapEntryTile(uBYTE tileId);
+
+    bool texturesInitialized;
+    GLuint tilesTexture;
+    GLuint mapTextures[VRAM_MAP_COUNT];
+
+    uBYTE vram[VRAM_SIZE];
+    uint32_t vramSerials[VRAM_BLOCK_COUNT];
+    uBYTE palette;
+    bool signedTileIds;
+
+    // RGBA texels, kept to upload the tiles that changed out of them.
+    uBYTE tilesTexels[VRAM_TILES_SIZE_X * VRAM_TILES_SIZE_Y * 4];
+    uBYTE mapTexels[VRAM_MAP_COUNT][VRAM_MAP_SIZE * VRAM_MAP_SIZE * 4];
+    bool tileChanged[VRAM_TILE_COUNT];
+};
+
+#endif
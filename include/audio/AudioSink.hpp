@@ -0,0 +1,30 @@
+#ifndef AUDIO_SINK_HPP
+#define AUDIO_SINK_HPP
+
+#include <stddef.h>
+
+#include "AudioMixer.hpp"
+
+typedef unsigned char uBYTE;
+
+// Destination of the apu's mixed samples. Samples are written from the
+// apu's flusher thread, in the format and rate passed to Open.
+class AudioSink {
+
+public:
+    virtual ~AudioSink() {}
+
+    virtual bool Open(AudioMixer::SampleFormat format, int sampleRate) = 0;
+    virtual void Write(const uBYTE* data, size_t size) = 0;
+    virtual void Close() = 0;
+
+    // Whether samples are consumed at playback speed, such as by an audio
+    // device. Only those sinks can pace the emulation, and they are the
+    // only ones for which samples are dropped rather than waited on.
+    virtual bool IsRealTime() = 0;
+
+    // Whether samples are thrown away, in which case the apu isn't emulated at all.
+    virtual bool IsNull() { return false; }
+};
+
+#endif
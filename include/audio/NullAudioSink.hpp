@@ -0,0 +1,18 @@
+#ifndef NULL_AUDIO_SINK_HPP
+#define NULL_AUDIO_SINK_HPP
+
+#include "audio/AudioSink.hpp"
+
+// Discards all samples. The apu skips emulating sound altogether
+// when attached to this sink, so it costs nothing.
+class NullAudioSink : public AudioSink {
+
+public:
+    bool Open(AudioMixer::SampleFormat format, int sampleRate) override;
+    void Write(const uBYTE* data, size_t size) override;
+    void Close() override;
+    bool IsRealTime() override;
+    bool IsNull() override;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef PULSE_AUDIO_SINK_HPP
+#define PULSE_AUDIO_SINK_HPP
+
+#include <pulse/simple.h>
+#include <pulse/error.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "audio/AudioSink.hpp"
+
+// Plays the samples back through the PulseAudio server.
+class PulseAudioSink : public AudioSink {
+
+public:
+    PulseAudioSink();
+
+    bool Open(AudioMixer::SampleFormat format, int sampleRate) override;
+    void Write(const uBYTE* data, size_t size) override;
+    void Close() override;
+    bool IsRealTime() override;
+
+private:
+    pa_simple* audioClient;
+};
+
+#endif
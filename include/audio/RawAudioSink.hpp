@@ -0,0 +1,32 @@
+#ifndef RAW_AUDIO_SINK_HPP
+#define RAW_AUDIO_SINK_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string>
+
+#include "audio/AudioSink.hpp"
+
+// Writes the interleaved samples as they are, with no header, to a file,
+// a named pipe or the standard output (when the path is "-").
+class RawAudioSink : public AudioSink {
+
+public:
+    RawAudioSink(std::string path);
+
+    bool Open(AudioMixer::SampleFormat format, int sampleRate) override;
+    void Write(const uBYTE* data, size_t size) override;
+    void Close() override;
+    bool IsRealTime() override;
+
+private:
+    std::string path;
+    int fd;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef WAV_AUDIO_SINK_HPP
+#define WAV_AUDIO_SINK_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <string>
+
+#include "audio/AudioSink.hpp"
+
+#define WAV_HEADER_SIZE 44
+
+// Streams the samples to a WAV file. The chunk sizes are left as
+// unknown while recording and filled in when the sink is closed.
+class WavAudioSink : public AudioSink {
+
+public:
+    WavAudioSink(std::string path);
+
+    bool Open(AudioMixer::SampleFormat format, int sampleRate) override;
+    void Write(const uBYTE* data, size_t size) override;
+    void Close() override;
+    bool IsRealTime() override;
+
+private:
+    void writeHeader(uint32_t dataSize);
+
+    std::string path;
+    FILE* file;
+    AudioMixer::SampleFormat format;
+    int sampleRate;
+    uint64_t dataSize;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef HASH_VIDEO_SINK_HPP
+#define HASH_VIDEO_SINK_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include "video/VideoSink.hpp"
+
+// Hashes selected frames, for regression testing without writing or
+// diffing images. Frames are counted from 0.
+//
+// The golden file lists the expected hash of frames, one "<frame> <hash>"
+// pair per line, in the format Report prints them in when no golden file is
+// given. The frames it lists are hashed along with the requested ones.
+class HashVideoSink : public VideoSink {
+
+public:
+    HashVideoSink(std::string goldenPath, std::vector<int> frames);
+
+    bool Open(int width, int height) override;
+    void Write(const uBYTE* frame) override;
+    void Close() override;
+
+    int LastFrame();
+    bool Report();
+
+    static uint64_t Hash(const uBYTE* data, size_t size);
+
+private:
+    bool readGolden();
+
+    std::string goldenPath;
+    int currentFrame;
+    size_t frameSize;
+
+    // Frames to hash, with their hash once reached.
+    std::map<int, uint64_t> hashes;
+    std::map<int, bool> reached;
+    std::map<int, uint64_t> expected;
+
+    // Copy of the frame being hashed, with the bytes to be ignored cleared.
+    std::vector<uBYTE> frame;
+};
+
+#endif
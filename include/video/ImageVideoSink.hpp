@@ -0,0 +1,50 @@
+#ifndef IMAGE_VIDEO_SINK_HPP
+#define IMAGE_VIDEO_SINK_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "video/VideoSink.hpp"
+
+// Dumps frames to individual image files, as PNG when the path ends with
+// .png and as binary PPM otherwise. Only frames firstFrame to lastFrame
+// (counted from 0, lastFrame being -1 for no end) are written.
+//
+// The frame number is substituted into the path where it contains a
+// printf-like %d or %0<width>d, e.g. "frames/%06d.png". A path without one
+// is overwritten by every frame, which is enough for single screenshots.
+class ImageVideoSink : public VideoSink {
+
+public:
+    ImageVideoSink(std::string pathPattern, int firstFrame, int lastFrame);
+
+    bool Open(int width, int height) override;
+    void Write(const uBYTE* frame) override;
+    void Close() override;
+
+private:
+    std::string framePath(int frame);
+    void writePpm(FILE* file, const uBYTE* frame);
+    void writePng(FILE* file, const uBYTE* frame);
+
+    std::string pathPattern;
+    bool png;
+    int firstFrame;
+    int lastFrame;
+    int currentFrame;
+    int width;
+    int height;
+
+    // Pixels of a frame, without the padding byte, as the image formats expect them.
+    std::vector<uBYTE> rgb;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef NULL_VIDEO_SINK_HPP
+#define NULL_VIDEO_SINK_HPP
+
+#include "video/VideoSink.hpp"
+
+// Discards all frames.
+class NullVideoSink : public VideoSink {
+
+public:
+    bool Open(int width, int height) override;
+    void Write(const uBYTE* frame) override;
+    void Close() override;
+    bool IsNull() override;
+};
+
+#endif
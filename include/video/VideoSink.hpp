@@ -0,0 +1,28 @@
+#ifndef VIDEO_SINK_HPP
+#define VIDEO_SINK_HPP
+
+#include <stddef.h>
+
+typedef unsigned char uBYTE;
+
+// Size in bytes of a pixel in the frames handed to video sinks:
+// red, green and blue, followed by a byte that is to be ignored.
+#define VIDEO_PIXEL_SIZE 4
+
+// Destination of the frames shown on screen, in addition to the window.
+// Frames are written from the emulation thread, once per emulated frame,
+// as rows of pixels of the size passed to Open.
+class VideoSink {
+
+public:
+    virtual ~VideoSink() {}
+
+    virtual bool Open(int width, int height) = 0;
+    virtual void Write(const uBYTE* frame) = 0;
+    virtual void Close() = 0;
+
+    // Whether frames are thrown away.
+    virtual bool IsNull() { return false; }
+};
+
+#endif
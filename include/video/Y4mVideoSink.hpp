@@ -0,0 +1,72 @@
+#ifndef Y4M_VIDEO_SINK_HPP
+#define Y4M_VIDEO_SINK_HPP
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "video/VideoSink.hpp"
+#include "RingBuffer.hpp"
+
+// Room for a dozen or so frames between the emulation and the writer thread.
+#define Y4M_RING_BUFFER_SIZE (1 << 20)
+
+// Streams frames as uncompressed YUV4MPEG2 to a file, a named pipe or the
+// standard output (when the path is "-"), e.g. to be encoded by ffmpeg.
+//
+// Frames are stored in full range BT.601 YUV 4:4:4. Chroma is not
+// subsampled, as it would otherwise bleed between the screen's pixels.
+// The conversion and the writing happen on a dedicated thread, the
+// emulation thread only copies the frame into a ring.
+class Y4mVideoSink : public VideoSink {
+
+public:
+    Y4mVideoSink(std::string path);
+
+    bool Open(int width, int height) override;
+    void Write(const uBYTE* frame) override;
+    void Close() override;
+
+    static void ConvertToYuv(const uBYTE* frame, int pixelCount, uBYTE* y, uBYTE* u, uBYTE* v);
+
+private:
+    void WriterRoutine();
+    void writeFrame(const uBYTE* frame);
+    void writeBytes(const void* data, size_t size);
+
+    std::string path;
+    int fd;
+    int width;
+    int height;
+    size_t frameSize;
+
+    std::atomic<bool> writerRunning;
+    std::mutex writerMtx;
+    std::unique_ptr<std::thread> writer;
+    std::condition_variable writerCv;
+    std::condition_variable ringSpaceCv;
+    RingBuffer frameRing;
+
+    // Frame being converted, and its planes.
+    std::vector<uBYTE> frame;
+    std::vector<uBYTE> planes;
+};
+
+#endif
@@ -15,55 +15,68 @@ int determineChannelFrequency(bool direction, uBYTE shiftAmount, int shadowFrequ
 uBYTE applyVolume(uBYTE rawVolume, uBYTE maxValue, uBYTE amplitude);
 uBYTE determineSquareWavePattern(uBYTE nrx1);
 int determineSquareWaveFrequencyTimerValue(uBYTE hiByte, uBYTE loByte, uBYTE multiplier);
-
-Apu::Apu() {
-    // Sampling specification for the pulse audio client
-    //
-    // Format:      Unsigned 8-bit PCM encoded sound data. This is the same format
-    //              of the data that the DMG Gameboy sent to its DAC, and produces
-    //              the iconic retro tones.
-    //  Rate:       48000Hz sampling rate. This essentially means this emulator is sending the
-    //              audio server 48000 PCM data points per second.
-    //  Channels:   2. This is because the original DMG supported stereo sound with its two output speakers.
-    pa_sample_spec samplingSpec = pa_sample_spec();
-    samplingSpec.format = PA_SAMPLE_U8;
-    samplingSpec.rate = AUDIO_SAMPLING_FREQUENCY_HZ;
-    samplingSpec.channels = 2;
-
-    // Initialize the pulse audio client
-    int errorCode = 0;
-    audioClient = pa_simple_new(NULL,
-        "FuuGBEmuAPU",
-        PA_STREAM_PLAYBACK,
-        NULL,
-        "FuuGBEmuAPU",
-        &samplingSpec,
-        NULL,
-        NULL,
-        &errorCode);
-
-    // Error checking
-    if (errorCode) {
-        fprintf(stderr, "error initializing audio: %s\n", pa_strerror(errorCode));
-        exit(EXIT_FAILURE);
+int determineNoiseFrequencyTimerValue(uBYTE nr43);
+
+// Output sequences of the noise channel's LFSR, starting from the all-ones state
+// it is reset to on trigger. One bit per LFSR clock, set when the output is high.
+struct LfsrSequences {
+    uint32_t lfsr15[(LFSR15_SEQUENCE_LENGTH + 31) / 32];
+    uint32_t lfsr7[(LFSR7_SEQUENCE_LENGTH + 31) / 32];
+
+    LfsrSequences() {
+        memset(lfsr15, 0x00, sizeof(lfsr15));
+        memset(lfsr7, 0x00, sizeof(lfsr7));
+        generate(lfsr15, LFSR15_SEQUENCE_LENGTH, false);
+        generate(lfsr7, LFSR7_SEQUENCE_LENGTH, true);
     }
 
-    // This timer controls when the APU samples the DMG's sound channels.
-    // Since the DMG gameboy's CPU executes 4194304 cycles per second, and
-    // that our sampling rate is 48000 samples per second, taking the division of
-    // these two quantities will produce the amount of CPU cycles / sample that need
-    // to have been executed before adding a sample to our audio buffer. 
-    // (4194304 cycles/s / 48000 samples/s = ~87 cycles/sample)
-    addToBufferTimer = CPU_FREQUENCY_HZ / AUDIO_SAMPLING_FREQUENCY_HZ;
+    // Each clock XORs bits 0 and 1, shifts the register right and places the
+    // result in bit 14 (and also bit 6 in 7-bit mode). The channel outputs
+    // the inverse of bit 0.
+    static void generate(uint32_t* sequence, int length, bool widthMode) {
+        uWORD lfsr = 0x7FFF;
+
+        for (int i = 0; i < length; i++) {
+            if (!(lfsr & 1))
+                sequence[i / 32] |= (1u << (i % 32));
+
+            uWORD result = (lfsr & 1) ^ ((lfsr >> 1) & 1);
+            lfsr = (lfsr >> 1) | (result << 14);
+
+            if (widthMode)
+                lfsr = (lfsr & ~(1 << 6)) | (result << 6);
+        }
+    }
+};
+
+static const LfsrSequences lfsrSequences;
+
+Apu::Apu() : audioRing(AUDIO_RING_BUFFER_SIZE) {
+    // The channels are clocked by the CPU, which executes 4194304 cycles per second,
+    // while the audio server expects 48000 samples per second by default. The blip
+    // buffers convert between the two; the ratio is nudged slightly by dynamic rate control.
+    rateAdjustment = 1.0;
+    SetOutputFormat(AudioMixer::SAMPLE_FORMAT_S16, AUDIO_SAMPLING_FREQUENCY_HZ);
+    frameTime = 0;
+    synthesizing = false;
+    pendingCycles = 0;
+    registerWritten = false;
+    memset(channelOutput, 0x00, APU_CHANNEL_COUNT);
+    nr50 = 0;
+    nr51 = 0;
+    nr52 = 0;
+    syncToAudio = false;
 
     // Square wave with frequency sweep - Channel 1
     ch1Disabled = true;
+    ch1SweepEnabled = false;
     ch1VolumeTimer = 0;
+    ch1CurrentVolume = 0;
     ch1WaveDutyPointer = 0;
     ch1ShadowFrequency = 0;
     ch1LengthTimer = 1;
     ch1FrequencyTimer = 0;
-    ch1VolumeTimer = 0;
+    ch1SweepTimer = 0;
 
     // Square wave - Channel 2
     ch2VolumeTimer = 0;
@@ -80,6 +93,23 @@ Apu::Apu() {
     ch3LengthTimer = 1;
     ch3SamplePointer = 0;
 
+    // Noise - Channel 4
+    ch4Disabled = true;
+    ch4FrequencyTimer = 0;
+    ch4VolumeTimer = 0;
+    ch4LfsrPosition = 0;
+    ch4LengthTimer = 1;
+    ch4CurrentVolume = 0;
+
+    // Decoded register values, refreshed once attached to a memory unit.
+    ch1Frequency = 0;
+    ch2Frequency = 0;
+    ch3Frequency = 0;
+    for (uWORD addr = NR10; addr <= NR52; addr++) {
+        DecodeRegister(addr, 0x00);
+    }
+    memset(ch3WaveSamples, 0x00, sizeof(ch3WaveSamples));
+
     // Pointer in audio buffer for placement of the next audio samples.
     currentSampleBufferPosition = 0;
 
@@ -91,432 +121,888 @@ Apu::Apu() {
     // Emulator specific channel toggles
     debuggerCh1Toggle = true;
     debuggerCh2Toggle = true;
+    debuggerCh4Toggle = true;
 
-    memset(audioBuffer, 0x00, AUDIO_BUFFER_SIZE);
+    memset(audioBuffer, 0x00, sizeof(audioBuffer));
+
+    flusherRunning = false;
+    underrunCount = 0;
+    overrunCount = 0;
 }
 
+// Attaches the apu to a memory unit, which then forwards
+// writes to the sound registers to the apu.
 void Apu::SetMemory(Memory* memRef) {
     this->memRef = memRef;
+    memRef->apuRef = this;
+    RefreshRegisters();
 }
 
-Apu::~Apu() {
-    // Drain any remaining audio samples sent to the audio server.
-    int errorCode = 0;
-    pa_simple_drain(audioClient, &errorCode);
-    if (errorCode) {
-#ifdef FUUGB_DEBUG
-        fprintf(stderr, "error flushing audio buffer: %s\n", pa_strerror(errorCode));
-#endif
+// Selects the format and rate of the samples sent to the audio sink.
+// Must be called before the sink is attached.
+void Apu::SetOutputFormat(AudioMixer::SampleFormat format, int sampleRate) {
+    this->sampleFormat = format;
+    this->sampleRate = sampleRate;
+    frameSize = AudioMixer::FrameSize(format);
+    currentSampleBufferPosition = 0;
+
+    for (int i = 0; i < APU_CHANNEL_COUNT; i++) {
+        channelBuffers[i].SetRates(CPU_FREQUENCY_HZ, sampleRate * rateAdjustment);
+    }
+    mixer.SetSampleRate(sampleRate);
+}
+
+// Attaches the sink that the mixed samples are sent to, opening it with the
+// format and rate previously selected. Until this is called, the apu is
+// emulated as usual but its samples are discarded.
+void Apu::SetAudioSink(std::unique_ptr<AudioSink> sink) {
+    if (!sink->Open(sampleFormat, sampleRate)) {
+        fprintf(stderr, "error opening audio output\n");
         exit(EXIT_FAILURE);
     }
 
-    pa_simple_free(audioClient);
+    this->sink = std::move(sink);
+    synthesizing = !this->sink->IsNull();
+    if (!synthesizing)
+        return;
+
+    // Writing to the sink may block, such as whenever the audio server's
+    // buffers are full, so it is done from a dedicated thread rather than
+    // the emulation thread.
+    flusherRunning = true;
+    apuFlusher = std::unique_ptr<std::thread>(new std::thread(&Apu::FlusherRoutine, this));
+}
+
+void Apu::SaveState(State& state) {
+    CatchUp();
+
+    state.frameSequencerTimer = frameSequencerTimer;
+    state.frameSequencerStep = frameSequencerStep;
+
+    state.frameTime = frameTime;
+    memcpy(state.channelOutput, channelOutput, sizeof(channelOutput));
+
+    state.ch1Disabled = ch1Disabled;
+    state.ch1SweepEnabled = ch1SweepEnabled;
+    state.ch1ShadowFrequency = ch1ShadowFrequency;
+    state.ch1FrequencyTimer = ch1FrequencyTimer;
+    state.ch1VolumeTimer = ch1VolumeTimer;
+    state.ch1CurrentVolume = ch1CurrentVolume;
+    state.ch1SweepTimer = ch1SweepTimer;
+    state.ch1LengthTimer = ch1LengthTimer;
+    state.ch1WaveDutyPointer = ch1WaveDutyPointer;
+
+    state.ch2Disabled = ch2Disabled;
+    state.ch2VolumeTimer = ch2VolumeTimer;
+    state.ch2FrequencyTimer = ch2FrequencyTimer;
+    state.ch2LengthTimer = ch2LengthTimer;
+    state.ch2WaveDutyPointer = ch2WaveDutyPointer;
+    state.ch2CurrentVolume = ch2CurrentVolume;
+
+    state.ch3Disabled = ch3Disabled;
+    state.ch3FrequencyTimer = ch3FrequencyTimer;
+    state.ch3LengthTimer = ch3LengthTimer;
+    state.ch3WavePointer = ch3WavePointer;
+    state.ch3SamplePointer = ch3SamplePointer;
+
+    state.ch4Disabled = ch4Disabled;
+    state.ch4FrequencyTimer = ch4FrequencyTimer;
+    state.ch4VolumeTimer = ch4VolumeTimer;
+    state.ch4LfsrPosition = ch4LfsrPosition;
+    state.ch4LengthTimer = ch4LengthTimer;
+    state.ch4CurrentVolume = ch4CurrentVolume;
+}
+
+void Apu::LoadState(const State& state) {
+    frameSequencerTimer = state.frameSequencerTimer;
+    frameSequencerStep = state.frameSequencerStep;
+
+    frameTime = state.frameTime;
+    pendingCycles = 0;
+    registerWritten = false;
+    memcpy(channelOutput, state.channelOutput, sizeof(channelOutput));
+
+    ch1Disabled = state.ch1Disabled;
+    ch1SweepEnabled = state.ch1SweepEnabled;
+    ch1ShadowFrequency = state.ch1ShadowFrequency;
+    ch1FrequencyTimer = state.ch1FrequencyTimer;
+    ch1VolumeTimer = state.ch1VolumeTimer;
+    ch1CurrentVolume = state.ch1CurrentVolume;
+    ch1SweepTimer = state.ch1SweepTimer;
+    ch1LengthTimer = state.ch1LengthTimer;
+    ch1WaveDutyPointer = state.ch1WaveDutyPointer;
+
+    ch2Disabled = state.ch2Disabled;
+    ch2VolumeTimer = state.ch2VolumeTimer;
+    ch2FrequencyTimer = state.ch2FrequencyTimer;
+    ch2LengthTimer = state.ch2LengthTimer;
+    ch2WaveDutyPointer = state.ch2WaveDutyPointer;
+    ch2CurrentVolume = state.ch2CurrentVolume;
+
+    ch3Disabled = state.ch3Disabled;
+    ch3FrequencyTimer = state.ch3FrequencyTimer;
+    ch3LengthTimer = state.ch3LengthTimer;
+    ch3WavePointer = state.ch3WavePointer;
+    ch3SamplePointer = state.ch3SamplePointer;
+
+    ch4Disabled = state.ch4Disabled;
+    ch4FrequencyTimer = state.ch4FrequencyTimer;
+    ch4VolumeTimer = state.ch4VolumeTimer;
+    ch4LfsrPosition = state.ch4LfsrPosition;
+    ch4LengthTimer = state.ch4LengthTimer;
+    ch4CurrentVolume = state.ch4CurrentVolume;
+
+    // The registers are restored along with the memory unit.
+    RefreshRegisters();
+}
+
+Apu::~Apu() {
+    if (sink == NULL)
+        return;
+
+    if (apuFlusher != NULL) {
+        flusherRunning = false;
+        flusherCv.notify_one();
+        apuFlusher->join();
+
+        // Hand over whatever the flusher had not gotten to yet, so that
+        // recordings aren't cut short.
+        uBYTE samples[AUDIO_BUFFER_FRAMES * AUDIO_MAX_FRAME_SIZE];
+        while (audioRing.Size() > 0) {
+            size_t size = std::min(audioRing.Size(), sizeof(samples));
+            audioRing.Read(samples, size);
+            sink->Write(samples, size);
+        }
+
+        if (currentSampleBufferPosition > 0) {
+            sink->Write(audioBuffer, currentSampleBufferPosition * frameSize);
+        }
+    }
+
+    sink->Close();
+}
+
+void Apu::SetSyncToAudio(bool enabled) {
+    syncToAudio = enabled;
+}
+
+// Whether the samples go anywhere. If not, there is no need to synthesize them.
+bool Apu::HasAudioOutput() {
+    return sink != NULL && !sink->IsNull();
+}
+
+// Whether the samples are consumed at playback speed, which the emulation can be paced to.
+bool Apu::HasRealTimeAudioOutput() {
+    return HasAudioOutput() && sink->IsRealTime();
+}
+
+double Apu::GetRateAdjustment() {
+    return rateAdjustment;
+}
+
+// Fraction of the ring holding samples not yet handed to the sink.
+double Apu::GetAudioRingFill() {
+    return (double)audioRing.Size() / audioRing.Capacity();
 }
 
+uint64_t Apu::GetUnderrunCount() {
+    return underrunCount;
+}
+
+uint64_t Apu::GetOverrunCount() {
+    return overrunCount;
+}
+
+// Hands a full sample buffer over to the flusher thread. If the flusher has
+// fallen too far behind, the buffer is dropped rather than stalling emulation,
+// unless the sink records the samples, in which case none may be lost.
 void Apu::FlushBuffer() {
-    int errorCode = 0;
-    pa_simple_write(audioClient, audioBuffer, AUDIO_BUFFER_SIZE, &errorCode);
-    if (errorCode) {
-#ifdef FUUGB_DEBUG
-        fprintf(stderr, "error playing back audio: %s\n", pa_strerror(errorCode));
-#endif
-        exit(EXIT_FAILURE);
+    TRACE_ZONE("Apu::FlushBuffer");
+
+    if (!HasAudioOutput())
+        return;
+
+    size_t bufferSize = AUDIO_BUFFER_FRAMES * frameSize;
+
+    if (!sink->IsRealTime()) {
+        std::unique_lock<std::mutex> lock(flusherMtx);
+        while (flusherRunning && audioRing.Capacity() - audioRing.Size() < bufferSize) {
+            ringSpaceCv.wait_for(lock, std::chrono::milliseconds(5));
+        }
+    } else if (syncToAudio) {
+        std::unique_lock<std::mutex> lock(flusherMtx);
+        while (flusherRunning && audioRing.Size() > (size_t)(AUDIO_RING_TARGET_FILL * frameSize)) {
+            ringSpaceCv.wait_for(lock, std::chrono::milliseconds(5));
+        }
+    }
+
+    if (audioRing.Capacity() - audioRing.Size() < bufferSize) {
+        overrunCount++;
+        return;
     }
+
+    audioRing.Write(audioBuffer, bufferSize);
+    flusherCv.notify_one();
 }
 
-// Main sound routine for the APU.
+void Apu::FlusherRoutine() {
+    TRACE_THREAD("Audio flusher");
+
+    uBYTE samples[AUDIO_BUFFER_FRAMES * AUDIO_MAX_FRAME_SIZE];
+    size_t bufferSize = AUDIO_BUFFER_FRAMES * frameSize;
+
+    // Amount of time an audio device takes to play back a single buffer.
+    const std::chrono::microseconds bufferPeriod((1000000LL * AUDIO_BUFFER_FRAMES) / sampleRate);
+
+    while (flusherRunning) {
+        if (audioRing.Size() < bufferSize) {
+            std::unique_lock<std::mutex> lock(flusherMtx);
+            bool ready = flusherCv.wait_for(lock, bufferPeriod, [this, bufferSize] {
+                return !flusherRunning || audioRing.Size() >= bufferSize;
+            });
+
+            if (!ready && sink->IsRealTime()) {
+                underrunCount++;
+            }
+            continue;
+        }
+
+        audioRing.Read(samples, bufferSize);
+        ringSpaceCv.notify_one();
+
+        TRACE_ZONE("AudioSink::Write");
+        sink->Write(samples, bufferSize);
+    }
+}
+
+// Main sound routine for the APU, called after every instruction or batch
+// of them. Nothing the channels do between frame sequencer ticks is seen by
+// the rest of the machine, so the cycles are only accumulated, and the
+// channels run for all of them at once when something depends on them: a
+// tick, a write to a register, the end of the frame or a state save.
 void Apu::UpdateSound(int cycles) {
+    if (!registerWritten && pendingCycles + cycles < frameSequencerTimer) {
+        pendingCycles += cycles;
+        return;
+    }
+
+    // The cycles before those that tick the frame sequencer are run first,
+    // so that the tick happens at the same update it always did. The same
+    // goes for the update ending with an instruction that wrote to a
+    // register, at the end of which the channels' new output is reported.
+    registerWritten = false;
+    CatchUp();
+    RunCycles(cycles);
+}
+
+// Runs the channels for the cycles UpdateSound accumulated.
+void Apu::CatchUp() {
+    if (pendingCycles == 0)
+        return;
+
+    int cycles = pendingCycles;
+    pendingCycles = 0;
+    RunCycles(cycles);
+}
+
+void Apu::RunCycles(int cycles) {
+    BENCHMARK_ZONE(apuTicks);
+
     UpdateFrameSequencer(cycles);
 
-    // Compute the individual channels' amplitudes.
+    // Update the individual channels.
     // The original DMG has 4 distinct sounds that it can produce:
     //      1.  Square wave with a frequency sweep function
     //      2.  Square wave
     //      3.  Cartridge defined sound
     //      4.  Noise
-    // Here we have to keep track of two copies of all channel's amplitudes;
-    // one for the left output and another for the right output (stereo sound).
-    uBYTE leftCh1Amplitude = ComputeChannel1Amplitude(cycles);
-    uBYTE leftCh2Amplitude = ComputeChannel2Amplitude(cycles);
-    uBYTE leftCh3Amplitude = ComputeChannel3Amplitude(cycles);
-    uBYTE rightCh1Amplitude = leftCh1Amplitude;
-    uBYTE rightCh2Amplitude = leftCh2Amplitude;
-    uBYTE rightCh3Amplitude = leftCh3Amplitude;
+    // Each channel reports the moments within these cycles at which its output changes.
+    UpdateChannel1(cycles);
+    UpdateChannel2(cycles);
+    UpdateChannel3(cycles);
+    UpdateChannel4(cycles);
 
-    // NR50 - Enable Left (bit 7) (Unused) / Left speaker volume (bit 6-4) / Enable Right (bit 3) (Unused) / Right speaker volume bit (2-0)
-    // https://gbdev.io/pandocs/Sound_Controller.html#ff24---nr50---channel-control--on-off--volume-rw
-    uBYTE nr50 = memRef->rom[NR50];
+    frameTime += cycles;
+}
 
-    // NR51 - Sound panning for Channel 1,2,3 and 4.
-    // https://gbdev.io/pandocs/Sound_Controller.html#ff25---nr51---selection-of-sound-output-terminal-rw
-    uBYTE nr51 = memRef->rom[NR51];
+// Called by the memory unit whenever a sound register or the wave RAM is written to.
+void Apu::WriteRegister(uWORD addr, uBYTE data) {
+    CatchUp();
+    registerWritten = true;
+    DecodeRegister(addr, data);
+
+    switch (addr) {
+    // If the CPU wrote a value to NRx1, then this indicates that we
+    // need to restore the length timer's value with the length period.
+    case NR11: ch1LengthTimer = 64 - ch1LengthPeriod; break;
+    case NR21: ch2LengthTimer = 64 - ch2LengthPeriod; break;
+    case NR31: ch3LengthTimer = 255 - ch3LengthPeriod; break;
+    case NR41: ch4LengthTimer = 64 - ch4LengthPeriod; break;
+
+    // Writing a byte with bit 7 set to NRx4 causes a trigger event for the channel.
+    case NR14: if (data & (1 << 7)) TriggerChannel1(); break;
+    case NR24: if (data & (1 << 7)) TriggerChannel2(); break;
+    case NR34: if (data & (1 << 7)) TriggerChannel3(); break;
+    case NR44: if (data & (1 << 7)) TriggerChannel4(); break;
+    }
+}
 
-    // NR52 - Master sound enable (bit 7) / Channel 1,2,3 and 4 Enable (bits 3-0, respectively)
-    // https://gbdev.io/pandocs/Sound_Controller.html#ff26---nr52---sound-onoff
-    uBYTE nr52 = memRef->rom[NR52];
+// Decodes every register from memory again, for when the memory
+// unit's contents were replaced without going through its writes.
+void Apu::RefreshRegisters() {
+    CatchUp();
 
-    bool ch1LeftEnabled = nr51 & (1 << 4);
-    bool ch2LeftEnabled = nr51 & (1 << 5);
-    bool ch3LeftEnabled = nr51 & (1 << 6);
-    // bool ch4LeftEnabled = nr51 & (1 << 7);
+    for (uWORD addr = NR10; addr <= NR52; addr++) {
+        DecodeRegister(addr, memRef->peek(addr));
+    }
 
-    bool ch1RightEnabled = nr51 & (1 << 0);
-    bool ch2RightEnabled = nr51 & (1 << 1);
-    bool ch3RightEnabled = nr51 & (1 << 2);
-    // bool ch4RightEnabled = nr51 & (1 << 3);
+    for (uWORD addr = WAVE_RAM; addr < WAVE_RAM + 16; addr++) {
+        DecodeRegister(addr, memRef->peek(addr));
+    }
+}
 
-    if (!ch1LeftEnabled)
-        leftCh1Amplitude = 0;
+void Apu::DecodeRegister(uWORD addr, uBYTE data) {
+    switch (addr) {
+    // NR10 - Sweep period (bits 6-4) / Sweep direction (bit 3, set for decreasing) / Sweep shift (bits 2-0)
+    case NR10:
+        ch1SweepPeriod = (data & 0b01110000) >> 4;
+        ch1SweepDirection = (data & 0b00001000) ? DECREASING : INCREASING;
+        ch1SweepShift = data & 0b00000111;
+        break;
 
-    if (!ch1RightEnabled)
-        rightCh1Amplitude = 0;
+    // NRx1 - Wave pattern duty (bits 7-6) / Length period (bits 5-0)
+    case NR11:
+        ch1WavePattern = determineSquareWavePattern(data);
+        ch1LengthPeriod = data & 0b00111111;
+        break;
+    case NR21:
+        ch2WavePattern = determineSquareWavePattern(data);
+        ch2LengthPeriod = data & 0b00111111;
+        break;
+    case NR31:
+        ch3LengthPeriod = data;
+        break;
+    case NR41:
+        ch4LengthPeriod = data & 0b00111111;
+        break;
 
-    if (!ch2LeftEnabled)
-        leftCh2Amplitude = 0;
+    // NRx2 - Initial volume (bits 7-4) / Envelope direction (bit 3, set for increasing) / Envelope period (bits 2-0)
+    case NR12:
+        ch1InitialVolume = (data & 0b11110000) >> 4;
+        ch1VolumeDirection = data & (1 << 3);
+        ch1VolumePeriod = data & 0b00000111;
+        break;
+    case NR22:
+        ch2InitialVolume = (data & 0b11110000) >> 4;
+        ch2VolumeDirection = data & (1 << 3);
+        ch2VolumePeriod = data & 0b00000111;
+        break;
+    case NR42:
+        ch4InitialVolume = (data & 0b11110000) >> 4;
+        ch4VolumeDirection = data & (1 << 3);
+        ch4VolumePeriod = data & 0b00000111;
+        break;
 
-    if (!ch2RightEnabled)
-        rightCh2Amplitude = 0;
+    // NR30 - Channel 3 on/off (bit 7)
+    case NR30:
+        ch3Enabled = data & (1 << 7);
+        break;
 
-    if (!ch3LeftEnabled)
-        leftCh3Amplitude = 0;
+    // NR32 - Channel 3 output level (bits 6-5), as the amount to shift the wave samples by.
+    case NR32:
+        switch ((data & 0b01100000) >> 5) {
+        case 0: ch3VolumeShift = 4; break;
+        case 1: ch3VolumeShift = 0; break;
+        case 2: ch3VolumeShift = 1; break;
+        case 3: ch3VolumeShift = 2; break;
+        }
+        break;
 
-    if (!ch3RightEnabled)
-        rightCh3Amplitude = 0;
+    // NRx3 - Frequency lo (8 bit value)
+    case NR13:
+        ch1Frequency = (ch1Frequency & 0x700) | data;
+        ch1Period = determineSquareWaveFrequencyTimerValue(ch1Frequency >> 8, ch1Frequency & 0xFF, 4);
+        break;
+    case NR23:
+        ch2Frequency = (ch2Frequency & 0x700) | data;
+        ch2Period = determineSquareWaveFrequencyTimerValue(ch2Frequency >> 8, ch2Frequency & 0xFF, 4);
+        break;
+    case NR33:
+        ch3Frequency = (ch3Frequency & 0x700) | data;
+        ch3Period = determineSquareWaveFrequencyTimerValue(ch3Frequency >> 8, ch3Frequency & 0xFF, 2);
+        break;
 
-    // Mix the amplitudes of all channels
-    uBYTE leftSample = (leftCh1Amplitude + leftCh2Amplitude + leftCh3Amplitude) / 3;
-    uBYTE rightSample = (rightCh1Amplitude + rightCh2Amplitude + rightCh3Amplitude) / 3;
+    // NR43 - Clock shift (bits 7-4) / LFSR width mode (bit 3) / Divisor code (bits 2-0)
+    case NR43:
+        ch4WidthMode = data & (1 << 3);
+        ch4Period = determineNoiseFrequencyTimerValue(data);
+        break;
 
-    // Apply left volume
-    leftSample = applyVolume((nr50 & (0b01110000)) >> 4, 0x7, leftSample);
+    // NRx4 - Trigger (bit 7) / Length enable (bit 6) / Frequency hi (bits 2-0)
+    case NR14:
+        ch1Frequency = (ch1Frequency & 0xFF) | ((data & 0x7) << 8);
+        ch1Period = determineSquareWaveFrequencyTimerValue(ch1Frequency >> 8, ch1Frequency & 0xFF, 4);
+        ch1LengthEnabled = data & (1 << 6);
+        break;
+    case NR24:
+        ch2Frequency = (ch2Frequency & 0xFF) | ((data & 0x7) << 8);
+        ch2Period = determineSquareWaveFrequencyTimerValue(ch2Frequency >> 8, ch2Frequency & 0xFF, 4);
+        ch2LengthEnabled = data & (1 << 6);
+        break;
+    case NR34:
+        ch3Frequency = (ch3Frequency & 0xFF) | ((data & 0x7) << 8);
+        ch3Period = determineSquareWaveFrequencyTimerValue(ch3Frequency >> 8, ch3Frequency & 0xFF, 2);
+        ch3LengthEnabled = data & (1 << 6);
+        break;
+    case NR44:
+        ch4LengthEnabled = data & (1 << 6);
+        break;
 
-    // Apply Right volume
-    rightSample = applyVolume((nr50 & (0b00000111)), 0x7, rightSample);
+    case NR50: nr50 = data; break;
+    case NR51: nr51 = data; break;
+    case NR52: nr52 = data; break;
 
-    // First, check if it is time to add a sample to the
-    // audio buffer. We only need to send samples every
-    // CPU_FREQUENCY_HZ / AUDIO_SAMPLING_FREQUENCY_HZ cycles.
-    addToBufferTimer -= cycles;
-    if (addToBufferTimer > 0)
-        return;
+    // The wave RAM holds 32 4-bit samples, the upper nibble of each byte being played first.
+    default:
+        if (addr >= WAVE_RAM && addr < WAVE_RAM + 16) {
+            ch3WaveSamples[(addr - WAVE_RAM) * 2] = (data & 0b11110000) >> 4;
+            ch3WaveSamples[((addr - WAVE_RAM) * 2) + 1] = data & 0b00001111;
+        }
+        break;
+    }
+}
 
-    // If it is time to add new samples, refresh the timer value.
-    // Here we add addToBufferTimer's cycles that might've resulted in a negative value, for better accuracy.
-    addToBufferTimer = (CPU_FREQUENCY_HZ / AUDIO_SAMPLING_FREQUENCY_HZ) + addToBufferTimer;
-
-    // Stuff the current samples in the buffer,
-    // Since we are dealing with stereo sound, and that the audio client has been
-    // configured with 2 channels, the audio samples must be interleaved in the following fashion:
-    // LR,LR,LR,...
-    audioBuffer[currentSampleBufferPosition++] = leftSample;
-    audioBuffer[currentSampleBufferPosition++] = rightSample;
-
-    // Play the sound if the buffer is full.
-    // Reset the buffer pointer back to 0.
-    // Optimization: only flush the buffer if at least one entry is non-zero.
-    if (currentSampleBufferPosition >= AUDIO_BUFFER_SIZE) {
-        currentSampleBufferPosition = 0;
-
-        // If bit 7 of NR52 is reset, this means that the volume
-        // is completely shut off. Only flush the buffer if the master
-        // switch is ON.
-        if ((nr52 & (1 << 7))) {
-            FlushBuffer();
+// Trigger event for channel 1 (when bit 7 of NR14 is set)
+// The following occur:
+//  - The channel is re-enabled
+//  - If the channel's length timer is 0, it is reloaded with value 64.
+//  - The channel's frequency timer is reloaded with nr14 | nr13
+//  - The volume timer for the volume envelope is refreshed with the volume period (bits 2-0 in NR12)
+//  - The current volume is refreshed with the initial volume (bits 7-4 in NR12)
+//  - The shadow frequency is refreshed with the current frequency
+//  - The frequency sweep timer is refreshed with the sweep period (bits 6-4 in NR10)
+//  - If the sweep  (or timer, in this case) was 0, the timer defaults to 8
+//  - If the sweep period OR the sweep shift amount are non-zero, then frequency sweeping is enabled
+//  - If the sweep shift is non-zero, recalculate the new frequency value to check if there's a resulting overflow
+//  - If there is an overflow, disable the channel
+void Apu::TriggerChannel1() {
+    ch1Disabled = false;
+
+    if (ch1LengthTimer == 0)
+        ch1LengthTimer = 64 - ch1LengthPeriod;
+
+    ch1FrequencyTimer = ch1Period;
+    ch1VolumeTimer = ch1VolumePeriod;
+    ch1CurrentVolume = ch1InitialVolume;
+    ch1ShadowFrequency = ch1Frequency;
+    ch1SweepTimer = ch1SweepPeriod;
+
+    if (ch1SweepTimer == 0)
+        ch1SweepTimer = 8;
+
+    ch1SweepEnabled = (ch1SweepPeriod > 0 || ch1SweepShift > 0);
+
+    if (ch1SweepShift > 0) {
+        if (determineChannelFrequency(ch1SweepDirection, ch1SweepShift, ch1ShadowFrequency) > 2047) {
+            ch1Disabled = true;
         }
     }
 }
 
-uBYTE Apu::ComputeChannel1Amplitude(int cycles) {
-    uBYTE ch1Amplitude = 0;
+// Trigger event for channel 2 (when bit 7 of NR24 is set)
+// The following occur:
+//  - The channel is re-enabled
+//  - If the channel's length timer is 0, it is reloaded with value 64.
+//  - The channel's frequency timer is reloaded with nr24 | nr23
+//  - The volume timer for the volume envelope is refreshed with the volume period (bits 2-0 in NR22)
+//  - The current volume is refreshed with the initial volume (bits 7-4 in NR22)
+void Apu::TriggerChannel2() {
+    ch2Disabled = false;
+
+    if (ch2LengthTimer == 0)
+        ch2LengthTimer = 64 - ch2LengthPeriod;
+
+    ch2FrequencyTimer = ch2Period;
+    ch2VolumeTimer = ch2VolumePeriod;
+    ch2CurrentVolume = ch2InitialVolume;
+}
+
+// Trigger event for channel 3 (when bit 7 of NR34 is set)
+// The following occur:
+//  - The channel is re-enabled
+//  - If the channel's length timer is 0, it is reloaded with value 256.
+//  - The channel's frequency timer is reloaded with nr34 | nr33
+void Apu::TriggerChannel3() {
+    ch3Disabled = false;
 
-    uBYTE nr10 = memRef->rom[NR10];
-    uBYTE nr11 = memRef->rom[NR11];
-    uBYTE nr12 = memRef->rom[NR12];
-    uBYTE nr13 = memRef->rom[NR13];
-    uBYTE nr14 = memRef->rom[NR14];
-
-    bool lengthEnabled = nr14 & (1 << 6);
-    bool volumeDirection = nr12 & (1 << 3);
-    uBYTE lengthPeriod = nr11 & 0b00111111;
-    uBYTE volumePeriod = nr12 & 0b00000111;
-    uBYTE initialVolume = (nr12 & 0b11110000) >> 4;
-
-    uBYTE sweepPeriod = (nr10 & (0b01110000)) >> 4;
-    uBYTE sweepShift = nr10 & 0b00000111;
-    bool sweepDirection = nr10 & 0b00001000;
-    bool sweepEnabled = false;
-
-    // Trigger event for channel 1 (when bit 7 of NR14 is set)
-    // The following occur:
-    //  - The channel is re-enabled
-    //  - If the channel's length timer is 0, it is reloaded with value 64.
-    //  - The channel's frequency timer is reloaded with nr14 | nr13
-    //  - The volume timer for the volume envelope is refreshed with the volume period (bits 2-0 in NR12)
-    //  - The current volume is refreshed with the initial volume (bits 7-4 in NR12)
-    //  - The shadow frequency is refreshed with the current frequency
-    //  - The frequency sweep timer is refreshed with the sweep period (bits 6-4 in NR10)
-    //  - If the sweep  (or timer, in this case) was 0, the timer defaults to 8
-    //  - If the sweep period OR the sweep shift amount are non-zero, then frequency sweeping is enabled
-    //  - If the sweep shift is non-zero, recalculate the new frequency value to check if there's a resulting overflow
-    //  - If there is an overflow, disable the channel
-    if (memRef->TriggerEventCh1()) {
-        ch1Disabled = false;
-
-        if (ch1LengthTimer == 0)
-            ch1LengthTimer = 64 - lengthPeriod;
-
-        ch1FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr14, nr13, 4);
-        ch1VolumeTimer = volumePeriod;
-        ch1CurrentVolume = initialVolume;
-        ch1ShadowFrequency = ch1FrequencyTimer;
-        ch1SweepTimer = sweepPeriod;
-
-        if (ch1SweepTimer == 0)
-            ch1SweepTimer = 8;
-
-        sweepEnabled = false;
-
-        if (sweepPeriod > 0 || sweepShift > 0)
-            sweepEnabled = true;
-
-        if (sweepShift > 0) {
-            ch1FrequencyTimer = determineChannelFrequency(sweepDirection, sweepShift, ch1ShadowFrequency);
-
-            if (ch1FrequencyTimer > 2047) {
-                ch1Disabled = true;
+    if (ch3LengthTimer == 0)
+        ch3LengthTimer = 255 - ch3LengthPeriod;
+
+    ch3FrequencyTimer = ch3Period;
+}
+
+// Trigger event for channel 4 (when bit 7 of NR44 is set)
+// The following occur:
+//  - The channel is re-enabled
+//  - If the channel's length timer is 0, it is reloaded with value 64.
+//  - The channel's frequency timer is reloaded from the divisor and shift in NR43
+//  - The volume timer for the volume envelope is refreshed with the volume period (bits 2-0 in NR42)
+//  - The current volume is refreshed with the initial volume (bits 7-4 in NR42)
+//  - The LFSR's bits are all set, which is the start of the output sequences
+void Apu::TriggerChannel4() {
+    ch4Disabled = false;
+
+    if (ch4LengthTimer == 0)
+        ch4LengthTimer = 64 - ch4LengthPeriod;
+
+    ch4FrequencyTimer = ch4Period;
+    ch4VolumeTimer = ch4VolumePeriod;
+    ch4CurrentVolume = ch4InitialVolume;
+    ch4LfsrPosition = 0;
+}
+
+// Records a channel's new output level, time being the cycle within the current frame at which it changed.
+void Apu::SetChannelOutput(int channel, uBYTE amplitude, int time) {
+    if (channelOutput[channel] == amplitude)
+        return;
+
+    if (synthesizing) {
+        channelBuffers[channel].AddDelta(time, (float)(amplitude - channelOutput[channel]));
+    }
+    channelOutput[channel] = amplitude;
+}
+
+// Derives each channel's left and right gains from the panning, master volume and master switch.
+void Apu::UpdateMixerGains() {
+    // NR50 - Enable Left (bit 7) (Unused) / Left speaker volume (bit 6-4) / Enable Right (bit 3) (Unused) / Right speaker volume bit (2-0)
+    // https://gbdev.io/pandocs/Sound_Controller.html#ff24---nr50---channel-control--on-off--volume-rw
+    float leftVolume = (((nr50 & 0b01110000) >> 4) + 1) / 8.0f;
+    float rightVolume = ((nr50 & 0b00000111) + 1) / 8.0f;
+
+    // NR52 - Master sound enable (bit 7)
+    // If bit 7 of NR52 is reset, this means that the volume is completely shut off.
+    // https://gbdev.io/pandocs/Sound_Controller.html#ff26---nr52---sound-onoff
+    if (!(nr52 & (1 << 7))) {
+        leftVolume = 0.0f;
+        rightVolume = 0.0f;
+    }
+
+    for (int channel = 0; channel < APU_CHANNEL_COUNT; channel++) {
+        // Channels output levels of up to 255, except for channel 3 whose
+        // wave samples only go up to 15. All of them together make full scale.
+        float scale = 1.0f / (255.0f * APU_CHANNEL_COUNT);
+        if (channel == 2)
+            scale *= 17.0f;
+
+        // NR51 - Sound panning for Channel 1,2,3 and 4.
+        // Bits 7-4 route channels 4-1 to the left output, bits 3-0 to the right output.
+        // https://gbdev.io/pandocs/Sound_Controller.html#ff25---nr51---selection-of-sound-output-terminal-rw
+        float left = (nr51 & (1 << (channel + 4))) ? leftVolume * scale : 0.0f;
+        float right = (nr51 & (1 << channel)) ? rightVolume * scale : 0.0f;
+
+        mixer.SetGains(channel, left, right);
+    }
+}
+
+// Turns the changes recorded during the frame into samples in one pass,
+// mixes them and hands them over to the flusher.
+void Apu::EndFrame() {
+    CatchUp();
+
+    // Without an audio output, no changes were recorded to turn into samples.
+    if (!synthesizing) {
+        frameTime = 0;
+        return;
+    }
+
+    for (int i = 0; i < APU_CHANNEL_COUNT; i++) {
+        channelBuffers[i].EndFrame(frameTime);
+    }
+    frameTime = 0;
+
+    UpdateMixerGains();
+
+    float channelSamples[APU_CHANNEL_COUNT][AUDIO_MIX_CHUNK_SIZE];
+    const float* channels[APU_CHANNEL_COUNT];
+    float leftSamples[AUDIO_MIX_CHUNK_SIZE];
+    float rightSamples[AUDIO_MIX_CHUNK_SIZE];
+
+    for (int i = 0; i < APU_CHANNEL_COUNT; i++) {
+        channels[i] = channelSamples[i];
+    }
+
+    while (channelBuffers[0].SamplesAvailable() > 0) {
+        int count = std::min(channelBuffers[0].SamplesAvailable(), AUDIO_MIX_CHUNK_SIZE);
+
+        for (int i = 0; i < APU_CHANNEL_COUNT; i++) {
+            channelBuffers[i].ReadSamples(channelSamples[i], count);
+        }
+
+        mixer.Mix(channels, APU_CHANNEL_COUNT, count, leftSamples, rightSamples);
+        mixer.Filter(leftSamples, rightSamples, count);
+
+        // Since we are dealing with stereo sound, and that the audio client has been
+        // configured with 2 channels, the audio samples must be interleaved in the following fashion:
+        // LR,LR,LR,...
+        // Play the sound every time the buffer is full.
+        for (int mixed = 0; mixed < count;) {
+            int frames = std::min(count - mixed, AUDIO_BUFFER_FRAMES - currentSampleBufferPosition);
+
+            AudioMixer::Interleave(leftSamples + mixed,
+                rightSamples + mixed,
+                frames,
+                sampleFormat,
+                audioBuffer + (currentSampleBufferPosition * frameSize));
+
+            mixed += frames;
+            currentSampleBufferPosition += frames;
+
+            if (currentSampleBufferPosition >= AUDIO_BUFFER_FRAMES) {
+                currentSampleBufferPosition = 0;
+                FlushBuffer();
             }
         }
     }
 
+    // The emulation and the audio device run off different clocks, so the ring
+    // slowly fills up or drains. Resample slightly faster when it is below its
+    // target fill level and slightly slower when above, which is inaudible at
+    // these amounts but keeps the latency stable. Sinks that record the samples
+    // have no clock of their own, and keep the exact rate so that their
+    // output is deterministic.
+    if (!sink->IsRealTime())
+        return;
+
+    double fill = (double)audioRing.Size() / (AUDIO_RING_TARGET_FILL * frameSize);
+    rateAdjustment = 1.0 + (AUDIO_MAX_RATE_DELTA * (1.0 - fill));
+    if (rateAdjustment < 1.0 - AUDIO_MAX_RATE_DELTA)
+        rateAdjustment = 1.0 - AUDIO_MAX_RATE_DELTA;
+    if (rateAdjustment > 1.0 + AUDIO_MAX_RATE_DELTA)
+        rateAdjustment = 1.0 + AUDIO_MAX_RATE_DELTA;
+
+    for (int i = 0; i < APU_CHANNEL_COUNT; i++) {
+        channelBuffers[i].SetRates(CPU_FREQUENCY_HZ, sampleRate * rateAdjustment);
+    }
+}
+
+void Apu::UpdateChannel1(int cycles) {
     // If the frame sequencer clocks a sweep tick,
     // apply the frequency sweep function.
-    if (sweepTick)
+    if (sweepTick) {
+        int frequency = ch1Frequency;
+
         frequencySweepFunction(ch1SweepTimer,
-            ch1FrequencyTimer,
+            frequency,
             ch1ShadowFrequency,
             ch1Disabled,
-            sweepEnabled,
-            sweepPeriod,
-            sweepDirection,
-            sweepShift);
+            ch1SweepEnabled,
+            ch1SweepPeriod,
+            ch1SweepDirection,
+            ch1SweepShift);
+
+        // The swept frequency is written back to NR13 and NR14.
+        if (frequency != ch1Frequency) {
+            memRef->poke(NR13, frequency & 0xFF);
+            memRef->poke(NR14, (memRef->peek(NR14) & 0b11111000) | (frequency >> 8));
+            DecodeRegister(NR13, memRef->peek(NR13));
+            DecodeRegister(NR14, memRef->peek(NR14));
+        }
+    }
+
+    // The amplitude of the wave pattern's high parts at the current volume.
+    // If the channel is disabled, or the user turned it off through the debugger, it drops to 0.
+    uBYTE highAmplitude = applyVolume(ch1CurrentVolume, 0xF, 255);
+    if (ch1Disabled || !debuggerCh1Toggle)
+        highAmplitude = 0;
 
     // substract the amount of cpu cycles that have occured from the
     // frequency timer.
     ch1FrequencyTimer -= cycles;
 
-    // If this results in the frequency timer reaching 0, then we
-    // reset the timer's value with what is in NR24 (bits 2-0) | NR23 (8 bit value).
-    // we also increment the wave pattern pointer when this happens.
-    if (ch1FrequencyTimer <= 0) {
-        ch1FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr14, nr13, 4) + ch1FrequencyTimer;
+    // Every time the frequency timer reaches 0, we reset the timer's value
+    // with the period and increment the wave pattern pointer. The pointer
+    // value can only be within 0-7, and loops back once it reaches 8.
+    // The timer going negative tells how many cycles ago the pointer moved,
+    // which is when the output changed.
+    while (ch1FrequencyTimer <= 0) {
+        int edgeTime = frameTime + cycles + ch1FrequencyTimer;
 
-        // The pointer value can only be within 0-7, and loops back once it
-        // reaches 8.
+        ch1FrequencyTimer = ch1Period + ch1FrequencyTimer;
         ch1WaveDutyPointer = (ch1WaveDutyPointer + 1) % 8;
-    }
 
-    // Fetch the raw wave amplitude for channel 1's wave pattern.
-    // If the bit at the pointer is '1', then the amplitude is at its maximum value of 255.
-    uBYTE wavePattern = determineSquareWavePattern(nr11);
-    if (wavePattern & (1 << ch1WaveDutyPointer))
-        ch1Amplitude = 255;
+        SetChannelOutput(0, (ch1WavePattern & (1 << ch1WaveDutyPointer)) ? highAmplitude : 0, edgeTime);
+    }
 
     // If the frame sequencer ticked a volume envelope, then apply the volume envelope on the volume.
     if (volumeEnvelopeTick)
-        volumeEnvelopeFunction(ch1VolumeTimer, ch1CurrentVolume, volumePeriod, volumeDirection);
-
-    // Apply volume to amplitude.
-    ch1Amplitude = applyVolume(ch1CurrentVolume, 0xF, ch1Amplitude);
-
-
-    // If the CPU wrote a value to NR11, then this indicates that we
-    // need to restore the timer's value with 64 - period.
-    if (memRef->RequiresCh1LengthReload())
-        ch1LengthTimer = 64 - lengthPeriod;
+        volumeEnvelopeFunction(ch1VolumeTimer, ch1CurrentVolume, ch1VolumePeriod, ch1VolumeDirection);
 
     // If the frame sequencer clocked a length tick, apply the length function to the channel.
-    if (lengthControlTick && lengthEnabled)
+    if (lengthControlTick && ch1LengthEnabled)
         lengthFunction(ch1LengthTimer, ch1Disabled);
 
-    // If channel is disabled, amplitude drops to 0.
-    if (ch1Disabled)
-        ch1Amplitude = 0;
+    // Fetch the raw wave amplitude for channel 1's wave pattern.
+    // If the bit at the pointer is '1', then the amplitude is at its maximum value of 255.
+    uBYTE ch1Amplitude = 0;
+    if (ch1WavePattern & (1 << ch1WaveDutyPointer))
+        ch1Amplitude = applyVolume(ch1CurrentVolume, 0xF, 255);
 
-    // If the user turned the channel off through the debugger, the amplitude drops to 0.
-    if (!debuggerCh1Toggle)
+    if (ch1Disabled || !debuggerCh1Toggle)
         ch1Amplitude = 0;
 
-    return ch1Amplitude;
+    SetChannelOutput(0, ch1Amplitude, frameTime + cycles);
 }
 
-uBYTE Apu::ComputeChannel2Amplitude(int cycles) {
-    uBYTE ch2Amplitude = 0;
-
-    uBYTE nr21 = memRef->rom[NR21];
-    uBYTE nr22 = memRef->rom[NR22];
-    uBYTE nr23 = memRef->rom[NR23];
-    uBYTE nr24 = memRef->rom[NR24];
-
-    bool lengthEnabled = nr24 & (1 << 6);
-    bool volumeDirection = nr22 & (1 << 3);
-    uBYTE lengthPeriod = nr21 & 0b00111111;
-    uBYTE volumePeriod = nr22 & 0b00000111;
-    uBYTE initialVolume = (nr22 & 0b11110000) >> 4;
-
-    // Trigger event for channel 2 (when bit 7 of NR24 is set)
-    // The following occur:
-    //  - The channel is re-enabled
-    //  - If the channel's length timer is 0, it is reloaded with value 64.
-    //  - The channel's frequency timer is reloaded with nr24 | nr23
-    //  - The volume timer for the volume envelope is refreshed with the volume period (bits 2-0 in NR22)
-    //  - The current volume is refreshed with the initial volume (bits 7-4 in NR22)
-    if (memRef->TriggerEventCh2()) {
-        ch2Disabled = false;
-
-        if (ch2LengthTimer == 0)
-            ch2LengthTimer = 64 - lengthPeriod;
-
-        ch2FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr24, nr23, 4);
-        ch2VolumeTimer = volumePeriod;
-        ch2CurrentVolume = initialVolume;
-    }
+void Apu::UpdateChannel2(int cycles) {
+    // The amplitude of the wave pattern's high parts at the current volume.
+    // If the channel is disabled, or the user turned it off through the debugger, it drops to 0.
+    uBYTE highAmplitude = applyVolume(ch2CurrentVolume, 0xF, 255);
+    if (ch2Disabled || !debuggerCh2Toggle)
+        highAmplitude = 0;
 
     // First, substract the amount of cpu cycles that have occured from the
     // frequency timer.
     ch2FrequencyTimer -= cycles;
 
-    // If this results in the frequency timer reaching 0, then we
-    // reset the timer's value with what is in NR24 (bits 2-0) | NR23 (8 bit value).
-    // we also increment the wave pattern pointer when this happens.
-    if (ch2FrequencyTimer <= 0) {
-        ch2FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr24, nr23, 4) + ch2FrequencyTimer;
+    // Every time the frequency timer reaches 0, we reset the timer's value
+    // with the period and increment the wave pattern pointer, at the cycle
+    // where the timer expired.
+    while (ch2FrequencyTimer <= 0) {
+        int edgeTime = frameTime + cycles + ch2FrequencyTimer;
 
-        // The pointer value can only be within 0-7, and loops back once it
-        // reaches 8.
+        ch2FrequencyTimer = ch2Period + ch2FrequencyTimer;
         ch2WaveDutyPointer = (ch2WaveDutyPointer + 1) % 8;
-    }
 
-    // Fetch the raw wave amplitude for channel 2's wave pattern.
-    // If the bit at the pointer is '1', then the amplitude is at its maximum value of 255.
-    uBYTE wavePattern = determineSquareWavePattern(nr21);
-    if (wavePattern & (1 << ch2WaveDutyPointer))
-        ch2Amplitude = 255;
+        SetChannelOutput(1, (ch2WavePattern & (1 << ch2WaveDutyPointer)) ? highAmplitude : 0, edgeTime);
+    }
 
     // If the frame sequencer ticked a volume envelope, then apply the volume envelope on the volume.
     if (volumeEnvelopeTick)
-        volumeEnvelopeFunction(ch2VolumeTimer, ch2CurrentVolume, volumePeriod, volumeDirection);
-
-    // Apply volume to amplitude.
-    ch2Amplitude = applyVolume(ch2CurrentVolume, 0xF, ch2Amplitude);
-
-    // If the CPU wrote a value to NR21, then this indicates that we
-    // need to restore the timer's value with 64 - period.
-    if (memRef->RequiresCh2LengthReload())
-        ch2LengthTimer = 64 - lengthPeriod;
+        volumeEnvelopeFunction(ch2VolumeTimer, ch2CurrentVolume, ch2VolumePeriod, ch2VolumeDirection);
 
     // If the frame sequencer clocked a length tick, apply the length function to the channel.
-    if (lengthControlTick && lengthEnabled)
+    if (lengthControlTick && ch2LengthEnabled)
         lengthFunction(ch2LengthTimer, ch2Disabled);
 
-    // If channel is disabled, amplitude drops to 0.
-    if (ch2Disabled)
-        ch2Amplitude = 0;
+    // Fetch the raw wave amplitude for channel 2's wave pattern.
+    // If the bit at the pointer is '1', then the amplitude is at its maximum value of 255.
+    uBYTE ch2Amplitude = 0;
+    if (ch2WavePattern & (1 << ch2WaveDutyPointer))
+        ch2Amplitude = applyVolume(ch2CurrentVolume, 0xF, 255);
 
-    // If the user turned the channel off through the debugger, the amplitude drops to 0.
-    if (!debuggerCh2Toggle)
+    if (ch2Disabled || !debuggerCh2Toggle)
         ch2Amplitude = 0;
 
-    return ch2Amplitude;
+    SetChannelOutput(1, ch2Amplitude, frameTime + cycles);
 }
 
-uBYTE Apu::ComputeChannel3Amplitude(int cycles) {
-    uBYTE ch3Amplitude = 0;
-
-    uBYTE nr30 = memRef->rom[NR30];
-    uBYTE nr31 = memRef->rom[NR31];
-    uBYTE nr32 = memRef->rom[NR32];
-    uBYTE nr33 = memRef->rom[NR33];
-    uBYTE nr34 = memRef->rom[NR34];
-
-    bool channelEnabled = nr30 & (1 << 7);
-    bool lengthEnabled = nr34 & (1 << 6);
-    uBYTE lengthPeriod = nr31;
-    uBYTE volumeShift = (nr32 & 0b01100000) >> 5;
-
-
-    // Trigger event for channel 3 (when bit 7 of NR34 is set)
-    // The following occur:
-    //  - The channel is re-enabled
-    //  - If the channel's length timer is 0, it is reloaded with value 256.
-    //  - The channel's frequency timer is reloaded with nr34 | nr33
-    if (memRef->TriggerEventCh3()) {
-        ch3Disabled = false;
-
-        if (ch3LengthTimer == 0)
-            ch3LengthTimer = 255 - lengthPeriod;
-
-        ch3FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr34, nr33, 2);
-    }
-
+void Apu::UpdateChannel3(int cycles) {
     // First, substract the amount of cpu cycles that have occured from the
     // frequency timer.
     ch3FrequencyTimer -= cycles;
 
-    // If this results in the frequency timer reaching 0, then we
-    // reset the timer's value with what is in NR24 (bits 2-0) | NR23 (8 bit value).
-    // we also increment the wave pattern pointer when this happens.
-    if (ch3FrequencyTimer <= 0) {
-        ch3FrequencyTimer = determineSquareWaveFrequencyTimerValue(nr34, nr33, 2) + ch3FrequencyTimer;
+    // Every time the frequency timer reaches 0, we reset the timer's value
+    // with the period and advance the wave pointer, at the cycle where the
+    // timer expired.
+    while (ch3FrequencyTimer <= 0) {
+        int edgeTime = frameTime + cycles + ch3FrequencyTimer;
+
+        ch3FrequencyTimer = ch3Period + ch3FrequencyTimer;
 
         // The pointer value can only be within 0-7, and loops back once it
         // reaches 8.
         ch3WavePointer = ch3WavePointer + 1;
 
-        // If the wave pointer equals 255, this means we have played an entire sample from the hi bits.
+        // If the wave pointer goes past 7, this means we have played an entire sample.
         // When this happens, we now play the next sample in the wave table which begins at FF30.
         // There are 16 samples in the wave table, which both contain 2 sub samples of 4-bit each.
         if (ch3WavePointer > 7) {
             ch3WavePointer = 0;
             ch3SamplePointer = (ch3SamplePointer + 1) % 16;
         }
+
+        if (!ch3Disabled && ch3Enabled) {
+            uBYTE sample = ch3WaveSamples[(ch3SamplePointer * 2) + (ch3WavePointer < 4 ? 0 : 1)];
+            SetChannelOutput(2, sample >> ch3VolumeShift, edgeTime);
+        }
     }
 
-    uBYTE wavePattern = memRef->rom[WAVE_RAM + ch3SamplePointer];
-    uBYTE upperSample = (wavePattern & 0b11110000) >> 4;
-    uBYTE lowerSample = (wavePattern & 0b00001111);
+    // If the frame sequencer clocked a length tick, apply the length function to the channel.
+    if (lengthControlTick && ch3LengthEnabled)
+        lengthFunction(ch3LengthTimer, ch3Disabled);
+
+    uBYTE ch3Amplitude = ch3WaveSamples[(ch3SamplePointer * 2) + (ch3WavePointer < 4 ? 0 : 1)] >> ch3VolumeShift;
 
-    uBYTE shiftAmount;
-    switch (volumeShift) {
-    case 0: shiftAmount = 4; break;
-    case 1: shiftAmount = 0; break;
-    case 2: shiftAmount = 1; break;
-    case 3: shiftAmount = 2; break;
-    default: shiftAmount = 4; break;
-    }
+    // If channel is disabled, amplitude drops to 0.
+    if (ch3Disabled || !ch3Enabled)
+        ch3Amplitude = 0;
+
+    SetChannelOutput(2, ch3Amplitude, frameTime + cycles);
+}
+
+void Apu::UpdateChannel4(int cycles) {
+    const uint32_t* sequence = ch4WidthMode ? lfsrSequences.lfsr7 : lfsrSequences.lfsr15;
+    int sequenceLength = ch4WidthMode ? LFSR7_SEQUENCE_LENGTH : LFSR15_SEQUENCE_LENGTH;
+
+    // The position may lie beyond the 7-bit sequence if the width mode was just changed.
+    ch4LfsrPosition %= sequenceLength;
+
+    // First, substract the amount of cpu cycles that have occured from the
+    // frequency timer.
+    ch4FrequencyTimer -= cycles;
+
+    // The LFSR is clocked every time the frequency timer reaches 0, which can be
+    // several times within these cycles at the shortest periods. Instead of
+    // clocking it step by step, move ahead in the output sequence a group of
+    // clocks at a time, and only report the output at the start of each group;
+    // anything faster than that is far above what can be sampled. Groups start
+    // at fixed positions in the sequence, so the same edges are reported however
+    // many cycles the channel is run for at once.
+    int groupSize = std::max(1, APU_NOISE_EDGE_SPACING / ch4Period);
+
+    while (ch4FrequencyTimer <= 0) {
+        int elapsedClocks = 1 + (-ch4FrequencyTimer / ch4Period);
+        int clocks = std::min(groupSize - (ch4LfsrPosition % groupSize), sequenceLength - ch4LfsrPosition);
+
+        if (clocks > elapsedClocks) {
+            ch4FrequencyTimer += elapsedClocks * ch4Period;
+            ch4LfsrPosition += elapsedClocks;
+            break;
+        }
 
-    if (upperSample > 0 || lowerSample > 0)
-        int two = 2;
+        ch4FrequencyTimer += clocks * ch4Period;
+        ch4LfsrPosition = (ch4LfsrPosition + clocks) % sequenceLength;
 
-    if (ch3WavePointer < 4)
-        ch3Amplitude = (upperSample >> shiftAmount);
-    else
-        ch3Amplitude = (lowerSample >> shiftAmount);
+        uBYTE amplitude = 0;
+        if (sequence[ch4LfsrPosition / 32] & (1u << (ch4LfsrPosition % 32)))
+            amplitude = applyVolume(ch4CurrentVolume, 0xF, 255);
 
+        if (ch4Disabled || !debuggerCh4Toggle)
+            amplitude = 0;
+
+        SetChannelOutput(3, amplitude, frameTime + cycles + ch4FrequencyTimer - ch4Period);
+    }
 
-    // If the CPU wrote a value to NR21, then this indicates that we
-    // need to restore the timer's value with 64 - period.
-    if (memRef->RequiresCh3LengthReload())
-        ch3LengthTimer = 255 - lengthPeriod;
+    // If the frame sequencer ticked a volume envelope, then apply the volume envelope on the volume.
+    if (volumeEnvelopeTick)
+        volumeEnvelopeFunction(ch4VolumeTimer, ch4CurrentVolume, ch4VolumePeriod, ch4VolumeDirection);
 
     // If the frame sequencer clocked a length tick, apply the length function to the channel.
-    if (lengthControlTick && lengthEnabled)
-        lengthFunction(ch3LengthTimer, ch3Disabled);
+    if (lengthControlTick && ch4LengthEnabled)
+        lengthFunction(ch4LengthTimer, ch4Disabled);
 
-    // If channel is disabled, amplitude drops to 0.
-    if (ch3Disabled || !channelEnabled)
-        ch3Amplitude = 0;
+    // The output stays at that of the start of the current group.
+    int groupStart = ch4LfsrPosition - (ch4LfsrPosition % groupSize);
+
+    uBYTE ch4Amplitude = 0;
+    if (sequence[groupStart / 32] & (1u << (groupStart % 32)))
+        ch4Amplitude = applyVolume(ch4CurrentVolume, 0xF, 255);
 
-    return ch3Amplitude;
+    // If channel is disabled, or the user turned it off through the debugger, the amplitude drops to 0.
+    if (ch4Disabled || !debuggerCh4Toggle)
+        ch4Amplitude = 0;
+
+    SetChannelOutput(3, ch4Amplitude, frameTime + cycles);
 }
 
 void Apu::UpdateFrameSequencer(int cycles) {
@@ -726,3 +1212,14 @@ int determineSquareWaveFrequencyTimerValue(uBYTE hiByte, uBYTE loByte, uBYTE mul
 
     return (2048 - frequencyQuotient) * multiplier;
 }
+
+int determineNoiseFrequencyTimerValue(uBYTE nr43) {
+    // The divisor code in bits 2-0 of NR43 selects a divisor of 8 for code 0,
+    // and 16 times the code otherwise. It is then shifted left by bits 7-4.
+    uBYTE divisorCode = nr43 & 0b00000111;
+    uBYTE clockShift = (nr43 & 0b11110000) >> 4;
+
+    int divisor = (divisorCode == 0) ? 8 : (divisorCode << 4);
+
+    return divisor << clockShift;
+}
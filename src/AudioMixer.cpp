@@ -0,0 +1,134 @@
+#include "AudioMixer.hpp"
+
+AudioMixer::AudioMixer() {
+    for (int i = 0; i < AUDIO_MIXER_MAX_CHANNELS; i++) {
+        leftGains[i] = 0.0f;
+        rightGains[i] = 0.0f;
+    }
+
+    leftInput = 0.0f;
+    leftOutput = 0.0f;
+    rightInput = 0.0f;
+    rightOutput = 0.0f;
+    SetSampleRate(48000);
+}
+
+void AudioMixer::SetSampleRate(int sampleRate) {
+    pole = (float)(1.0 - ((2.0 * 3.14159265358979323846 * AUDIO_MIXER_DC_CUTOFF_HZ) / sampleRate));
+}
+
+void AudioMixer::SetGains(int channel, float left, float right) {
+    leftGains[channel] = left;
+    rightGains[channel] = right;
+}
+
+// Sums count samples of every channel, weighted by their left and right gains.
+void AudioMixer::Mix(const float* const* channels, int channelCount, int count, float* left, float* right) {
+    int i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 8 <= count; i += 8) {
+        __m256 l = _mm256_setzero_ps();
+        __m256 r = _mm256_setzero_ps();
+
+        for (int c = 0; c < channelCount; c++) {
+            __m256 samples = _mm256_loadu_ps(channels[c] + i);
+            l = _mm256_add_ps(l, _mm256_mul_ps(samples, _mm256_set1_ps(leftGains[c])));
+            r = _mm256_add_ps(r, _mm256_mul_ps(samples, _mm256_set1_ps(rightGains[c])));
+        }
+
+        _mm256_storeu_ps(left + i, l);
+        _mm256_storeu_ps(right + i, r);
+    }
+#elif defined(__SSE2__)
+    for (; i + 4 <= count; i += 4) {
+        __m128 l = _mm_setzero_ps();
+        __m128 r = _mm_setzero_ps();
+
+        for (int c = 0; c < channelCount; c++) {
+            __m128 samples = _mm_loadu_ps(channels[c] + i);
+            l = _mm_add_ps(l, _mm_mul_ps(samples, _mm_set1_ps(leftGains[c])));
+            r = _mm_add_ps(r, _mm_mul_ps(samples, _mm_set1_ps(rightGains[c])));
+        }
+
+        _mm_storeu_ps(left + i, l);
+        _mm_storeu_ps(right + i, r);
+    }
+#endif
+
+    // Remaining samples, or all of them without SIMD support.
+    for (; i < count; i++) {
+        float l = 0.0f;
+        float r = 0.0f;
+
+        for (int c = 0; c < channelCount; c++) {
+            l += channels[c][i] * leftGains[c];
+            r += channels[c][i] * rightGains[c];
+        }
+
+        left[i] = l;
+        right[i] = r;
+    }
+}
+
+// Removes the DC offset from the mixed samples, in place. Every output
+// sample depends on the previous one, so this one runs sample by sample.
+void AudioMixer::Filter(float* left, float* right, int count) {
+    for (int i = 0; i < count; i++) {
+        leftOutput = left[i] - leftInput + (pole * leftOutput);
+        leftInput = left[i];
+        left[i] = leftOutput;
+
+        rightOutput = right[i] - rightInput + (pole * rightOutput);
+        rightInput = right[i];
+        right[i] = rightOutput;
+    }
+}
+
+// Size in bytes of a stereo sample in the given format.
+int AudioMixer::FrameSize(SampleFormat format) {
+    return (format == SAMPLE_FORMAT_S16) ? 2 * sizeof(int16_t) : 2 * sizeof(float);
+}
+
+// Interleaves the left and right samples (LR,LR,LR,...) into out, clamped
+// to [-1, 1] and converted to the given format.
+void AudioMixer::Interleave(const float* left, const float* right, int count, SampleFormat format, void* out) {
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128 minimum = _mm_set1_ps(-1.0f);
+    const __m128 maximum = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(32767.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(left + i), minimum), maximum);
+        __m128 r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(right + i), minimum), maximum);
+        __m128 lo = _mm_unpacklo_ps(l, r);
+        __m128 hi = _mm_unpackhi_ps(l, r);
+
+        if (format == SAMPLE_FORMAT_S16) {
+            __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(lo, scale)), _mm_cvtps_epi32(_mm_mul_ps(hi, scale)));
+            _mm_storeu_si128((__m128i*)((int16_t*)out + (i * 2)), packed);
+        }
+        else {
+            _mm_storeu_ps((float*)out + (i * 2), lo);
+            _mm_storeu_ps((float*)out + (i * 2) + 4, hi);
+        }
+    }
+#endif
+
+    // Remaining samples, or all of them without SIMD support.
+    for (; i < count; i++) {
+        float l = fminf(fmaxf(left[i], -1.0f), 1.0f);
+        float r = fminf(fmaxf(right[i], -1.0f), 1.0f);
+
+        if (format == SAMPLE_FORMAT_S16) {
+            ((int16_t*)out)[i * 2] = (int16_t)lrintf(l * 32767.0f);
+            ((int16_t*)out)[(i * 2) + 1] = (int16_t)lrintf(r * 32767.0f);
+        }
+        else {
+            ((float*)out)[i * 2] = l;
+            ((float*)out)[(i * 2) + 1] = r;
+        }
+    }
+}
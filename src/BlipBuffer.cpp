@@ -0,0 +1,111 @@
+#include "BlipBuffer.hpp"
+
+// Band-limited impulse, pre-computed for every sub-sample phase.
+// Each phase is normalized so that it adds up to exactly 1, which
+// means that integrating a delta always yields the same step height.
+struct BlipKernel {
+    float taps[BLIP_PHASE_COUNT][BLIP_KERNEL_WIDTH];
+
+    BlipKernel() {
+        const double pi = 3.14159265358979323846;
+
+        // Cut off slightly below nyquist so that the transition
+        // band fits within the kernel's width.
+        const double cutoff = 0.90;
+
+        for (int phase = 0; phase < BLIP_PHASE_COUNT; phase++) {
+            double fraction = (double)phase / BLIP_PHASE_COUNT;
+            double sum = 0.0;
+
+            for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+                // Distance from the impulse's center, which sits in the
+                // middle of the kernel, offset by the sub-sample phase.
+                double x = (i - (BLIP_KERNEL_WIDTH / 2) + 1) - fraction;
+                double sinc = (x == 0.0) ? 1.0 : sin(pi * cutoff * x) / (pi * cutoff * x);
+
+                // Blackman window
+                double w = (i + 1 - fraction) / BLIP_KERNEL_WIDTH;
+                double window = 0.42 - (0.5 * cos(2.0 * pi * w)) + (0.08 * cos(4.0 * pi * w));
+
+                taps[phase][i] = sinc * window;
+                sum += taps[phase][i];
+            }
+
+            for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+                taps[phase][i] /= sum;
+            }
+        }
+    }
+};
+
+static const BlipKernel kernel;
+
+BlipBuffer::BlipBuffer() {
+    buffer = new float[BLIP_BUFFER_CAPACITY + BLIP_KERNEL_WIDTH];
+    factor = 1.0;
+    Clear();
+}
+
+BlipBuffer::~BlipBuffer() {
+    delete[] buffer;
+}
+
+void BlipBuffer::SetRates(double clockRate, double sampleRate) {
+    factor = sampleRate / clockRate;
+}
+
+void BlipBuffer::Clear() {
+    memset(buffer, 0x00, sizeof(float) * (BLIP_BUFFER_CAPACITY + BLIP_KERNEL_WIDTH));
+    integrator = 0.0f;
+    offset = 0.0;
+}
+
+// Adds an amplitude change of delta at clockTime, relative to the start of the frame.
+void BlipBuffer::AddDelta(int clockTime, float delta) {
+    double position = offset + (clockTime * factor);
+    int index = (int)position;
+    int phase = (int)((position - index) * BLIP_PHASE_COUNT);
+
+    // Deltas beyond what the buffer can hold are dropped rather
+    // than written out of bounds.
+    if (index >= BLIP_BUFFER_CAPACITY)
+        return;
+
+    const float* taps = kernel.taps[phase];
+    float* out = buffer + index;
+    for (int i = 0; i < BLIP_KERNEL_WIDTH; i++) {
+        out[i] += taps[i] * delta;
+    }
+}
+
+// Ends the current frame, making the samples it covered available for reading.
+// Clock times of the next frame are relative to the end of this one.
+void BlipBuffer::EndFrame(int clockDuration) {
+    offset += clockDuration * factor;
+    if (offset > BLIP_BUFFER_CAPACITY)
+        offset = BLIP_BUFFER_CAPACITY;
+}
+
+int BlipBuffer::SamplesAvailable() {
+    return (int)offset;
+}
+
+// Integrates up to count available samples into out and returns how many were read.
+int BlipBuffer::ReadSamples(float* out, int count) {
+    int available = SamplesAvailable();
+    if (count > available)
+        count = available;
+
+    for (int i = 0; i < count; i++) {
+        integrator += buffer[i];
+        out[i] = integrator;
+    }
+
+    // Shift the samples still being built to the front of the buffer.
+    int remaining = BLIP_BUFFER_CAPACITY + BLIP_KERNEL_WIDTH - count;
+    memmove(buffer, buffer + count, sizeof(float) * remaining);
+    memset(buffer + remaining, 0x00, sizeof(float) * count);
+    offset -= count;
+
+    return count;
+}
@@ -1,5 +1,17 @@
 #include "Cpu.hpp"
 
+// Tried in order, the first one found in full is executed.
+const Cpu::Fusion Cpu::fusions[FUSION_COUNT] = {
+    // LD A,(HL+) / LD (DE),A / INC DE / DEC BC / LD A,B / OR C / JR NZ,e
+    { "copy", 8, { LDI_adrHL_A, LD_A_adrDE, INC_DE, DEC_BC, LD_B_A, OR_C_A, RJmp_NOTZERO, -1 }, 52, &Cpu::fuseCopyLoop },
+
+    // LDH A,(n) / CP n / JR NZ,e
+    { "poll", 6, { LDH_IMMadr_A, -1, CMP_8IMM_A, -1, RJmp_NOTZERO, -1 }, 32, &Cpu::fusePollCompare },
+
+    // LDH A,(n) / AND n / JR Z,e
+    { "poll-mask", 6, { LDH_IMMadr_A, -1, AND_8IMM_A, -1, RJmp_ZERO, -1 }, 32, &Cpu::fusePollMask },
+};
+
 Cpu::Cpu(): AF(0x0000), BC(0x0000), DE(0x0000), HL(0x0000), temp(0x0000)
 {
     PC = 0x0000;
@@ -13,6 +25,13 @@ Cpu::Cpu(): AF(0x0000), BC(0x0000), DE(0x0000), HL(0x0000), temp(0x0000)
     Halted = false;
     IME = false;
     buggedHalt = false;
+
+    profiler = NULL;
+
+    executedInstructions = 0;
+    batchBudget = 0;
+    batchWindow = -1;
+    SetFusions(FUSION_ALL);
 }
 
 Cpu::~Cpu()
@@ -28,175 +47,440 @@ void Cpu::SetPostBootRomState() {
     SP = 0xFFFE;
 }
 
+void Cpu::SaveState(State& state) {
+    state.AF = AF.data;
+    state.BC = BC.data;
+    state.DE = DE.data;
+    state.HL = HL.data;
+    state.SP = SP;
+    state.PC = PC;
+    state.IME = IME;
+    state.halted = Halted;
+    state.paused = Paused;
+    state.buggedHalt = buggedHalt;
+}
+
+void Cpu::LoadState(const State& state) {
+    AF = state.AF;
+    BC = state.BC;
+    DE = state.DE;
+    HL = state.HL;
+    SP = state.SP;
+    PC = state.PC;
+    IME = state.IME;
+    Halted = state.halted;
+    Paused = state.paused;
+    buggedHalt = state.buggedHalt;
+}
+
 void Cpu::SetMemory(Memory* memory) {
     memoryUnit = memory;
 }
 
+void Cpu::SetProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+}
+
+// Enables the fusions whose bits are set, see FindFusion.
+void Cpu::SetFusions(unsigned int enabled) {
+    for (int i = 0; i < 0x100; i++)
+        fusionHeads[i] = 0;
+
+    for (int i = 0; i < FUSION_COUNT; i++) {
+        if (enabled & (1 << i))
+            fusionHeads[fusions[i].pattern[0]] |= 1 << i;
+    }
+}
+
+void Cpu::SetBatchWindowHook(std::function<int()> hook) {
+    batchWindowHook = hook;
+}
+
+// Instructions executed since the last call, fused ones included.
+uint64_t Cpu::TakeExecutedInstructions() {
+    BENCHMARK_ADD(instructions, executedInstructions);
+
+    uint64_t instructions = executedInstructions;
+    executedInstructions = 0;
+    return instructions;
+}
+
+// Returns the index of the named fusion, or -1 if there is none by that name.
+int Cpu::FindFusion(const std::string& name) {
+    for (int i = 0; i < FUSION_COUNT; i++) {
+        if (name == fusions[i].name)
+            return i;
+    }
+
+    return -1;
+}
+
+const char* Cpu::FusionName(int fusion) {
+    return fusions[fusion].name;
+}
+
 void Cpu::Pause()
 {
     Paused = true;
 }
 
-int Cpu::ExecuteNextOpCode()
+// Ends the batch being executed with the current instruction, fusions
+// included, such as when a watchpoint it hit pauses the emulation or
+// when it is STOP.
+void Cpu::EndBatch()
 {
+    batchBudget = -1;
+}
 
-    byte = memoryUnit->Read(PC++);
+// The regular opcode families are generated from their encoding rather than
+// written out: the register operand is in bits 0-2 and, for loads, the
+// destination in bits 3-5, both numbered B, C, D, E, H, L, (HL), A. Each
+// opcode gets its own instantiation, so operands are picked at compile time.
+template <int r>
+inline uBYTE& Cpu::registerByIndex() {
+    static_assert(r >= 0 && r < 8 && r != 6, "(HL) is not a register");
+
+    if constexpr (r == 0) return BC.hi;
+    else if constexpr (r == 1) return BC.lo;
+    else if constexpr (r == 2) return DE.hi;
+    else if constexpr (r == 3) return DE.lo;
+    else if constexpr (r == 4) return HL.hi;
+    else if constexpr (r == 5) return HL.lo;
+    else return AF.hi;
+}
 
-    if (buggedHalt) {
-        PC--;
-        buggedHalt = false;
+template <int r>
+inline uBYTE Cpu::readOperand() {
+    if constexpr (r == 6) return memoryUnit->Read(HL.data);
+    else return registerByIndex<r>();
+}
+
+// LD r,r' (0x40-0x7F) and ADD, ADC, SUB, SBC, AND, XOR, OR and CP (0x80-0xBF).
+// Returns the cycles executed.
+template <int opcode>
+int Cpu::executeRegisterOp() {
+    constexpr int source = opcode & 0x07;
+    constexpr int operation = (opcode >> 3) & 0x07;
+
+    if constexpr (opcode < 0x80) {
+        static_assert(opcode != HALT, "HALT is not a load");
+
+        if constexpr (operation == 6)
+            memoryUnit->Write(HL.data, registerByIndex<source>());
+        else if constexpr (operation != source)
+            registerByIndex<operation>() = readOperand<source>();
+
+        return (source == 6 || operation == 6) ? 8 : 4;
+    }
+    else {
+        uBYTE value = readOperand<source>();
+
+        if constexpr (operation == 0) AF.hi = add8BitRegister(AF.hi, value);
+        else if constexpr (operation == 1) AF.hi = add8BitRegister(AF.hi, value, true);
+        else if constexpr (operation == 2) AF.hi = sub8BitRegister(AF.hi, value);
+        else if constexpr (operation == 3) AF.hi = sub8BitRegister(AF.hi, value, true);
+        else if constexpr (operation == 4) AF.hi = and8BitRegister(AF.hi, value);
+        else if constexpr (operation == 5) AF.hi = xor8BitRegister(AF.hi, value);
+        else if constexpr (operation == 6) AF.hi = or8BitRegister(AF.hi, value);
+        else cmp8BitRegister(AF.hi, value);
+
+        return (source == 6) ? 8 : 4;
+    }
+}
+
+// CB-prefixed opcodes: rotates and shifts (0x00-0x3F), BIT (0x40-0x7F),
+// RES (0x80-0xBF) and SET (0xC0-0xFF). Returns the cycles executed past
+// those of the prefix.
+template <int opcode>
+int Cpu::executeExtendedOp() {
+    constexpr int r = opcode & 0x07;
+    constexpr int bit = (opcode >> 3) & 0x07;
+
+    if constexpr (opcode >= 0x40 && opcode < 0x80) {
+        testBit(bit, readOperand<r>());
+        return (r == 6) ? 8 : 4;
+    }
+    else {
+        uBYTE value = readOperand<r>();
+
+        if constexpr (opcode >= 0xC0) value = setBit(bit, value);
+        else if constexpr (opcode >= 0x80) value = resetBit(bit, value);
+        else if constexpr (bit == 0) value = rotateRegExt(true, false, value);
+        else if constexpr (bit == 1) value = rotateRegExt(false, false, value);
+        else if constexpr (bit == 2) value = rotateRegExt(true, true, value);
+        else if constexpr (bit == 3) value = rotateRegExt(false, true, value);
+        else if constexpr (bit == 4) value = shiftReg(true, true, value);
+        else if constexpr (bit == 5) value = shiftReg(false, true, value);
+        else if constexpr (bit == 6) value = swapReg(value);
+        else value = shiftReg(false, false, value);
+
+        if constexpr (r == 6) {
+            byte = value;
+            memoryUnit->Write(HL.data, byte);
+            return 12;
+        }
+        else {
+            registerByIndex<r>() = value;
+            return 4;
+        }
     }
+}
+
+template <int opcode>
+constexpr Cpu::OpHandler Cpu::registerOpHandler() {
+    // HALT sits in the middle of the loads but is executed on its own.
+    if constexpr (opcode == HALT) return nullptr;
+    else return &Cpu::executeRegisterOp<opcode>;
+}
+
+template <size_t... opcodes>
+constexpr std::array<Cpu::OpHandler, sizeof...(opcodes)> Cpu::registerOpTable(std::index_sequence<opcodes...>) {
+    return { { registerOpHandler<LD_B_B + opcodes>()... } };
+}
 
+template <size_t... opcodes>
+constexpr std::array<Cpu::OpHandler, sizeof...(opcodes)> Cpu::extendedOpTable(std::index_sequence<opcodes...>) {
+    return { { &Cpu::executeExtendedOp<opcodes>... } };
+}
+
+const std::array<Cpu::OpHandler, 0x80> Cpu::registerOpHandlers = Cpu::registerOpTable(std::make_index_sequence<0x80>());
+const std::array<Cpu::OpHandler, 0x100> Cpu::extendedOpHandlers = Cpu::extendedOpTable(std::make_index_sequence<0x100>());
+
+// Opcodes are dispatched through the switch below. With GCC and Clang, the
+// end of every instruction jumps straight to the next opcode's case instead,
+// through a table of the cases' addresses, so that each of those jumps is
+// predicted from the instruction it ends rather than all of them sharing
+// the switch's. Defining FUUGB_SWITCH_DISPATCH keeps to the switch, as
+// other compilers do.
+#if defined(__GNUC__) && !defined(FUUGB_SWITCH_DISPATCH)
+#define CPU_THREADED_DISPATCH
+#endif
+
+#ifdef CPU_THREADED_DISPATCH
+#define OPCODE(name) case name: op_##name
+#define DEFAULT_OPCODE() default: op_default
+#define DISPATCH() goto *opcodeTargets[byte]
+#else
+#define OPCODE(name) case name
+#define DEFAULT_OPCODE() default
+#define DISPATCH() goto dispatch
+#endif
+
+// Ends an instruction, going on with the next one unless the batch is over.
+#define END_INSTRUCTION() \
+    if (!nextInstruction(cycles)) \
+        return cycles; \
+    DISPATCH()
+
+// Executes instructions as a single batch, which the rest of the machine is
+// updated for once it is over. Another instruction is started as long as no
+// more than budget cycles were executed, unless updating in between could
+// have made a difference, see continueBatch. At least one instruction is
+// executed, only one with a budget of 0. Returns the cycles executed, 0 if
+// stopped at a breakpoint.
+int Cpu::Execute(int budget)
+{
+    BENCHMARK_ZONE(cpuTicks);
+
+#ifdef CPU_THREADED_DISPATCH
+    static void* const opcodeTargets[0x100] = {
+        &&op_NOP, &&op_LD_16IMM_BC, &&op_LD_A_adrBC, &&op_INC_BC, &&op_INC_B, &&op_DEC_B, &&op_LD_8IMM_B, &&op_RLC_A,
+        &&op_LD_SP_adr, &&op_ADD_BC_HL, &&op_LD_adrBC_A, &&op_DEC_BC, &&op_INC_C, &&op_DEC_C, &&op_LD_8IMM_C, &&op_RRC_A,
+        &&op_STOP, &&op_LD_16IMM_DE, &&op_LD_A_adrDE, &&op_INC_DE, &&op_INC_D, &&op_DEC_D, &&op_LD_8IMM_D, &&op_RL_A,
+        &&op_RJmp_IMM, &&op_ADD_DE_HL, &&op_LD_adrDE_A, &&op_DEC_DE, &&op_INC_E, &&op_DEC_E, &&op_LD_8IMM_E, &&op_RR_A,
+        &&op_RJmp_NOTZERO, &&op_LD_16IMM_HL, &&op_LDI_A_adrHL, &&op_INC_HL, &&op_INC_H, &&op_DEC_H, &&op_LD_8IMM_H, &&op_DAA,
+        &&op_RJmp_ZERO, &&op_ADD_HL_HL, &&op_LDI_adrHL_A, &&op_DEC_HL, &&op_INC_L, &&op_DEC_L, &&op_LD_8IMM_L, &&op_CPL_A,
+        &&op_RJmp_NOCARRY, &&op_LD_16IM_SP, &&op_LDD_A_adrHL, &&op_INC_SP, &&op_INC_valHL, &&op_DEC_valHL, &&op_LD_8IMM_adrHL, &&op_SET_CARRY_FLAG,
+        &&op_RJmp_CARRY, &&op_ADD_SP_HL, &&op_LDD_adrHL_A, &&op_DEC_SP, &&op_INC_A, &&op_DEC_A, &&op_LD_8IMM_A, &&op_COMP_CARRY_FLAG,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_HALT, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default, &&op_default,
+        &&op_RET_NOT_ZERO, &&op_POP_BC, &&op_JMP_NOT_ZERO, &&op_JMP, &&op_CALL_NOT_ZERO, &&op_PUSH_BC, &&op_ADD_IMM_A, &&op_RST_0,
+        &&op_RET_ZERO, &&op_RETURN, &&op_JMP_ZERO, &&op_EXT_OP, &&op_CALL_ZERO, &&op_CALL, &&op_ADC_8IMM_A, &&op_RST_8,
+        &&op_RET_NOCARRY, &&op_POP_DE, &&op_JMP_NOCARRY, &&op_default, &&op_CALL_NOCARRY, &&op_PUSH_DE, &&op_SUB_8IMM_A, &&op_RST_10,
+        &&op_RET_CARRY, &&op_RET_INT, &&op_JMP_CARRY, &&op_default, &&op_CALL_CARRY, &&op_default, &&op_SBC_8IMM_A, &&op_RST_18,
+        &&op_LDH_A_IMMadr, &&op_POP_HL, &&op_LDH_A_C, &&op_default, &&op_default, &&op_PUSH_HL, &&op_AND_8IMM_A, &&op_RST_20,
+        &&op_ADD_SIMM_SP, &&op_JMP_adrHL, &&op_LD_A_adr, &&op_default, &&op_default, &&op_default, &&op_XOR_8IMM_A, &&op_RST_28,
+        &&op_LDH_IMMadr_A, &&op_POP_AF, &&op_LDH_C_A, &&op_DISABLE_INT, &&op_default, &&op_PUSH_AF, &&op_OR_8IMM_A, &&op_RST_30,
+        &&op_LDHL_S_8IMM_SP_HL, &&op_LD_HL_SP, &&op_LD_16adr_A, &&op_ENABLE_INT, &&op_default, &&op_default, &&op_CMP_8IMM_A, &&op_RST_38
+    };
+#endif
+
+    int cycles = 0;
+    batchBudget = budget;
+    batchWindow = -1;
+    memoryUnit->TakeRegisterWrite();
+
+    if (!fetchInstruction(cycles))
+        return cycles;
+
+#ifndef CPU_THREADED_DISPATCH
+dispatch:
+#endif
     switch (byte) {
-    case NOP:
+    OPCODE(NOP):
         //4 Cpu Cycle
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_16IMM_BC:
+    OPCODE(LD_16IMM_BC):
         //12 Cpu Cycles
         BC.lo = memoryUnit->Read(PC++);
         BC.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LD_A_adrBC:
+    OPCODE(LD_A_adrBC):
         //8 Cpu Cycles
         memoryUnit->Write(BC.data, AF.hi);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_BC:
+    OPCODE(INC_BC):
         //8 Cpu Cycles
         BC.data = increment16BitRegister(BC.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_B:
+    OPCODE(INC_B):
         //4 Cpu Cycles
         BC.hi = increment8BitRegister(BC.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_B:
+    OPCODE(DEC_B):
         //4 Cpu Cycles
         BC.hi = decrement8BitRegister(BC.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_B:
+    OPCODE(LD_8IMM_B):
         //8 Cpu Cycles
         BC.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RLC_A:
+    OPCODE(RLC_A):
         //4 Cpu Cycles
         AF.hi = rotateReg(true, false, AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_SP_adr:
+    OPCODE(LD_SP_adr):
         //20 Cpu cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
         memoryUnit->Write(temp.data++, (SP & 0x00FF));
         memoryUnit->Write(temp.data, (SP >> 8));
         cyclesExecuted = 20;
-        break;
+        END_INSTRUCTION();
 
-    case ADD_BC_HL:
+    OPCODE(ADD_BC_HL):
         //8 Cpu Cycles
         HL.data = add16BitRegister(HL.data, BC.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LD_adrBC_A:
+    OPCODE(LD_adrBC_A):
         //8 Cpu Cycles
         AF.hi = memoryUnit->Read(BC.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_BC:
+    OPCODE(DEC_BC):
         //8 Cpu Cycles
         BC.data = decrement16BitRegister(BC.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_C:
+    OPCODE(INC_C):
         //4 Cpu Cycles
         BC.lo = increment8BitRegister(BC.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_C:
+    OPCODE(DEC_C):
         //4 Cpu Cycles
         BC.lo = decrement8BitRegister(BC.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_C:
+    OPCODE(LD_8IMM_C):
         //8 Cpu Cycles
         BC.lo = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RRC_A:
+    OPCODE(RRC_A):
         //4 Cpu Cycles
         AF.hi = rotateReg(false, false, AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case STOP:
+    OPCODE(STOP):
         //4 Clock Cycles
         Paused = true;
+        EndBatch();
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_16IMM_DE:
+    OPCODE(LD_16IMM_DE):
         //12 Clock Cycles
         DE.lo = memoryUnit->Read(PC++);
         DE.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LD_A_adrDE:
+    OPCODE(LD_A_adrDE):
         //8 Clock Cycles
         memoryUnit->Write(DE.data, AF.hi);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_DE:
+    OPCODE(INC_DE):
         //8 Clock Cycles
         DE.data = increment16BitRegister(DE.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_D:
+    OPCODE(INC_D):
         //4 Clock Cycles
         DE.hi = increment8BitRegister(DE.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_D:
+    OPCODE(DEC_D):
         //4 Clock Cycles
         DE.hi = decrement8BitRegister(DE.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_D:
+    OPCODE(LD_8IMM_D):
         //8 Clock Cycles
         DE.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RL_A:
+    OPCODE(RL_A):
         //4 Clock Cycles
         AF.hi = rotateReg(true, true, AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case RJmp_IMM:
+    OPCODE(RJmp_IMM):
         //12 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (testBitInByte(byte, 7))
@@ -205,51 +489,51 @@ int Cpu::ExecuteNextOpCode()
             PC = PC + byte;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case ADD_DE_HL:
+    OPCODE(ADD_DE_HL):
         //8 Clock Cycles
         HL.data = add16BitRegister(HL.data, DE.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LD_adrDE_A:
+    OPCODE(LD_adrDE_A):
         //8 Clock Cycles
         AF.hi = memoryUnit->Read(DE.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_DE:
+    OPCODE(DEC_DE):
         //4 Clock Cycles
         DE.data = decrement16BitRegister(DE.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_E:
+    OPCODE(INC_E):
         //4 Clock Cycles
         DE.lo = increment8BitRegister(DE.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_E:
+    OPCODE(DEC_E):
         //4 clock cycles
         DE.lo = decrement8BitRegister(DE.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_E:
+    OPCODE(LD_8IMM_E):
         //8 Clock Cycles
         DE.lo = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RR_A:
+    OPCODE(RR_A):
         //4 clock cycles
         AF.hi = rotateReg(false, true, AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case RJmp_NOTZERO:
+    OPCODE(RJmp_NOTZERO):
         //8 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (!CPU_FLAG_BIT_TEST(Z_FLAG))
@@ -263,52 +547,52 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LD_16IMM_HL:
+    OPCODE(LD_16IMM_HL):
         //12 Clock Cycles
         HL.lo = memoryUnit->Read(PC++);
         HL.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LDI_A_adrHL:
+    OPCODE(LDI_A_adrHL):
         //8 Clock Cycles
         memoryUnit->Write(HL.data++, AF.hi);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_HL:
+    OPCODE(INC_HL):
         //4 Clock Cycles
         HL.data = increment16BitRegister(HL.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_H:
+    OPCODE(INC_H):
         //4 Clock Cycles
         HL.hi = increment8BitRegister(HL.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_H:
+    OPCODE(DEC_H):
         //4 Clock Cycles
         HL.hi = decrement8BitRegister(HL.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_H:
+    OPCODE(LD_8IMM_H):
         //8 Clock Cycles
         HL.hi = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case DAA:
+    OPCODE(DAA):
         //4 Clock Cycles
         AF.hi = adjustDAA(AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case RJmp_ZERO:
+    OPCODE(RJmp_ZERO):
         //8 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (CPU_FLAG_BIT_TEST(Z_FLAG))
@@ -322,53 +606,53 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case ADD_HL_HL:
+    OPCODE(ADD_HL_HL):
         //8 Clock Cycles
         HL.data = add16BitRegister(HL.data, HL.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LDI_adrHL_A:
+    OPCODE(LDI_adrHL_A):
         //8 Clock Cycles
         AF.hi = memoryUnit->Read(HL.data++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_HL:
+    OPCODE(DEC_HL):
         //4 Clock Cycles
         HL.data = decrement16BitRegister(HL.data);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_L:
+    OPCODE(INC_L):
         //4 Clock Cycles
         HL.lo = increment8BitRegister(HL.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_L:
+    OPCODE(DEC_L):
         //4 Clock Cycles
         HL.lo = decrement8BitRegister(HL.lo);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_L:
+    OPCODE(LD_8IMM_L):
         //8 Clock Cycles
         HL.lo = memoryUnit->Read(PC++);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case CPL_A:
+    OPCODE(CPL_A):
         //4 Clock Cycles
         AF.hi ^= 0xFF;
         CPU_FLAG_BIT_SET(N_FLAG);
         CPU_FLAG_BIT_SET(H_FLAG);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case RJmp_NOCARRY:
+    OPCODE(RJmp_NOCARRY):
         //8 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (!CPU_FLAG_BIT_TEST(C_FLAG))
@@ -382,896 +666,140 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LD_16IM_SP:
+    OPCODE(LD_16IM_SP):
         //12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
         SP = temp.data;
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LDD_A_adrHL:
+    OPCODE(LDD_A_adrHL):
         //8 Clock Cycles
         memoryUnit->Write(HL.data--, AF.hi);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_SP:
+    OPCODE(INC_SP):
         //8 Clock Cycles
         SP = increment16BitRegister(SP);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case INC_valHL:
+    OPCODE(INC_valHL):
         //12 Clock Cycles
         byte = increment8BitRegister(memoryUnit->Read(HL.data));
         memoryUnit->Write(HL.data, byte);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case DEC_valHL:
+    OPCODE(DEC_valHL):
         //12 Clock Cycles
         byte = decrement8BitRegister(memoryUnit->Read(HL.data));
         memoryUnit->Write(HL.data, byte);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LD_8IMM_adrHL:
+    OPCODE(LD_8IMM_adrHL):
         //12 Clock Cycles
         byte = memoryUnit->Read(PC++);
         memoryUnit->Write(HL.data, byte);
-        cyclesExecuted = 12;
-        break;
-
-    case SET_CARRY_FLAG:
-        //4 Clock Cycles
-        CPU_FLAG_BIT_RESET(N_FLAG);
-        CPU_FLAG_BIT_RESET(H_FLAG);
-        CPU_FLAG_BIT_SET(C_FLAG);
-        cyclesExecuted = 4;
-        break;
-
-    case RJmp_CARRY:
-        //8 Clock Cycles
-        byte = memoryUnit->Read(PC++);
-        if (CPU_FLAG_BIT_TEST(C_FLAG))
-        {
-            if (testBitInByte(byte, 7))
-                PC = PC - twoComp_Byte(byte);
-            else
-                PC = PC + byte;
-            memoryUnit->UpdateTimers(4);
-            cyclesExecuted = 12;
-        }
-        else
-            cyclesExecuted = 8;
-        break;
-
-    case ADD_SP_HL:
-        //8 Clock Cycles
-        HL.data = add16BitRegister(HL.data, SP);
-        cyclesExecuted = 8;
-        break;
-
-    case LDD_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = memoryUnit->Read(HL.data--);
-        cyclesExecuted = 8;
-        break;
-
-    case DEC_SP:
-        //8 Clock Cycles;
-        SP = decrement16BitRegister(SP);
-        cyclesExecuted = 8;
-        break;
-
-    case INC_A:
-        //4 Clock Cycles
-        AF.hi = increment8BitRegister(AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case DEC_A:
-        //4 Clock Cycles
-        AF.hi = decrement8BitRegister(AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case LD_8IMM_A:
-        //8 Clock Cycles
-        AF.hi = memoryUnit->Read(PC++);
-        cyclesExecuted = 8;
-        break;
-
-    case COMP_CARRY_FLAG:
-        //4 Clock Cycles
-        if (CPU_FLAG_BIT_TEST(C_FLAG))
-            CPU_FLAG_BIT_RESET(C_FLAG);
-        else
-            CPU_FLAG_BIT_SET(C_FLAG);
-
-        CPU_FLAG_BIT_RESET(N_FLAG);
-        CPU_FLAG_BIT_RESET(H_FLAG);
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_B:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_B:
-        //4 Clock Cycles
-        BC.hi = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_B:
-        //4 Clock Cycles
-        BC.hi = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_B:
-        //4 Clock Cycles
-        BC.hi = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_B:
-        //4 Clock Cycles
-        BC.hi = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_B:
-        //4 Clock Cycles
-        BC.hi = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_B:
-        //8 Clock Cycles
-        BC.hi = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_B:
-        //4 Clock Cycles
-        BC.hi = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_C:
-        //4 Clock Cycles
-        BC.lo = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_C:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_C:
-        //4 Clock Cycles
-        BC.lo = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_C:
-        //4 Clock Cycles
-        BC.lo = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_C:
-        //4 Clock Cycles
-        BC.lo = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_C:
-        //4 Clock Cycles
-        BC.lo = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_C:
-        //8 Clock Cycles
-        BC.lo = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_C:
-        //4 Clock Cycles
-        BC.lo = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_D:
-        //4 Clock Cycles
-        DE.hi = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_D:
-        //4 Clock Cycles
-        DE.hi = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_D:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_D:
-        //4 Clock Cycles
-        DE.hi = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_D:
-        //4 Clock Cycles
-        DE.hi = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_D:
-        //4 Clock Cycles
-        DE.hi = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_D:
-        //8 Clock Cycles
-        DE.hi = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_D:
-        //4 Clock Cycles
-        DE.hi = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_E:
-        //4 Clock Cycles
-        DE.lo = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_E:
-        //4 Clock Cycles
-        DE.lo = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_E:
-        //4 Clock Cycles
-        DE.lo = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_E:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_E:
-        //4 Clock Cycles
-        DE.lo = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_E:
-        //4 Clock Cycles
-        DE.lo = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_E:
-        //8 Clock Cycles
-        DE.lo = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_E:
-        //4 Clock Cycles
-        DE.lo = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_H:
-        //4 Clock Cycles
-        HL.hi = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_H:
-        //4 Clock Cycles
-        HL.hi = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_H:
-        //4 Clock Cycles
-        HL.hi = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_H:
-        //4 Clock Cycles
-        HL.hi = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_H:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_H:
-        //4 Clock Cycles
-        HL.hi = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_H:
-        //8 Clock Cycles
-        HL.hi = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_H:
-        //4 Clock Cycles
-        HL.hi = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_L:
-        //4 Clock Cycles
-        HL.lo = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_L:
-        //4 Clock Cycles
-        HL.lo = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_L:
-        //4 Clock Cycles
-        HL.lo = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_L:
-        //4 Clock Cycles
-        HL.lo = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_L:
-        //4 Clock Cycles
-        HL.lo = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_L:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_L:
-        //8 Clock Cycles
-        HL.lo = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_L:
-        //4 Clock Cycles
-        HL.lo = AF.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_B_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, BC.hi);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_C_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, BC.lo);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_D_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, DE.hi);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_E_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, DE.lo);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_H_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, HL.hi);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_L_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, HL.lo);
-        cyclesExecuted = 8;
-        break;
-
-    case HALT:
-        //4 Clock Cycles
-        if (IME)
-            Halted = true;
-        else
-        {
-            uBYTE IE = memoryUnit->DmaRead(INTERUPT_EN_REGISTER_ADR);
-            uBYTE IF = memoryUnit->DmaRead(INTERUPT_FLAG_REG);
-
-            if (!(IE & IF & 0x1F))
-            {
-                Halted = true;
-            }
-
-            buggedHalt = true;
-        }
-        cyclesExecuted = 4;
-        break;
-
-    case LD_A_adrHL:
-        //8 Clock Cycles
-        memoryUnit->Write(HL.data, AF.hi);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_B_A:
-        //4 Clock Cycles
-        AF.hi = BC.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_C_A:
-        //4 Clock Cycles
-        AF.hi = BC.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_D_A:
-        //4 Clock Cycles
-        AF.hi = DE.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_E_A:
-        //4 Clock Cycles
-        AF.hi = DE.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_H_A:
-        //4 Clock Cycles
-        AF.hi = HL.hi;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_L_A:
-        //4 Clock Cycles
-        AF.hi = HL.lo;
-        cyclesExecuted = 4;
-        break;
-
-    case LD_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = memoryUnit->Read(HL.data);
-        cyclesExecuted = 8;
-        break;
-
-    case LD_A_A:
-        //4 Clock Cycles
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_B_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, BC.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_C_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, BC.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_D_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_E_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, DE.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_H_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, HL.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_L_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case ADD_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, memoryUnit->Read(HL.data));
-        cyclesExecuted = 8;
-        break;
-
-    case ADD_A_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_B_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, BC.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_C_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, BC.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_D_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, DE.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_E_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, DE.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_H_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, HL.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_L_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, HL.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case ADC_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, memoryUnit->Read(HL.data), true);
-        cyclesExecuted = 8;
-        break;
-
-    case ADC_A_A:
-        //4 Clock Cycles
-        AF.hi = add8BitRegister(AF.hi, AF.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_B_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, BC.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_C_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, BC.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_D_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_E_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, DE.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_H_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, HL.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_L_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case SUB_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, memoryUnit->Read(HL.data));
-        cyclesExecuted = 8;
-        break;
-
-    case SUB_A_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_B_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, BC.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_C_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, BC.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_D_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, DE.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_E_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, DE.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_H_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, HL.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_L_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, HL.lo, true);
-        cyclesExecuted = 4;
-        break;
-
-    case SBC_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, memoryUnit->Read(HL.data), true);
-        cyclesExecuted = 8;
-        break;
-
-    case SBC_A_A:
-        //4 Clock Cycles
-        AF.hi = sub8BitRegister(AF.hi, AF.hi, true);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_B_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, BC.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_C_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, BC.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_D_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_E_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, DE.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_H_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, HL.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_L_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case AND_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, memoryUnit->Read(HL.data));
-        cyclesExecuted = 8;
-        break;
-
-    case AND_A_A:
-        //4 Clock Cycles
-        AF.hi = and8BitRegister(AF.hi, AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_B_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, BC.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_C_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, BC.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_D_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_E_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, DE.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_H_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, HL.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_L_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case XOR_adrHL_A:
-        //8 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, memoryUnit->Read(HL.data));
-        cyclesExecuted = 8;
-        break;
-
-    case XOR_A_A:
-        //4 Clock Cycles
-        AF.hi = xor8BitRegister(AF.hi, AF.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case OR_B_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, BC.hi);
-        cyclesExecuted = 4;
-        break;
-
-    case OR_C_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, BC.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case OR_D_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
+        cyclesExecuted = 12;
+        END_INSTRUCTION();
 
-    case OR_E_A:
+    OPCODE(SET_CARRY_FLAG):
         //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, DE.lo);
+        CPU_FLAG_BIT_RESET(N_FLAG);
+        CPU_FLAG_BIT_RESET(H_FLAG);
+        CPU_FLAG_BIT_SET(C_FLAG);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case OR_H_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, HL.hi);
-        cyclesExecuted = 4;
-        break;
+    OPCODE(RJmp_CARRY):
+        //8 Clock Cycles
+        byte = memoryUnit->Read(PC++);
+        if (CPU_FLAG_BIT_TEST(C_FLAG))
+        {
+            if (testBitInByte(byte, 7))
+                PC = PC - twoComp_Byte(byte);
+            else
+                PC = PC + byte;
+            memoryUnit->UpdateTimers(4);
+            cyclesExecuted = 12;
+        }
+        else
+            cyclesExecuted = 8;
+        END_INSTRUCTION();
 
-    case OR_L_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
+    OPCODE(ADD_SP_HL):
+        //8 Clock Cycles
+        HL.data = add16BitRegister(HL.data, SP);
+        cyclesExecuted = 8;
+        END_INSTRUCTION();
 
-    case OR_adrHL_A:
+    OPCODE(LDD_adrHL_A):
         //8 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, memoryUnit->Read(HL.data));
+        AF.hi = memoryUnit->Read(HL.data--);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case OR_A_A:
-        //4 Clock Cycles
-        AF.hi = or8BitRegister(AF.hi, AF.hi);
-        cyclesExecuted = 4;
-        break;
+    OPCODE(DEC_SP):
+        //8 Clock Cycles;
+        SP = decrement16BitRegister(SP);
+        cyclesExecuted = 8;
+        END_INSTRUCTION();
 
-    case CMP_B_A:
+    OPCODE(INC_A):
         //4 Clock Cycles
-        cmp8BitRegister(AF.hi, BC.hi);
+        AF.hi = increment8BitRegister(AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case CMP_C_A:
+    OPCODE(DEC_A):
         //4 Clock Cycles
-        cmp8BitRegister(AF.hi, BC.lo);
+        AF.hi = decrement8BitRegister(AF.hi);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case CMP_D_A:
-        //4 Clock Cycles
-        cmp8BitRegister(AF.hi, DE.hi);
-        cyclesExecuted = 4;
-        break;
+    OPCODE(LD_8IMM_A):
+        //8 Clock Cycles
+        AF.hi = memoryUnit->Read(PC++);
+        cyclesExecuted = 8;
+        END_INSTRUCTION();
 
-    case CMP_E_A:
+    OPCODE(COMP_CARRY_FLAG):
         //4 Clock Cycles
-        cmp8BitRegister(AF.hi, DE.lo);
-        cyclesExecuted = 4;
-        break;
+        if (CPU_FLAG_BIT_TEST(C_FLAG))
+            CPU_FLAG_BIT_RESET(C_FLAG);
+        else
+            CPU_FLAG_BIT_SET(C_FLAG);
 
-    case CMP_H_A:
-        //4 Clock Cycles
-        cmp8BitRegister(AF.hi, HL.hi);
+        CPU_FLAG_BIT_RESET(N_FLAG);
+        CPU_FLAG_BIT_RESET(H_FLAG);
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case CMP_L_A:
+    // LD r,r' and the ALU operations on registers, 0x40 to 0xBF but for
+    // HALT, are dispatched from the default case, see executeRegisterOp.
+    OPCODE(HALT):
         //4 Clock Cycles
-        cmp8BitRegister(AF.hi, HL.lo);
-        cyclesExecuted = 4;
-        break;
-
-    case CMP_adrHL_A:
-        //8 Clock Cycles
-        cmp8BitRegister(AF.hi, memoryUnit->Read(HL.data));
-        cyclesExecuted = 8;
-        break;
+        if (IME)
+            Halted = true;
+        else
+        {
+            if (memoryUnit->GetPendingInterrupts() == 0)
+            {
+                Halted = true;
+            }
 
-    case CMP_A_A:
-        //4 Clock Cycles
-        cmp8BitRegister(AF.hi, AF.hi);
+            buggedHalt = true;
+        }
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case RET_NOT_ZERO:
+    OPCODE(RET_NOT_ZERO):
         //20/8 Clock Cycles
         if (!CPU_FLAG_BIT_TEST(Z_FLAG))
         {
@@ -1286,16 +814,16 @@ int Cpu::ExecuteNextOpCode()
             memoryUnit->UpdateTimers(4);
             cyclesExecuted = 8;
         }
-        break;
+        END_INSTRUCTION();
 
-    case POP_BC:
+    OPCODE(POP_BC):
         //12 Clock Cycles
         BC.lo = memoryUnit->Read(SP++);
         BC.hi = memoryUnit->Read(SP++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case JMP_NOT_ZERO:
+    OPCODE(JMP_NOT_ZERO):
         //16/12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -1307,18 +835,18 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case JMP:
+    OPCODE(JMP):
         //16 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
         PC = temp.data;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case CALL_NOT_ZERO:
+    OPCODE(CALL_NOT_ZERO):
         //24/12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -1334,23 +862,23 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case PUSH_BC:
+    OPCODE(PUSH_BC):
         //16 clock cycles
         memoryUnit->Write(--SP, BC.hi);
         memoryUnit->Write(--SP, BC.lo);
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case ADD_IMM_A:
+    OPCODE(ADD_IMM_A):
         //8 Clock Cycles
         AF.hi = add8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_0:
+    OPCODE(RST_0):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -1358,9 +886,9 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0000;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case RET_ZERO:
+    OPCODE(RET_ZERO):
         //8 Clock Cycles if cc false else 20 clock cycles
         if (CPU_FLAG_BIT_TEST(Z_FLAG))
         {
@@ -1375,18 +903,18 @@ int Cpu::ExecuteNextOpCode()
             memoryUnit->UpdateTimers(4);
             cyclesExecuted = 8;
         }
-        break;
+        END_INSTRUCTION();
 
-    case RETURN:
+    OPCODE(RETURN):
         //16 Clock Cycles
         temp.lo = memoryUnit->Read(SP++);
         temp.hi = memoryUnit->Read(SP++);
         PC = temp.data;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case JMP_ZERO:
+    OPCODE(JMP_ZERO):
         //16/12 Clock cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -1398,1580 +926,19 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case EXT_OP:
+    OPCODE(EXT_OP):
         //4 Clock Cycles, this opcode is special, it allows for 16 bit opcodes
         cyclesExecuted = 4;
         byte = memoryUnit->Read(PC++);
-        switch (byte)
-        {
-        case RLC_B:
-            //4 clock Cycles
-            BC.hi = rotateRegExt(true, false, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_C:
-            //4 clock Cycles
-            BC.lo = rotateRegExt(true, false, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_D:
-            //4 clock Cycles
-            DE.hi = rotateRegExt(true, false, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_E:
-            //4 clock Cycles
-            DE.lo = rotateRegExt(true, false, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_H:
-            //4 clock Cycles
-            HL.hi = rotateRegExt(true, false, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_L:
-            //4 clock Cycles
-            HL.lo = rotateRegExt(true, false, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RLC_adrHL:
-            //8 clock Cycles
-            byte = rotateRegExt(true, false, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case eRLC_A:
-            //4 clock Cycles
-            AF.hi = rotateRegExt(true, false, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_B:
-            //4 clock Cycles
-            BC.hi = rotateRegExt(false, false, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_C:
-            //4 clock Cycles
-            BC.lo = rotateRegExt(false, false, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_D:
-            //4 clock Cycles
-            DE.hi = rotateRegExt(false, false, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_E:
-            //4 clock Cycles
-            DE.lo = rotateRegExt(false, false, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_H:
-            //4 clock Cycles
-            HL.hi = rotateRegExt(false, false, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_L:
-            //4 clock Cycles
-            HL.lo = rotateRegExt(false, false, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RRC_adrHL:
-            //8 clock Cycles
-            byte = rotateRegExt(false, false, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case eRRC_A:
-            //4 clock Cycles
-            AF.hi = rotateRegExt(false, false, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_B:
-            //4 clock Cycles
-            BC.hi = rotateRegExt(true, true, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_C:
-            //4 clock Cycles
-            BC.lo = rotateRegExt(true, true, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_D:
-            //4 clock Cycles
-            DE.hi = rotateRegExt(true, true, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_E:
-            //4 clock Cycles
-            DE.lo = rotateRegExt(true, true, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_H:
-            //4 clock Cycles
-            HL.hi = rotateRegExt(true, true, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_L:
-            //4 clock Cycles
-            HL.lo = rotateRegExt(true, true, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RL_adrHL:
-            //12 clock Cycles
-            byte = rotateRegExt(true, true, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case eRL_A:
-            //4 clock Cycles
-            AF.hi = rotateRegExt(true, true, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_B:
-            //4 clock Cycles
-            BC.hi = rotateRegExt(false, true, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_C:
-            //4 clock Cycles
-            BC.lo = rotateRegExt(false, true, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_D:
-            //4 clock Cycles
-            DE.hi = rotateRegExt(false, true, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_E:
-            //4 clock Cycles
-            DE.lo = rotateRegExt(false, true, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_H:
-            //4 clock Cycles
-            HL.hi = rotateRegExt(false, true, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_L:
-            //4 clock Cycles
-            HL.lo = rotateRegExt(false, true, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RR_adrHL:
-            //8 clock Cycles
-            byte = rotateRegExt(false, true, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case eRR_A:
-            //4 clock Cycles
-            AF.hi = rotateRegExt(false, true, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_B:
-            //4 clock cycles
-            BC.hi = shiftReg(true, true, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_C:
-            //4 clock cycles
-            BC.lo = shiftReg(true, true, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_D:
-            //4 clock cycles
-            DE.hi = shiftReg(true, true, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_E:
-            //4 clock cycles
-            DE.lo = shiftReg(true, true, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_H:
-            //4 clock cycles
-            HL.hi = shiftReg(true, true, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_L:
-            //4 clock cycles
-            HL.lo = shiftReg(true, true, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SLA_adrHL:
-            //8 Clock Cycles
-            byte = shiftReg(true, true, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SLA_A:
-            //8 Clock Cycles
-            AF.hi = shiftReg(true, true, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_B:
-            //4 clock Cycles
-            BC.hi = shiftReg(false, true, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_C:
-            //4 clock Cycles
-            BC.lo = shiftReg(false, true, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_D:
-            //4 clock Cycles
-            DE.hi = shiftReg(false, true, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_E:
-            //4 clock Cycles
-            DE.lo = shiftReg(false, true, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_H:
-            //4 clock Cycles
-            HL.hi = shiftReg(false, true, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_L:
-            //4 clock Cycles
-            HL.lo = shiftReg(false, true, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRA_adrHL:
-            //8 clock Cycles
-            byte = shiftReg(false, true, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SRA_A:
-            //4 clock Cycles
-            AF.hi = shiftReg(false, true, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_B:
-            //4 Clock Cycles
-            BC.hi = swapReg(BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_C:
-            //4 Clock Cycles
-            BC.lo = swapReg(BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_D:
-            //4 Clock Cycles
-            DE.hi = swapReg(DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_E:
-            //4 Clock Cycles
-            DE.lo = swapReg(DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_H:
-            //4 Clock Cycles
-            HL.hi = swapReg(HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_L:
-            //4 Clock Cycles
-            HL.lo = swapReg(HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SWAP_adrHL:
-            //8 Clock Cycles
-            byte = swapReg(memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SWAP_A:
-            //4 Clock Cycles
-            AF.hi = swapReg(AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_B:
-            //4 Clock Cycles
-            BC.hi = shiftReg(false, false, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_C:
-            //4 Clock Cycles
-            BC.lo = shiftReg(false, false, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_D:
-            //4 Clock Cycles
-            DE.hi = shiftReg(false, false, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_E:
-            //4 Clock Cycles
-            DE.lo = shiftReg(false, false, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_H:
-            //4 Clock Cycles
-            HL.hi = shiftReg(false, false, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_L:
-            //4 Clock Cycles
-            HL.lo = shiftReg(false, false, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SRL_adrHL:
-            //8 Clock Cycles
-            byte = shiftReg(false, false, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SRL_A:
-            //4 Clock Cycles
-            AF.hi = shiftReg(false, false, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_B:
-            //4 Clock Cycles
-            testBit(0, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_C:
-            //4 Clock Cycles
-            testBit(0, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_D:
-            //4 Clock Cycles
-            testBit(0, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_E:
-            //4 Clock Cycles
-            testBit(0, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_H:
-            //4 Clock Cycles
-            testBit(0, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_L:
-            //4 Clock Cycles
-            testBit(0, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_1_adrHL:
-            //8 Clock Cycles
-            testBit(0, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_1_A:
-            //4 Clock Cycles
-            testBit(0, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_B:
-            //4 Clock Cycles
-            testBit(1, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_C:
-            //4 Clock Cycles
-            testBit(1, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_D:
-            //4 Clock Cycles
-            testBit(1, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_E:
-            //4 Clock Cycles
-            testBit(1, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_H:
-            //4 Clock Cycles
-            testBit(1, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_L:
-            //4 Clock Cycles
-            testBit(1, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_2_adrHL:
-            //8 Clock Cycles
-            testBit(1, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_2_A:
-            //4 Clock Cycles
-            testBit(1, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_B:
-            //4 Clock Cycles
-            testBit(2, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_C:
-            //4 Clock Cycles
-            testBit(2, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_D:
-            //4 Clock Cycles
-            testBit(2, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_E:
-            //4 Clock Cycles
-            testBit(2, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_H:
-            //4 Clock Cycles
-            testBit(2, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_L:
-            //4 Clock Cycles
-            testBit(2, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_3_adrHL:
-            //8 Clock Cycles
-            testBit(2, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_3_A:
-            //4 Clock Cycles
-            testBit(2, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_B:
-            //4 Clock Cycles
-            testBit(3, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_C:
-            //4 Clock Cycles
-            testBit(3, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_D:
-            //4 Clock Cycles
-            testBit(3, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_E:
-            //4 Clock Cycles
-            testBit(3, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_H:
-            //4 Clock Cycles
-            testBit(3, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_L:
-            //4 Clock Cycles
-            testBit(3, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_4_adrHL:
-            //8 Clock Cycles
-            testBit(3, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_4_A:
-            //4 Clock Cycles
-            testBit(3, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_B:
-            //4 Clock Cycles
-            testBit(4, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_C:
-            //4 Clock Cycles
-            testBit(4, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_D:
-            //4 Clock Cycles
-            testBit(4, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_E:
-            //4 Clock Cycles
-            testBit(4, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_H:
-            //4 Clock Cycles
-            testBit(4, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_L:
-            //4 Clock Cycles
-            testBit(4, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_5_adrHL:
-            //8 Clock Cycles
-            testBit(4, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_5_A:
-            //4 Clock Cycles
-            testBit(4, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_B:
-            //4 Clock Cycles
-            testBit(5, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_C:
-            //4 Clock Cycles
-            testBit(5, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_D:
-            //4 Clock Cycles
-            testBit(5, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_E:
-            //4 Clock Cycles
-            testBit(5, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_H:
-            //4 Clock Cycles
-            testBit(5, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_L:
-            //4 Clock Cycles
-            testBit(5, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_6_adrHL:
-            //8 Clock Cycles
-            testBit(5, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_6_A:
-            //4 Clock Cycles
-            testBit(5, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_B:
-            //4 Clock Cycles
-            testBit(6, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_C:
-            //4 Clock Cycles
-            testBit(6, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_D:
-            //4 Clock Cycles
-            testBit(6, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_E:
-            //4 Clock Cycles
-            testBit(6, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_H:
-            //4 Clock Cycles
-            testBit(6, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_L:
-            //4 Clock Cycles
-            testBit(6, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_7_adrHL:
-            //8 Clock Cycles
-            testBit(6, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_7_A:
-            //4 Clock Cycles
-            testBit(6, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_B:
-            //4 Clock Cycles
-            testBit(7, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_C:
-            //4 Clock Cycles
-            testBit(7, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_D:
-            //4 Clock Cycles
-            testBit(7, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_E:
-            //4 Clock Cycles
-            testBit(7, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_H:
-            //4 Clock Cycles
-            testBit(7, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_L:
-            //4 Clock Cycles
-            testBit(7, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case BIT_8_adrHL:
-            //8 Clock Cycles
-            testBit(7, memoryUnit->Read(HL.data));
-            cyclesExecuted += 8;
-            break;
-
-        case BIT_8_A:
-            //4 Clock Cycles
-            testBit(7, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(0, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(0, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(0, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(0, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(0, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(0, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_1_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(0, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_1_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(0, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(1, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(1, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(1, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(1, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(1, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(1, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_2_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(1, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_2_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(1, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(2, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(2, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(2, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(2, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(2, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(2, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_3_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(2, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_3_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(2, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(3, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(3, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(3, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(3, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(3, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(3, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_4_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(3, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_4_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(3, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(4, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(4, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(4, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(4, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(4, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(4, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_5_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(4, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_5_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(4, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(5, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(5, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(5, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(5, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(5, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(5, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_6_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(5, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_6_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(5, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(6, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(6, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(6, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(6, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(6, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(6, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_7_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(6, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_7_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(6, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_B:
-            //4 Clock Cycles
-            BC.hi = resetBit(7, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_C:
-            //4 Clock Cycles
-            BC.lo = resetBit(7, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_D:
-            //4 Clock Cycles
-            DE.hi = resetBit(7, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_E:
-            //4 Clock Cycles
-            DE.lo = resetBit(7, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_H:
-            //4 Clock Cycles
-            HL.hi = resetBit(7, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_L:
-            //4 Clock Cycles
-            HL.lo = resetBit(7, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case RES_8_adrHL:
-            //8 Clock Cycles
-            byte = resetBit(7, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case RES_8_A:
-            //4 Clock Cycles
-            AF.hi = resetBit(7, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_B:
-            //4 Clock Cycles
-            BC.hi = setBit(0, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_C:
-            //4 Clock Cycles
-            BC.lo = setBit(0, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_D:
-            //4 Clock Cycles
-            DE.hi = setBit(0, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_E:
-            //4 Clock Cycles
-            DE.lo = setBit(0, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_H:
-            //4 Clock Cycles
-            HL.hi = setBit(0, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_L:
-            //4 Clock Cycles
-            HL.lo = setBit(0, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_1_adrHL:
-            //8 Clock Cycles
-            byte = setBit(0, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_1_A:
-            //4 Clock Cycles
-            AF.hi = setBit(0, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_B:
-            //4 Clock Cycles
-            BC.hi = setBit(1, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_C:
-            //4 Clock Cycles
-            BC.lo = setBit(1, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_D:
-            //4 Clock Cycles
-            DE.hi = setBit(1, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_E:
-            //4 Clock Cycles
-            DE.lo = setBit(1, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_H:
-            //4 Clock Cycles
-            HL.hi = setBit(1, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_L:
-            //4 Clock Cycles
-            HL.lo = setBit(1, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_2_adrHL:
-            //8 Clock Cycles
-            byte = setBit(1, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_2_A:
-            //4 Clock Cycles
-            AF.hi = setBit(1, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_B:
-            //4 Clock Cycles
-            BC.hi = setBit(2, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_C:
-            //4 Clock Cycles
-            BC.lo = setBit(2, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_D:
-            //4 Clock Cycles
-            DE.hi = setBit(2, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_E:
-            //4 Clock Cycles
-            DE.lo = setBit(2, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_H:
-            //4 Clock Cycles
-            HL.hi = setBit(2, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_L:
-            //4 Clock Cycles
-            HL.lo = setBit(2, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_3_adrHL:
-            //8 Clock Cycles
-            byte = setBit(2, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_3_A:
-            //4 Clock Cycles
-            AF.hi = setBit(2, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_B:
-            //4 Clock Cycles
-            BC.hi = setBit(3, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_C:
-            //4 Clock Cycles
-            BC.lo = setBit(3, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_D:
-            //4 Clock Cycles
-            DE.hi = setBit(3, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_E:
-            //4 Clock Cycles
-            DE.lo = setBit(3, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_H:
-            //4 Clock Cycles
-            HL.hi = setBit(3, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_L:
-            //4 Clock Cycles
-            HL.lo = setBit(3, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_4_adrHL:
-            //8 Clock Cycles
-            byte = setBit(3, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_4_A:
-            //4 Clock Cycles
-            AF.hi = setBit(3, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_B:
-            //4 Clock Cycles
-            BC.hi = setBit(4, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_C:
-            //4 Clock Cycles
-            BC.lo = setBit(4, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_D:
-            //4 Clock Cycles
-            DE.hi = setBit(4, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_E:
-            //4 Clock Cycles
-            DE.lo = setBit(4, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_H:
-            //4 Clock Cycles
-            HL.hi = setBit(4, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_L:
-            //4 Clock Cycles
-            HL.lo = setBit(4, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_5_adrHL:
-            //8 Clock Cycles
-            byte = setBit(4, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_5_A:
-            //4 Clock Cycles
-            AF.hi = setBit(4, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_B:
-            //4 Clock Cycles
-            BC.hi = setBit(5, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_C:
-            //4 Clock Cycles
-            BC.lo = setBit(5, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_D:
-            //4 Clock Cycles
-            DE.hi = setBit(5, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_E:
-            //4 Clock Cycles
-            DE.lo = setBit(5, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_H:
-            //4 Clock Cycles
-            HL.hi = setBit(5, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_L:
-            //4 Clock Cycles
-            HL.lo = setBit(5, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_6_adrHL:
-            //8 Clock Cycles
-            byte = setBit(5, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_6_A:
-            //4 Clock Cycles
-            AF.hi = setBit(5, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_B:
-            //4 Clock Cycles
-            BC.hi = setBit(6, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_C:
-            //4 Clock Cycles
-            BC.lo = setBit(6, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_D:
-            //4 Clock Cycles
-            DE.hi = setBit(6, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_E:
-            //4 Clock Cycles
-            DE.lo = setBit(6, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_H:
-            //4 Clock Cycles
-            HL.hi = setBit(6, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_L:
-            //4 Clock Cycles
-            HL.lo = setBit(6, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_7_adrHL:
-            //8 Clock Cycles
-            byte = setBit(6, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_7_A:
-            //4 Clock Cycles
-            AF.hi = setBit(6, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_B:
-            //4 Clock Cycles
-            BC.hi = setBit(7, BC.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_C:
-            //4 Clock Cycles
-            BC.lo = setBit(7, BC.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_D:
-            //4 Clock Cycles
-            DE.hi = setBit(7, DE.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_E:
-            //4 Clock Cycles
-            DE.lo = setBit(7, DE.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_H:
-            //4 Clock Cycles
-            HL.hi = setBit(7, HL.hi);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_L:
-            //4 Clock Cycles
-            HL.lo = setBit(7, HL.lo);
-            cyclesExecuted += 4;
-            break;
-
-        case SET_8_adrHL:
-            //8 Clock Cycles
-            byte = setBit(7, memoryUnit->Read(HL.data));
-            memoryUnit->Write(HL.data, byte);
-            cyclesExecuted += 12;
-            break;
-
-        case SET_8_A:
-            //4 Clock Cycles
-            AF.hi = setBit(7, AF.hi);
-            cyclesExecuted += 4;
-            break;
-
-        default:
-            break;
-        }
-        break;
+#ifdef FUUGB_PROFILE
+        profiledOpcode = PROFILER_CB_OPCODES + byte;
+#endif
+        cyclesExecuted += (this->*extendedOpHandlers[byte])();
+        END_INSTRUCTION();
 
-    case CALL_ZERO:
+    OPCODE(CALL_ZERO):
         //24/12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -2987,9 +954,9 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case CALL:
+    OPCODE(CALL):
         //24 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -3002,15 +969,15 @@ int Cpu::ExecuteNextOpCode()
         }
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 24;
-        break;
+        END_INSTRUCTION();
 
-    case ADC_8IMM_A:
+    OPCODE(ADC_8IMM_A):
         //8 Clock Cycles
         AF.hi = add8BitRegister(AF.hi, memoryUnit->Read(PC++), true);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_8:
+    OPCODE(RST_8):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3018,9 +985,9 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0008;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case RET_NOCARRY:
+    OPCODE(RET_NOCARRY):
         //20/8 Clock Cycles
         if (!CPU_FLAG_BIT_TEST(C_FLAG))
         {
@@ -3035,16 +1002,16 @@ int Cpu::ExecuteNextOpCode()
             memoryUnit->UpdateTimers(4);
             cyclesExecuted = 8;
         }
-        break;
+        END_INSTRUCTION();
 
-    case POP_DE:
+    OPCODE(POP_DE):
         //12 Clock Cycles
         DE.lo = memoryUnit->Read(SP++);
         DE.hi = memoryUnit->Read(SP++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case JMP_NOCARRY:
+    OPCODE(JMP_NOCARRY):
         //16/12 Clock cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -3056,9 +1023,9 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case CALL_NOCARRY:
+    OPCODE(CALL_NOCARRY):
         //24/12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -3074,23 +1041,23 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case PUSH_DE:
+    OPCODE(PUSH_DE):
         //16 clock cycles
         memoryUnit->Write(--SP, DE.hi);
         memoryUnit->Write(--SP, DE.lo);
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case SUB_8IMM_A:
+    OPCODE(SUB_8IMM_A):
         //8 Clock Cycles
         AF.hi = sub8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_10:
+    OPCODE(RST_10):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3098,9 +1065,9 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0010;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case RET_CARRY:
+    OPCODE(RET_CARRY):
         //20/8 Clock Cycles
         if (CPU_FLAG_BIT_TEST(C_FLAG))
         {
@@ -3115,9 +1082,9 @@ int Cpu::ExecuteNextOpCode()
             memoryUnit->UpdateTimers(4);
             cyclesExecuted = 8;
         }
-        break;
+        END_INSTRUCTION();
 
-    case RET_INT:
+    OPCODE(RET_INT):
         //16 Clock Cycles
         temp.lo = memoryUnit->Read(SP++);
         temp.hi = memoryUnit->Read(SP++);
@@ -3125,9 +1092,9 @@ int Cpu::ExecuteNextOpCode()
         IME = true;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case JMP_CARRY:
+    OPCODE(JMP_CARRY):
         //16/12 Clock cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -3139,9 +1106,9 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case CALL_CARRY:
+    OPCODE(CALL_CARRY):
         //24/12 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
@@ -3157,15 +1124,15 @@ int Cpu::ExecuteNextOpCode()
         }
         else
             cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case SBC_8IMM_A:
+    OPCODE(SBC_8IMM_A):
         //8 Clock Cycles
         AF.hi = sub8BitRegister(AF.hi, memoryUnit->Read(PC++), true);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_18:
+    OPCODE(RST_18):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3173,42 +1140,42 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0018;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case LDH_A_IMMadr:
+    OPCODE(LDH_A_IMMadr):
         //12 Clock Cycles
         memoryUnit->Write((0xFF00 + memoryUnit->Read(PC++)), AF.hi);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case POP_HL:
+    OPCODE(POP_HL):
         //12 Clock Cycles
         HL.lo = memoryUnit->Read(SP++);
         HL.hi = memoryUnit->Read(SP++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LDH_A_C:
+    OPCODE(LDH_A_C):
         //8 Clock Cycles
         memoryUnit->Write((0xFF00 + BC.lo), AF.hi);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case PUSH_HL:
+    OPCODE(PUSH_HL):
         //16 clock cycles
         memoryUnit->Write(--SP, HL.hi);
         memoryUnit->Write(--SP, HL.lo);
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case AND_8IMM_A:
+    OPCODE(AND_8IMM_A):
         //8 Clock Cycles
         AF.hi = and8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_20:
+    OPCODE(RST_20):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3216,9 +1183,9 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0020;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case ADD_SIMM_SP:
+    OPCODE(ADD_SIMM_SP):
         //16 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (testBitInByte(byte, 7))
@@ -3254,29 +1221,29 @@ int Cpu::ExecuteNextOpCode()
         CPU_FLAG_BIT_RESET(N_FLAG);
         memoryUnit->UpdateTimers(8);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case JMP_adrHL:
+    OPCODE(JMP_adrHL):
         //4 Clock Cycles
         PC = HL.data;
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case LD_A_adr:
+    OPCODE(LD_A_adr):
         //16 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
         memoryUnit->Write(temp.data, AF.hi);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case XOR_8IMM_A:
+    OPCODE(XOR_8IMM_A):
         //8 Clock Cycles
         AF.hi = xor8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_28:
+    OPCODE(RST_28):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3284,48 +1251,48 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0028;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case LDH_IMMadr_A:
+    OPCODE(LDH_IMMadr_A):
         //12 Clock Cycles
         AF.hi = memoryUnit->Read(0xFF00 + memoryUnit->Read(PC++));
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case POP_AF:
+    OPCODE(POP_AF):
         //12 Clock Cycles
         AF.lo = 0xF0 & memoryUnit->Read(SP++);
         AF.hi = memoryUnit->Read(SP++);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LDH_C_A:
+    OPCODE(LDH_C_A):
         //8 Clock Cycles
         AF.hi = memoryUnit->Read(0xFF00 + BC.lo);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case DISABLE_INT:
+    OPCODE(DISABLE_INT):
         //4 Clock Cycles
         IME = false;
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case PUSH_AF:
+    OPCODE(PUSH_AF):
         //16 clock cycles
         memoryUnit->Write(--SP, AF.hi);
         memoryUnit->Write(--SP, AF.lo);
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case OR_8IMM_A:
+    OPCODE(OR_8IMM_A):
         //8 Clock Cycles
         AF.hi = or8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_30:
+    OPCODE(RST_30):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3333,9 +1300,9 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0030;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case LDHL_S_8IMM_SP_HL:
+    OPCODE(LDHL_S_8IMM_SP_HL):
         //12 Clock Cycles
         byte = memoryUnit->Read(PC++);
         if (testBitInByte(byte, 7))
@@ -3370,36 +1337,36 @@ int Cpu::ExecuteNextOpCode()
         CPU_FLAG_BIT_RESET(N_FLAG);
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 12;
-        break;
+        END_INSTRUCTION();
 
-    case LD_HL_SP:
+    OPCODE(LD_HL_SP):
         //8 Clock Cycles
         SP = HL.data;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case LD_16adr_A:
+    OPCODE(LD_16adr_A):
         //16 Clock Cycles
         temp.lo = memoryUnit->Read(PC++);
         temp.hi = memoryUnit->Read(PC++);
         AF.hi = memoryUnit->Read(temp.data);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    case ENABLE_INT:
+    OPCODE(ENABLE_INT):
         //4 Clock Cycles
         IME = true;
         cyclesExecuted = 4;
-        break;
+        END_INSTRUCTION();
 
-    case CMP_8IMM_A:
+    OPCODE(CMP_8IMM_A):
         //8 Clock Cycles
         cmp8BitRegister(AF.hi, memoryUnit->Read(PC++));
         cyclesExecuted = 8;
-        break;
+        END_INSTRUCTION();
 
-    case RST_38:
+    OPCODE(RST_38):
         //16 Clock Cycles
         temp.data = PC;
         memoryUnit->Write(--SP, temp.hi);
@@ -3407,20 +1374,247 @@ int Cpu::ExecuteNextOpCode()
         PC = 0x0038;
         memoryUnit->UpdateTimers(4);
         cyclesExecuted = 16;
-        break;
+        END_INSTRUCTION();
 
-    default:
-        break;
+    DEFAULT_OPCODE():
+        if (byte >= LD_B_B && byte <= CMP_A_A)
+            cyclesExecuted = (this->*registerOpHandlers[byte - LD_B_B])();
+        END_INSTRUCTION();
     }
+}
 
-#ifdef FUUGB_DEBUG
-    if (memoryUnit->DmaRead(0xFF02) == 0x81)
-    {
-        printf("%c", memoryUnit->DmaRead(0xFF01));
-        memoryUnit->DmaWrite(0xFF02, 0x00);
+// Fetches the opcode of the next instruction, executing the fusions found
+// on the way. Returns false if the batch ends before there is an opcode
+// to execute: at a breakpoint, or after a fusion.
+bool Cpu::fetchInstruction(int& cycles)
+{
+    while (true) {
+        // Stopping at a breakpoint executes nothing, the instruction is
+        // fetched again once the emulation resumes.
+        if (memoryUnit->IsWatchedPage(WATCH_EXECUTE, PC) && memoryUnit->HitExecuteWatch(PC))
+            return false;
+
+#ifdef FUUGB_PROFILE
+        profiledLocation = Profiler::Location(PC, memoryUnit->GetRomBank());
+#endif
+
+        byte = memoryUnit->Read(PC++);
+
+#ifdef FUUGB_PROFILE
+        profiledOpcode = byte;
+#endif
+
+        if (buggedHalt) {
+            PC--;
+            buggedHalt = false;
+            return true;
+        }
+
+        if (fusionHeads[byte] == 0)
+            return true;
+
+        int fusedCycles = executeFusion(fusionHeads[byte], cycles);
+        if (fusedCycles == 0)
+            return true;
+
+        cycles += fusedCycles;
+        if (!continueBatch(cycles))
+            return false;
     }
+}
+
+// Ends the instruction just executed. Returns whether the batch goes on,
+// with the opcode of the next one fetched.
+bool Cpu::nextInstruction(int& cycles)
+{
+#ifdef FUUGB_PROFILE
+    if (profiler != NULL) {
+        profiler->Record(profiledLocation, profiledOpcode, cyclesExecuted);
+    }
+#endif
+
+    executedInstructions++;
+    cycles += cyclesExecuted;
+    return continueBatch(cycles) && fetchInstruction(cycles);
+}
+
+// Called with the first opcode of the candidates fetched, once the batch
+// executed cycles. Returns the cycles executed, or 0 if none of them was
+// found and the opcode is executed alone.
+int Cpu::executeFusion(unsigned int candidates, int cycles) {
+    for (int i = 0; i < FUSION_COUNT; i++) {
+        if (!(candidates & (1 << i)) || fusions[i].cycles > batchBudget - cycles || !matchFusion(fusions[i]))
+            continue;
+
+        if (fusions[i].cycles > windowLeft(cycles))
+            continue;
+
+#ifdef FUUGB_PROFILE
+        // Profiles count the fusions that would have been executed, but keep
+        // executing and recording their instructions one by one.
+        if (profiler != NULL) {
+            profiler->RecordFusion(i);
+        }
+        return 0;
+#else
+        return (this->*fusions[i].execute)();
 #endif
-    return cyclesExecuted;
+    }
+
+    return 0;
+}
+
+bool Cpu::matchFusion(const Fusion& fusion) {
+    for (int i = 1; i < fusion.length; i++) {
+        if (fusion.pattern[i] >= 0 && memoryUnit->Read(PC + i - 1, true) != fusion.pattern[i])
+            return false;
+    }
+
+    return true;
+}
+
+// Ends a fusion after its first instructions, which is all of them unless
+// it had to stop early.
+int Cpu::finishFusion(int cycles, int instructions) {
+    executedInstructions += instructions;
+    cyclesExecuted = cycles;
+    return cycles;
+}
+
+// The rest of the machine is only updated once a fusion is over, which is
+// fine as long as nothing its instructions do would have been noticed in
+// between: the window rules out the ppu changing mode or line and the
+// apu's frame sequencer ticking, and the fusion stops short before a
+// write that any component, or the mapper, reacts to. It also stops as soon
+// as an interrupt is to be serviced, at the same instruction boundary as
+// without fusing.
+int Cpu::fuseCopyLoop() {
+    uWORD start = PC - 1;
+
+    // LD A,(HL+)
+    AF.hi = memoryUnit->Read(HL.data++);
+    int cycles = 8;
+
+    // LD (DE),A, left for the emulation loop if it writes anywhere but
+    // plain RAM, or over the loop itself.
+    if (interruptDispatchable() || DE.data < 0x8000 || DE.data >= 0xFF00 || (uWORD)(DE.data - start) < 8)
+        return finishFusion(cycles, 1);
+    fetchFusedOpcode();
+    memoryUnit->Write(DE.data, AF.hi);
+    cycles += 8;
+
+    // INC DE
+    if (interruptDispatchable())
+        return finishFusion(cycles, 2);
+    fetchFusedOpcode();
+    DE.data = increment16BitRegister(DE.data);
+    cycles += 8;
+
+    // DEC BC
+    if (interruptDispatchable())
+        return finishFusion(cycles, 3);
+    fetchFusedOpcode();
+    BC.data = decrement16BitRegister(BC.data);
+    cycles += 8;
+
+    // LD A,B
+    if (interruptDispatchable())
+        return finishFusion(cycles, 4);
+    fetchFusedOpcode();
+    AF.hi = BC.hi;
+    cycles += 4;
+
+    // OR C
+    if (interruptDispatchable())
+        return finishFusion(cycles, 5);
+    fetchFusedOpcode();
+    AF.hi = or8BitRegister(AF.hi, BC.lo);
+    cycles += 4;
+
+    // JR NZ,e
+    if (interruptDispatchable())
+        return finishFusion(cycles, 6);
+    fetchFusedOpcode();
+    byte = memoryUnit->Read(PC++);
+    if (!CPU_FLAG_BIT_TEST(Z_FLAG))
+    {
+        if (testBitInByte(byte, 7))
+            PC = PC - twoComp_Byte(byte);
+        else
+            PC = PC + byte;
+        memoryUnit->UpdateTimers(4);
+        cycles += 12;
+    }
+    else
+        cycles += 8;
+
+    return finishFusion(cycles, 7);
+}
+
+// Reads of the I/O registers have no side effects, so polling one needs
+// nothing more than the interrupt checks.
+int Cpu::fusePollCompare() {
+    // LDH A,(n)
+    AF.hi = memoryUnit->Read(0xFF00 + memoryUnit->Read(PC++));
+    int cycles = 12;
+
+    // CP n
+    if (interruptDispatchable())
+        return finishFusion(cycles, 1);
+    fetchFusedOpcode();
+    cmp8BitRegister(AF.hi, memoryUnit->Read(PC++));
+    cycles += 8;
+
+    // JR NZ,e
+    if (interruptDispatchable())
+        return finishFusion(cycles, 2);
+    fetchFusedOpcode();
+    byte = memoryUnit->Read(PC++);
+    if (!CPU_FLAG_BIT_TEST(Z_FLAG))
+    {
+        if (testBitInByte(byte, 7))
+            PC = PC - twoComp_Byte(byte);
+        else
+            PC = PC + byte;
+        memoryUnit->UpdateTimers(4);
+        cycles += 12;
+    }
+    else
+        cycles += 8;
+
+    return finishFusion(cycles, 3);
+}
+
+int Cpu::fusePollMask() {
+    // LDH A,(n)
+    AF.hi = memoryUnit->Read(0xFF00 + memoryUnit->Read(PC++));
+    int cycles = 12;
+
+    // AND n
+    if (interruptDispatchable())
+        return finishFusion(cycles, 1);
+    fetchFusedOpcode();
+    AF.hi = and8BitRegister(AF.hi, memoryUnit->Read(PC++));
+    cycles += 8;
+
+    // JR Z,e
+    if (interruptDispatchable())
+        return finishFusion(cycles, 2);
+    fetchFusedOpcode();
+    byte = memoryUnit->Read(PC++);
+    if (CPU_FLAG_BIT_TEST(Z_FLAG))
+    {
+        if (testBitInByte(byte, 7))
+            PC = PC - twoComp_Byte(byte);
+        else
+            PC = PC + byte;
+        memoryUnit->UpdateTimers(4);
+        cycles += 12;
+    }
+    else
+        cycles += 8;
+
+    return finishFusion(cycles, 3);
 }
 
 uWORD Cpu::increment16BitRegister(uWORD reg)
@@ -4325,70 +2519,25 @@ uBYTE Cpu::setBit(int pos, uBYTE reg)
     return (reg | (1 << pos));
 }
 
-void Cpu::CheckInterupts()
+// Returns whether an interrupt was serviced. The lowest pending one goes
+// first, from V-Blank to the joypad, and their vectors are 8 bytes apart.
+bool Cpu::CheckInterupts()
 {
-    if (!IME)
-        return;
+    if (!interruptDispatchable())
+        return false;
 
-    uBYTE IE = memoryUnit->DmaRead(INTERUPT_EN_REGISTER_ADR);
-    uBYTE IF = memoryUnit->DmaRead(INTERUPT_FLAG_REG);
+    int interrupt = lowestBit(memoryUnit->GetPendingInterrupts());
     reg Temp;
 
-    if ((IF & (1 << 0)) && (IE & (1 << 0))) //V-Blank
-    {
-        IME = false;
-        IF &= 0xFE;
-        memoryUnit->Write(INTERUPT_FLAG_REG, IF);
-        Temp.data = PC;
-        memoryUnit->Write(--SP, Temp.hi);
-        memoryUnit->Write(--SP, Temp.lo);
-        PC = VBLANK_INTERUPT_VECTOR;
-        memoryUnit->UpdateTimers(8);
-    }
-    else if ((IF & (1 << 1)) && (IE & (1 << 1))) // LCDC
-    {
-        IME = false;
-        IF &= 0xFD;
-        memoryUnit->Write(INTERUPT_FLAG_REG, IF);
-        Temp.data = PC;
-        memoryUnit->Write(--SP, Temp.hi);
-        memoryUnit->Write(--SP, Temp.lo);
-        PC = LCDC_INTERUPT_VECTOR;
-        memoryUnit->UpdateTimers(8);
-    }
-    else if ((IF & (1 << 2)) && (IE & (1 << 2))) // Timer Overflow
-    {
-        IME = false;
-        IF &= 0xFB;
-        memoryUnit->Write(INTERUPT_FLAG_REG, IF);
-        Temp.data = PC;
-        memoryUnit->Write(--SP, Temp.hi);
-        memoryUnit->Write(--SP, Temp.lo);
-        PC = TIMER_OVER_INTERUPT_VECTOR;
-        memoryUnit->UpdateTimers(8);
-    }
-    else if ((IF & (1 << 3)) && (IE & (1 << 3))) // Serial I/O Complete
-    {
-        IME = false;
-        IF &= 0xF7;
-        memoryUnit->Write(INTERUPT_FLAG_REG, IF);
-        Temp.data = PC;
-        memoryUnit->Write(--SP, Temp.hi);
-        memoryUnit->Write(--SP, Temp.lo);
-        PC = SER_TRF_INTERUPT_VECTOR;
-        memoryUnit->UpdateTimers(8);
-    }
-    else if ((IF & (1 << 4)) && (IE & (1 << 4))) //Pin 10 - 13 hi to lo (Control Input)
-    {
-        IME = false;
-        IF &= 0xEF;
-        memoryUnit->Write(INTERUPT_FLAG_REG, IF);
-        Temp.data = PC;
-        memoryUnit->Write(--SP, Temp.hi);
-        memoryUnit->Write(--SP, Temp.lo);
-        PC = CONTROL_INTERUPT_VECTOR;
-        memoryUnit->UpdateTimers(8);
-    }
+    IME = false;
+    memoryUnit->Write(INTERUPT_FLAG_REG, memoryUnit->DmaRead(INTERUPT_FLAG_REG) & ~(1 << interrupt));
+    Temp.data = PC;
+    memoryUnit->Write(--SP, Temp.hi);
+    memoryUnit->Write(--SP, Temp.lo);
+    PC = VBLANK_INTERUPT_VECTOR + interrupt * 8;
+    memoryUnit->UpdateTimers(8);
+
+    return true;
 }
 
 uBYTE Cpu::adjustDAA(uBYTE reg)
@@ -4431,25 +2580,7 @@ void Cpu::Halt()
         return;
     }
 
-    uBYTE IE = memoryUnit->DmaRead(INTERUPT_EN_REGISTER_ADR);
-    uBYTE IF = memoryUnit->DmaRead(INTERUPT_FLAG_REG);
-    if ((IF & (1 << 0)) && (IE & (1 << 0))) //V-Blank
-    {
-        Halted = false;
-    }
-    else if ((IF & (1 << 1)) && (IE & (1 << 1))) // LCDC
-    {
-        Halted = false;
-    }
-    else if ((IF & (1 << 2)) && (IE & (1 << 2))) // Timer Overflow
-    {
-        Halted = false;
-    }
-    else if ((IF & (1 << 3)) && (IE & (1 << 3))) // Serial I/O Complete
-    {
-        Halted = false;
-    }
-    else if ((IF & (1 << 4)) && (IE & (1 << 4))) //Pin 10 - 13 hi to lo (Control Input)
+    if (memoryUnit->GetPendingInterrupts() != 0)
     {
         Halted = false;
     }
@@ -3,37 +3,93 @@
 const int CyclesPerFrame = CPU_FREQUENCY_HZ / 60;
 const double singleFramePeriod = 1.0 / 60.0;
 
-Gameboy::Gameboy() {}
+// Creates a headless gameboy, with no rendering context nor audio output.
+Gameboy::Gameboy() {
+    cpu.SetMemory(&memory);
+    apu.SetMemory(&memory);
+    ppu.SetMemory(&memory);
 
-Gameboy::~Gameboy() {}
+    running = false;
+    pause = false;
+    requireRender = false;
+    finished = false;
+    runAheadFrames = 0;
+    syncMode = SYNC_VIDEO;
+    cycleCount = 0;
+    instructionCount = 0;
+    interruptCount = 0;
+    frameStatsCount = 0;
+
+    for (int i = 0; i < 3; i++) {
+        debugSnapshots[i].regions.Clear();
+        debugSnapshots[i].watchHitCount = 0;
+        memset(debugSnapshots[i].vramSerials, 0x00, sizeof(debugSnapshots[i].vramSerials));
+    }
+    debugSnapshotCount = 0;
+    memset(vramSerials, 0x00, sizeof(vramSerials));
+    debugBackBuffer = 0;
+    debugFrontBuffer = 1;
+    debugSnapshotSlot = 2;
+    for (int i = 0; i < DEBUG_CHUNK_COUNT / 64; i++) {
+        debugRegions[i] = 0;
+    }
+    hasDebugWrites = false;
+    hasWatchpoints = false;
+    hasJoypadInput = false;
+    watchHitCount = 0;
+    tracingInstructions = false;
+    instructionTrace = NULL;
+    traceComparator = NULL;
+    profiler = NULL;
+    lastTracedCycle = 0;
+    rewoundCycleCount = 0;
+
+    memory.SetWatchHook([this](const Memory::WatchHit& hit) { HitWatchpoint(hit); });
+    cpu.SetBatchWindowHook([this]() { return batchWindow(); });
+}
 
-Gameboy::Gameboy(uBYTE* romData, GLFWwindow* context) {
+// Creates a headless gameboy running the given rom. Its frames can
+// only be seen through a video sink.
+Gameboy::Gameboy(uBYTE* romData) : Gameboy() {
     memory.ReadRom(romData);
+}
 
-    cpu.SetMemory(&memory);
-    apu.SetMemory(&memory);
-    ppu.SetMemory(&memory);
+Gameboy::~Gameboy() {
+    if (videoSink != NULL) {
+        videoSink->Close();
+    }
+}
 
+// Creates a gameboy running the given rom, rendering to the given window.
+Gameboy::Gameboy(uBYTE* romData, GLFWwindow* context) : Gameboy(romData) {
     Shader vertexShader = Shader("src/opengl/shaders/Vertex.shader");
     Shader fragmentShader = Shader("src/opengl/shaders/Fragment.shader");
 
     ppu.AttachShaders(vertexShader, fragmentShader);
     ppu.InitializeGLBuffers();
-
-    requireRender = false;
 }
 
 void Gameboy::WaitRender() {
+    TRACE_ZONE("WaitRender");
     std::unique_lock<std::mutex> lock(mtx);
     renderingCV.wait(lock);
     lock.unlock();
 }
 
+// While paused, snapshots keep being published so that the debugger
+// gets to see the regions it asks for, and the edits it makes. One more
+// is published on resuming, so that edits and watchpoints changed right
+// before take effect. Resuming clears the pause under the lock, so that
+// it is not missed if it happens while a snapshot is being published.
 void Gameboy::WaitResume() {
     std::unique_lock<std::mutex> lock(mtx);
-    pauseCV.wait(lock);
+    PublishDebugSnapshot();
+    while (!pauseCV.wait_for(lock, DEBUG_SNAPSHOT_PAUSED_PERIOD, [this] { return !pause; })) {
+        PublishDebugSnapshot();
+    }
     lock.unlock();
     pause = false;
+    PublishDebugSnapshot();
 }
 
 void Gameboy::Pause() {
@@ -41,6 +97,8 @@ void Gameboy::Pause() {
 }
 
 void Gameboy::Resume() {
+    std::lock_guard<std::mutex> lock(mtx);
+    pause = false;
     pauseCV.notify_one();
 }
 
@@ -53,7 +111,7 @@ void Gameboy::Stop() {
     running = false;
     while (!finished) {
         renderingCV.notify_one();
-        pauseCV.notify_one();
+        Resume();
     }
     thread->join();
 }
@@ -61,11 +119,15 @@ void Gameboy::Stop() {
 void Gameboy::SkipBootRom() {
     cpu.SetPostBootRomState();
     memory.SetPostBootRomState();
+    apu.RefreshRegisters();
 }
 
 void Gameboy::Run() {
+    TRACE_THREAD("Emulation");
+
     // For FPS Capping
     double lastFrameTimeStamp = glfwGetTime();
+    double frameStartTimeStamp = lastFrameTimeStamp;
 
 #ifdef FUUGB_DEBUG
     int frames = 0;
@@ -74,42 +136,24 @@ void Gameboy::Run() {
 
     // Main gameboy loop
     while (running) {
+        TRACE_ZONE("Frame");
 
-        // We emulate the gameboy by keeping track of the clock cycles
-        // that the cpu has executed. The gameboy's ppu refreshes the display
-        // 60 times a second. The inverse of this frequency means that we need to 
-        // render the screen every 66905 clock cycles.
-        int cyclesThisUpdate = 0;
-
-        while (cyclesThisUpdate <= CyclesPerFrame) {
-            int cycles = 0;
+        FrameStats stats;
+        uint64_t frameCycles = cycleCount;
+        uint64_t frameInstructions = instructionCount;
+        uint64_t frameInterrupts = interruptCount;
 
-            // If gameboy is paused, pause the thread
-            if (pause) {
-                WaitResume();
-            }
-
-            // If cpu is halted, halt it
-            if (cpu.Halted) {
-                cycles = 4;
-                memory.UpdateTimers(cycles);
-                cpu.Halt();
-            }
-            else {
-                cycles = cpu.ExecuteNextOpCode();
-            }
+        if (runAheadFrames > 0) {
+            RunAheadFrame();
+        }
+        else {
+            RunFrame(false);
+        }
 
-            // Update components
-            cyclesThisUpdate += cycles;
-            ppu.UpdateGraphics(cycles);
-            memory.UpdateDmaCycles(cycles);
-            apu.UpdateSound(cycles);
+        OutputFrame();
+        PublishDebugSnapshot();
 
-            // Process interrupts
-            if (!cpu.Halted) {
-                cpu.CheckInterupts();
-            }
-        }
+        double emulationTimeStamp = glfwGetTime();
 
         // Not the fanciest solution, but here we wait
         // until at least a singleFramePeriod of time has
@@ -117,9 +161,14 @@ void Gameboy::Run() {
         // This is to avoid some machines with faster hardware
         // to have the gameboy run too quickly.
         // (This caps the emulation at ~60FPS)
+        // When synced to audio, the apu already blocked the emulation
+        // for as long as the audio device needed, so there is no waiting.
         double currentTime = glfwGetTime();
-        while (currentTime - lastFrameTimeStamp < singleFramePeriod)
-            currentTime = glfwGetTime();
+        if (syncMode != SYNC_AUDIO || !apu.HasRealTimeAudioOutput()) {
+            TRACE_ZONE("FrameCap");
+            while (currentTime - lastFrameTimeStamp < singleFramePeriod)
+                currentTime = glfwGetTime();
+        }
 
         lastFrameTimeStamp = glfwGetTime();
 
@@ -127,6 +176,19 @@ void Gameboy::Run() {
         requireRender = true;
         WaitRender();
 
+        double frameEndTimeStamp = glfwGetTime();
+        stats.frameTime = frameEndTimeStamp - frameStartTimeStamp;
+        stats.emulationTime = emulationTimeStamp - frameStartTimeStamp;
+        stats.capTime = lastFrameTimeStamp - emulationTimeStamp;
+        stats.renderWaitTime = frameEndTimeStamp - lastFrameTimeStamp;
+        stats.emulatedTime = (double)(cycleCount - frameCycles) / CPU_FREQUENCY_HZ;
+        stats.audioRingFill = apu.GetAudioRingFill();
+        stats.instructions = instructionCount - frameInstructions;
+        stats.interrupts = interruptCount - frameInterrupts;
+        stats.underruns = apu.GetUnderrunCount();
+        PublishFrameStats(stats);
+        frameStartTimeStamp = frameEndTimeStamp;
+
 #ifdef FUUGB_DEBUG
         frames++;
         if (currentTime - lastFPSCounterTimestamp >= 1.0) {
@@ -140,6 +202,466 @@ void Gameboy::Run() {
     finished = true;
 }
 
+// Speculative frames are the ones run-ahead rewinds afterwards.
+void Gameboy::RunFrame(bool speculative) {
+    TRACE_ZONE("RunFrame");
+
+    // We emulate the gameboy by keeping track of the clock cycles
+    // that the cpu has executed. The gameboy's ppu refreshes the display
+    // 60 times a second. The inverse of this frequency means that we need to 
+    // render the screen every 66905 clock cycles.
+    int cyclesThisUpdate = 0;
+
+    // Input that arrives during speculative frames is left queued, otherwise the
+    // joypad interrupt it requests would be lost along with them. It is applied
+    // to the real timeline, at the start of the next real frame.
+    if (!speculative) {
+        applyJoypadInput();
+    }
+
+    // The apu is skipped entirely for frames that will be rewound. It always
+    // runs for real frames, even without an audio output, as its sweep writes
+    // the swept frequency back to NR13 and NR14; only the synthesis of its
+    // samples is skipped then.
+    bool soundEnabled = !speculative;
+
+    while (cyclesThisUpdate <= CyclesPerFrame) {
+        int cycles = 0;
+
+        // If gameboy is paused, pause the thread. Frames that will be rewound
+        // are finished first, so that the debugger is only ever shown the real
+        // timeline, and its edits are only applied to it.
+        if (pause && !speculative) {
+            WaitResume();
+        }
+
+        // If cpu is halted, halt it
+        if (cpu.Halted) {
+            cycles = 4;
+            memory.UpdateTimers(cycles);
+            cpu.Halt();
+
+            if (tracingInstructions) {
+                traceInstruction(cycleCount + cyclesThisUpdate, true);
+            }
+        }
+        else {
+            if (tracingInstructions) {
+                traceInstruction(cycleCount + cyclesThisUpdate, false);
+            }
+
+            // The cpu executes instructions in batches, see Cpu::Execute, except
+            // whenever the debugger or a trace must see every one of them. The
+            // debugger's watchpoints may change whenever the emulation pauses.
+            // Nothing may be batched across the end of the frame, or during OAM DMA.
+            bool batching = !tracingInstructions && !memory.HasWatches();
+            int budget = 0;
+            if (batching && !memory.IsDmaInProgress()) {
+                budget = CyclesPerFrame - cyclesThisUpdate;
+            }
+
+            cycles = cpu.Execute(budget);
+
+            // Stopped at a breakpoint, pause before executing anything.
+            if (cycles == 0)
+                continue;
+        }
+
+        // Update components
+        cyclesThisUpdate += cycles;
+        ppu.UpdateGraphics(cycles);
+        memory.UpdateDmaCycles(cycles);
+
+        if (soundEnabled) {
+            apu.UpdateSound(cycles);
+        }
+
+        // Process interrupts
+        if (!cpu.Halted && cpu.CheckInterupts()) {
+            interruptCount++;
+        }
+    }
+
+    if (soundEnabled) {
+        apu.EndFrame();
+    }
+
+    cycleCount += cyclesThisUpdate;
+    instructionCount += cpu.TakeExecutedInstructions();
+
+    if (profiler != NULL) {
+        profiler->ResetIfRequested();
+    }
+}
+
+// The cycles a batch of instructions may have taken and still start another
+// one, without the ppu or the apu having needed an update in between. The
+// apu's frame sequencer may not tick within the batch at all, whatever that
+// instruction is. It is accounted for even when the apu is not being
+// updated, for simplicity.
+int Gameboy::batchWindow() {
+    return std::min(ppu.CyclesUntilEvent(), apu.CyclesUntilFrameSequencerTick() - CPU_MAX_INSTRUCTION_CYCLES);
+}
+
+// Run-ahead hides the latency between an input and the game reacting to it.
+// The real frame is emulated without drawing, the machine is snapshotted, and
+// the following runAheadFrames frames are emulated silently using the current
+// input. The last of those is what gets presented, after which the snapshot is
+// restored so that the real timeline continues from the real frame.
+void Gameboy::RunAheadFrame() {
+    if (!runAheadState) {
+        runAheadState = std::unique_ptr<State>(new State());
+    }
+
+    ppu.SetRenderingEnabled(false);
+    RunFrame(false);
+    SaveState(*runAheadState);
+
+    // Rewound frames are left out of instruction traces, cycles included.
+    bool tracing = tracingInstructions;
+    uint64_t realCycleCount = cycleCount;
+    tracingInstructions = false;
+
+    // Neither do they hit watchpoints, which would pause the emulation in a
+    // future that is about to be rewound. The real frames hit them instead.
+    memory.SuspendWatches();
+
+    for (int i = 0; i < runAheadFrames; i++) {
+        // Only the frame that will be presented needs to be drawn.
+        ppu.SetRenderingEnabled(i == runAheadFrames - 1);
+        RunFrame(true);
+    }
+
+    memory.ResumeWatches();
+    tracingInstructions = tracing;
+    rewoundCycleCount += cycleCount - realCycleCount;
+
+    LoadState(*runAheadState);
+    ppu.SetRenderingEnabled(true);
+}
+
+void Gameboy::SaveState(State& state) {
+    cpu.SaveState(state.cpu);
+    memory.SaveState(state.memory);
+    ppu.SaveState(state.ppu);
+    apu.SaveState(state.apu);
+}
+
+void Gameboy::LoadState(const State& state) {
+    cpu.LoadState(state.cpu);
+    memory.LoadState(state.memory);
+    ppu.LoadState(state.ppu);
+    apu.LoadState(state.apu);
+}
+
+// Connects the apu to the given sink, with samples in the given format and rate.
+void Gameboy::InitializeAudio(std::unique_ptr<AudioSink> sink, AudioMixer::SampleFormat format, int sampleRate) {
+    apu.SetOutputFormat(format, sampleRate);
+    apu.SetAudioSink(std::move(sink));
+}
+
+// Sends every frame presented from now on to the given sink as well.
+void Gameboy::SetVideoSink(std::unique_ptr<VideoSink> sink) {
+    if (!sink->Open(NATIVE_SIZE_X, NATIVE_SIZE_Y)) {
+        fprintf(stderr, "error opening video output\n");
+        exit(EXIT_FAILURE);
+    }
+
+    videoSink = std::move(sink);
+}
+
+// Sets the function receiving the bytes the game sends through the serial port.
+void Gameboy::SetSerialHook(std::function<void(uBYTE)> hook) {
+    memory.SetSerialHook(hook);
+}
+
+// Records the instructions executed from now on into the given profiler.
+// Only builds made with FUUGB_PROFILE defined record anything.
+void Gameboy::SetProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+    cpu.SetProfiler(profiler);
+}
+
+// Records the state of the cpu before every instruction executed from now
+// on into the given trace, or stops recording if NULL.
+void Gameboy::SetInstructionTrace(InstructionTrace* trace) {
+    instructionTrace = trace;
+    tracingInstructions = (instructionTrace != NULL) || (traceComparator != NULL);
+    lastTracedCycle = cycleCount - rewoundCycleCount - 1;
+}
+
+// Enables the cpu's fusions whose bits are set, see Cpu::FindFusion.
+void Gameboy::SetFusions(unsigned int enabled) {
+    cpu.SetFusions(enabled);
+}
+
+// Checks the state of the cpu before every instruction executed from now on
+// against the given reference, or stops checking if NULL. The reference logs
+// expect LY to always read LY_STUB_VALUE, so it does while checking.
+void Gameboy::SetTraceComparator(TraceComparator* comparator) {
+    traceComparator = comparator;
+    tracingInstructions = (instructionTrace != NULL) || (traceComparator != NULL);
+    lastTracedCycle = cycleCount - rewoundCycleCount - 1;
+    memory.SetLyStubbed(traceComparator != NULL);
+}
+
+// Called before each instruction, and for every cycle spent halted,
+// with the amount of cycles emulated so far.
+void Gameboy::traceInstruction(uint64_t cycle, bool halted) {
+    cycle -= rewoundCycleCount;
+
+    // Only the instruction trace records halted stretches, and only once
+    // in a while.
+    if (halted && (instructionTrace == NULL || ((cycle - lastTracedCycle) >> 2) < INSTRUCTION_TRACE_SYNC_CYCLES))
+        return;
+
+    // Stopping at a breakpoint executes nothing, the instruction
+    // is only traced once it gets executed after resuming.
+    if (cycle == lastTracedCycle)
+        return;
+
+    lastTracedCycle = cycle;
+
+    Cpu::State state;
+    cpu.SaveState(state);
+
+    uBYTE pcmem[4];
+    for (int i = 0; i < 4; i++) {
+        pcmem[i] = memory.Read(state.PC + i, true);
+    }
+
+    if (instructionTrace != NULL) {
+        InstructionRecord record;
+        record.bank = memory.GetRomBank();
+        record.opcode = halted ? (uBYTE)Cpu::HALT : pcmem[0];
+        record.pc = state.PC;
+        record.af = state.AF;
+        record.bc = state.BC;
+        record.de = state.DE;
+        record.hl = state.HL;
+        record.sp = state.SP;
+        record.cycle = cycle >> 2;
+
+        instructionTrace->Record(record);
+    }
+
+    if (traceComparator != NULL && !halted) {
+        traceComparator->Compare(state, pcmem);
+    }
+}
+
+void Gameboy::SetRunAheadFrames(int frames) {
+    runAheadFrames = frames;
+}
+
+void Gameboy::SetSyncMode(SyncMode mode) {
+    syncMode = mode;
+    apu.SetSyncToAudio(mode == SYNC_AUDIO);
+}
+
+// Emulates frames on the calling thread. Meant for headless instances
+// (such as forks) that are not driven by Start().
+void Gameboy::RunFrames(int frames) {
+    for (int i = 0; i < frames; i++) {
+        RunFrame(false);
+        OutputFrame();
+    }
+}
+
+uint64_t Gameboy::GetCycleCount() {
+    return cycleCount;
+}
+
+// Copies the statistics of up to count of the last frames into stats, oldest
+// first, and returns how many were copied. Safe to call from any thread.
+int Gameboy::GetFrameStats(FrameStats* stats, int count) {
+    uint64_t published = frameStatsCount.load(std::memory_order_acquire);
+
+    // The oldest entry may be overwritten while being copied.
+    if (count > FRAME_STATS_HISTORY - 1) {
+        count = FRAME_STATS_HISTORY - 1;
+    }
+    if ((uint64_t)count > published) {
+        count = published;
+    }
+
+    for (int i = 0; i < count; i++) {
+        stats[i] = frameStats[(published - count + i) % FRAME_STATS_HISTORY];
+    }
+
+    return count;
+}
+
+void Gameboy::PublishFrameStats(const FrameStats& stats) {
+    uint64_t index = frameStatsCount.load(std::memory_order_relaxed);
+    frameStats[index % FRAME_STATS_HISTORY] = stats;
+    frameStatsCount.store(index + 1, std::memory_order_release);
+}
+
+void Gameboy::DebugRegions::Clear() {
+    memset(chunks, 0, sizeof(chunks));
+}
+
+// Adds the chunks overlapping the given range. The part of
+// it outside of the snapshotted range is ignored.
+void Gameboy::DebugRegions::Add(uWORD base, int length) {
+    int first = std::max((int)base, DEBUG_SNAPSHOT_BASE);
+    int last = base + length - 1;
+    if (last < first)
+        return;
+
+    for (int chunk = (first - DEBUG_SNAPSHOT_BASE) >> DEBUG_CHUNK_SHIFT; chunk <= (last - DEBUG_SNAPSHOT_BASE) >> DEBUG_CHUNK_SHIFT; chunk++) {
+        chunks[chunk / 64] |= 1ULL << (chunk % 64);
+    }
+}
+
+bool Gameboy::DebugRegions::Contains(uWORD base, int length) const {
+    DebugRegions range;
+    range.Clear();
+    range.Add(base, length);
+
+    for (int i = 0; i < DEBUG_CHUNK_COUNT / 64; i++) {
+        if ((chunks[i] & range.chunks[i]) != range.chunks[i])
+            return false;
+    }
+
+    return true;
+}
+
+// Sets which parts of the memory the next snapshots copy.
+void Gameboy::SetDebugRegions(const DebugRegions& regions) {
+    for (int i = 0; i < DEBUG_CHUNK_COUNT / 64; i++) {
+        debugRegions[i].store(regions.chunks[i], std::memory_order_relaxed);
+    }
+}
+
+// Returns the latest snapshot published. It stays untouched until the next
+// call, which must come from the same thread.
+const Gameboy::DebugSnapshot& Gameboy::AcquireDebugSnapshot() {
+    if (debugSnapshotSlot.load(std::memory_order_relaxed) & DEBUG_SNAPSHOT_FRESH) {
+        int slot = debugSnapshotSlot.exchange(debugFrontBuffer, std::memory_order_acq_rel);
+        debugFrontBuffer = slot & ~DEBUG_SNAPSHOT_FRESH;
+    }
+
+    return debugSnapshots[debugFrontBuffer];
+}
+
+// Writes a byte of memory on behalf of the debugger, once the
+// emulation thread gets to the end of the frame.
+void Gameboy::QueueDebugWrite(uWORD addr, uBYTE data) {
+    std::lock_guard<std::mutex> lock(debugWritesMtx);
+    debugWrites.push_back(std::make_pair(addr, data));
+    hasDebugWrites = true;
+}
+
+// Replaces the breakpoints and watchpoints, once the emulation thread
+// gets to the end of the frame.
+void Gameboy::SetWatchpoints(const std::vector<Watchpoint>& watchpoints) {
+    std::lock_guard<std::mutex> lock(debugWritesMtx);
+    pendingWatchpoints = watchpoints;
+    hasWatchpoints = true;
+}
+
+// Called from within the instruction making the access, so the emulation
+// pauses once it completes. Breakpoints pause before the instruction.
+void Gameboy::HitWatchpoint(const Memory::WatchHit& hit) {
+    watchHit = hit;
+    watchHitCount++;
+    cpu.EndBatch();
+    Pause();
+}
+
+// Applies the debugger's edits and watchpoints, then copies the registers and the
+// requested memory into the back buffer and swaps it out.
+void Gameboy::PublishDebugSnapshot() {
+    if (hasDebugWrites) {
+        std::lock_guard<std::mutex> lock(debugWritesMtx);
+        for (const std::pair<uWORD, uBYTE>& write : debugWrites) {
+            memory.DmaWrite(write.first, write.second);
+        }
+        debugWrites.clear();
+        hasDebugWrites = false;
+    }
+
+    if (hasWatchpoints) {
+        std::lock_guard<std::mutex> lock(debugWritesMtx);
+        memory.ClearWatches();
+        for (const Watchpoint& watchpoint : pendingWatchpoints) {
+            if (watchpoint.read)
+                memory.SetWatch(WATCH_READ, watchpoint.first, watchpoint.last);
+            if (watchpoint.write)
+                memory.SetWatch(WATCH_WRITE, watchpoint.first, watchpoint.last);
+            if (watchpoint.execute)
+                memory.SetWatch(WATCH_EXECUTE, watchpoint.first, watchpoint.last);
+        }
+        hasWatchpoints = false;
+    }
+
+    DebugSnapshot& snapshot = debugSnapshots[debugBackBuffer];
+    cpu.SaveState(snapshot.cpu);
+    snapshot.watchHit = watchHit;
+    snapshot.watchHitCount = watchHitCount;
+
+    for (int i = 0; i < DEBUG_CHUNK_COUNT / 64; i++) {
+        snapshot.regions.chunks[i] = debugRegions[i].load(std::memory_order_relaxed);
+    }
+
+    // VRAM written to since the last snapshot that held it is tagged with
+    // this one's number.
+    debugSnapshotCount++;
+    if (snapshot.regions.Contains(VRAM_ADR, VRAM_SIZE)) {
+        for (int block = 0; block < VRAM_BLOCK_COUNT; block++) {
+            if (memory.TakeVramDirty(block))
+                vramSerials[block] = debugSnapshotCount;
+        }
+    }
+    memcpy(snapshot.vramSerials, vramSerials, sizeof(vramSerials));
+
+    for (int chunk = 0; chunk < DEBUG_CHUNK_COUNT; chunk++) {
+        if (snapshot.regions.chunks[chunk / 64] & (1ULL << (chunk % 64))) {
+            int offset = chunk << DEBUG_CHUNK_SHIFT;
+            memory.CopyRange(DEBUG_SNAPSHOT_BASE + offset, 1 << DEBUG_CHUNK_SHIFT, &snapshot.memory[offset]);
+        }
+    }
+
+    int slot = debugSnapshotSlot.exchange(debugBackBuffer | DEBUG_SNAPSHOT_FRESH, std::memory_order_acq_rel);
+    debugBackBuffer = slot & ~DEBUG_SNAPSHOT_FRESH;
+}
+
+// Hands the frame that is presented to the video sink, if any.
+void Gameboy::OutputFrame() {
+    if (videoSink != NULL) {
+        videoSink->Write(ppu.GetFrameBuffer());
+    }
+}
+
+// Creates an independent, headless copy of this gameboy. The cartridge image
+// is shared and memory pages are shared until either side writes to them, so
+// a fork costs little more than the pages it ends up modifying.
+// Must be called from the thread emulating this instance, or while paused.
+std::unique_ptr<Gameboy> Gameboy::Fork() {
+    std::unique_ptr<Gameboy> child(new Gameboy());
+
+    memory.Fork(child->memory);
+
+    Cpu::State cpuState;
+    cpu.SaveState(cpuState);
+    child->cpu.LoadState(cpuState);
+
+    Ppu::State ppuState;
+    ppu.SaveState(ppuState);
+    child->ppu.LoadState(ppuState);
+
+    Apu::State apuState;
+    apu.SaveState(apuState);
+    child->apu.LoadState(apuState);
+
+    child->runAheadFrames = runAheadFrames;
+    child->syncMode = syncMode;
+
+    return child;
+}
+
 void Gameboy::HandleKeyboardInput(int key, int scancode, int action, int modBits) {
 
     // Ignore any keyboard action that is not PRESSED
@@ -158,64 +680,85 @@ void Gameboy::HandleKeyboardInput(int key, int scancode, int action, int modBits
     // Bit 0 - A
 
     if (action == GLFW_RELEASE) {
-        memory.joypadBuffer = 0xFF;
+        queueJoypadInput(0xFF, false);
         return;
     }
 
     if (key == GLFW_KEY_DOWN) {
-        memory.joypadBuffer &= ~(1 << 7);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 7, true);
         return;
     }
 
     if (key == GLFW_KEY_UP) {
-        memory.joypadBuffer &= ~(1 << 6);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 6, true);
         return;
     }
 
     if (key == GLFW_KEY_LEFT) {
-        memory.joypadBuffer &= ~(1 << 5);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 5, true);
         return;
     }
 
     if (key == GLFW_KEY_RIGHT) {
-        memory.joypadBuffer &= ~(1 << 4);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 4, true);
         return;
     }
 
     if (key == GLFW_KEY_C) {
-        memory.joypadBuffer &= ~(1 << 3);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 3, true);
         return;
     }
 
     if (key == GLFW_KEY_V) {
-        memory.joypadBuffer &= ~(1 << 2);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 2, true);
         return;
     }
 
     if (key == GLFW_KEY_X) {
-        memory.joypadBuffer &= ~(1 << 1);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 1, true);
         return;
     }
 
     if (key == GLFW_KEY_Z) {
-        memory.joypadBuffer &= ~(1 << 0);
-        memory.RequestInterupt(CONTROL_INT);
+        queueJoypadInput(1 << 0, true);
         return;
     }
 }
 
+// The input callbacks run on the window's thread, so the buttons are only
+// recorded here, and pressed or released by the emulation thread.
+void Gameboy::queueJoypadInput(uBYTE buttons, bool pressed) {
+    std::lock_guard<std::mutex> lock(joypadMtx);
+    joypadInput.push_back(std::make_pair(buttons, pressed));
+    hasJoypadInput = true;
+}
+
+// Presses and releases the buttons recorded since the last frame, in order.
+// Each press requests a joypad interrupt.
+void Gameboy::applyJoypadInput() {
+    if (!hasJoypadInput)
+        return;
+
+    std::lock_guard<std::mutex> lock(joypadMtx);
+    for (const std::pair<uBYTE, bool>& input : joypadInput) {
+        if (input.second) {
+            memory.joypadBuffer &= ~input.first;
+            memory.RequestInterupt(CONTROL_INT);
+        }
+        else {
+            memory.joypadBuffer |= input.first;
+        }
+    }
+    joypadInput.clear();
+    hasJoypadInput = false;
+}
+
 bool Gameboy::RequiresRender() {
     return requireRender;
 }
 
 void Gameboy::Render() {
+    TRACE_ZONE("Gameboy::Render");
     ppu.Render();
     requireRender = false;
     renderingCV.notify_one();
@@ -0,0 +1,174 @@
+#include "InstructionTrace.hpp"
+
+#include <string.h>
+#include <chrono>
+
+// Records encoded per write, so that the buffer stays small.
+#define INSTRUCTION_TRACE_BATCH_SIZE (1 << 16)
+
+InstructionTrace::InstructionTrace() {
+    output = NULL;
+    closing = false;
+    head = 0;
+    tail = 0;
+}
+
+InstructionTrace::~InstructionTrace() {
+    Close();
+}
+
+// Creates the trace file and starts the thread writing to it. The ring is
+// only allocated then, so that an unused trace costs nothing.
+bool InstructionTrace::Open(const std::string& path) {
+    output = fopen(path.c_str(), "wb");
+    if (output == NULL) {
+        return false;
+    }
+
+    records.resize(INSTRUCTION_TRACE_RING_SIZE);
+    fwrite(INSTRUCTION_TRACE_MAGIC, 1, INSTRUCTION_TRACE_MAGIC_SIZE, output);
+    memset(&previous, 0, sizeof(previous));
+    closing = false;
+    head = 0;
+    tail = 0;
+
+    writer = std::thread(&InstructionTrace::writeRecords, this);
+    return true;
+}
+
+// Writes the records left in the ring and closes the file. Must be
+// called from the recording thread, or once it stopped recording.
+bool InstructionTrace::Close() {
+    if (output == NULL) {
+        return true;
+    }
+
+    closing.store(true, std::memory_order_release);
+    writer.join();
+
+    bool written = !ferror(output);
+    written = (fclose(output) == 0) && written;
+    output = NULL;
+
+    return written;
+}
+
+void InstructionTrace::writeRecords() {
+    std::vector<uint8_t> buffer;
+    buffer.reserve(INSTRUCTION_TRACE_BATCH_SIZE * (sizeof(InstructionRecord) + 2));
+
+    while (true) {
+        // Closing is set after the last record, so it is read before the head.
+        bool closed = closing.load(std::memory_order_acquire);
+        uint64_t begin = tail.load(std::memory_order_relaxed);
+        uint64_t end = head.load(std::memory_order_acquire);
+
+        if (begin == end) {
+            if (closed)
+                break;
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        if (end - begin > INSTRUCTION_TRACE_BATCH_SIZE) {
+            end = begin + INSTRUCTION_TRACE_BATCH_SIZE;
+        }
+
+        buffer.clear();
+        for (uint64_t i = begin; i < end; i++) {
+            encode(records[i & (INSTRUCTION_TRACE_RING_SIZE - 1)], buffer);
+        }
+        tail.store(end, std::memory_order_release);
+
+        fwrite(buffer.data(), 1, buffer.size(), output);
+    }
+}
+
+void InstructionTrace::encode(const InstructionRecord& record, std::vector<uint8_t>& buffer) {
+    const uint8_t* bytes = (const uint8_t*)&record;
+    const uint8_t* previousBytes = (const uint8_t*)&previous;
+    uint16_t mask = 0;
+
+    for (unsigned int i = 0; i < sizeof(InstructionRecord); i++) {
+        if (bytes[i] != previousBytes[i])
+            mask |= 1 << i;
+    }
+
+    buffer.push_back(mask & 0xFF);
+    buffer.push_back(mask >> 8);
+    for (unsigned int i = 0; i < sizeof(InstructionRecord); i++) {
+        if (mask & (1 << i))
+            buffer.push_back(bytes[i]);
+    }
+
+    previous = record;
+}
+
+InstructionTraceReader::InstructionTraceReader() {
+    input = NULL;
+}
+
+InstructionTraceReader::~InstructionTraceReader() {
+    Close();
+}
+
+bool InstructionTraceReader::Open(const std::string& path) {
+    input = fopen(path.c_str(), "rb");
+    if (input == NULL) {
+        return false;
+    }
+
+    char magic[INSTRUCTION_TRACE_MAGIC_SIZE];
+    if (fread(magic, 1, sizeof(magic), input) != sizeof(magic) ||
+        memcmp(magic, INSTRUCTION_TRACE_MAGIC, sizeof(magic)) != 0) {
+        Close();
+        return false;
+    }
+
+    memset(&previous, 0, sizeof(previous));
+    cycle = 0;
+    first = true;
+    return true;
+}
+
+void InstructionTraceReader::Close() {
+    if (input != NULL) {
+        fclose(input);
+        input = NULL;
+    }
+}
+
+// Returns false at the end of the trace, or if it was cut short.
+bool InstructionTraceReader::Next(InstructionRecord& record) {
+    uint8_t maskBytes[2];
+    if (fread(maskBytes, 1, sizeof(maskBytes), input) != sizeof(maskBytes)) {
+        return false;
+    }
+
+    uint16_t mask = maskBytes[0] | (maskBytes[1] << 8);
+    uint16_t previousCycle = previous.cycle;
+    uint8_t* bytes = (uint8_t*)&previous;
+
+    for (unsigned int i = 0; i < sizeof(InstructionRecord); i++) {
+        if (!(mask & (1 << i)))
+            continue;
+
+        int byte = fgetc(input);
+        if (byte == EOF)
+            return false;
+        bytes[i] = byte;
+    }
+
+    if (!first) {
+        cycle += (uint16_t)(previous.cycle - previousCycle);
+    }
+    first = false;
+
+    record = previous;
+    return true;
+}
+
+uint64_t InstructionTraceReader::GetCycle() {
+    return cycle;
+}
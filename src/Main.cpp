@@ -4,11 +4,24 @@
 #include <iostream>
 #include <string.h>
 #include <fstream>
+#include <sstream>
+#include <vector>
 #include <csignal>
 
 #include "SideNav.hpp"
 #include "Gameboy.hpp"
 #include "Apu.hpp"
+#include "audio/NullAudioSink.hpp"
+#include "audio/PulseAudioSink.hpp"
+#include "audio/WavAudioSink.hpp"
+#include "audio/RawAudioSink.hpp"
+#include "video/NullVideoSink.hpp"
+#include "video/ImageVideoSink.hpp"
+#include "video/Y4mVideoSink.hpp"
+#include "video/HashVideoSink.hpp"
+#include "Profiler.hpp"
+#include "InstructionTrace.hpp"
+#include "TraceComparator.hpp"
 
 #define NATIVE_SIZE_X 160
 #define NATIVE_SIZE_Y 144
@@ -20,9 +33,40 @@ GLFWwindow* window;
 Gameboy* gameboy;
 
 bool skipBootRom = false;
+int runAheadFrames = 0;
+Gameboy::SyncMode syncMode = Gameboy::SYNC_VIDEO;
+AudioMixer::SampleFormat audioFormat = AudioMixer::SAMPLE_FORMAT_S16;
+int audioRate = AUDIO_SAMPLING_FREQUENCY_HZ;
+std::string audioSink = "";
+std::string audioOutput = "";
+std::string videoSink = "";
+std::string videoOutput = "";
+int videoFirstFrame = 0;
+int videoLastFrame = -1;
+std::vector<int> hashFrames;
+std::string goldenPath = "";
+HashVideoSink* hashSink = NULL;
+bool headless = false;
+int headlessFrames = 0;
+volatile sig_atomic_t interrupted = 0;
 bool imguiActive = true;
 bool imguiDisable = false;
 std::string romPath = "";
+std::string instructionTracePath = "";
+InstructionTrace instructionTrace;
+std::string compareTracePath = "";
+TraceComparator traceComparator;
+bool comparisonReported = false;
+unsigned int fusions = FUSION_ALL;
+
+#ifdef FUUGB_PROFILE
+Profiler profiler;
+std::string profileOutput = "fuugb-profile.json";
+#endif
+
+#ifdef FUUGB_TRACE
+std::string traceOutput = "fuugb-trace.json";
+#endif
 
 #ifdef FUUGB_DEBUG
 static void GLAPIENTRY MessageCallback(GLenum source,
@@ -45,6 +89,77 @@ void printUsage() {
     fprintf(stdout, "\tFuuGBemu [OPTIONS] <rom path>\n");
     fprintf(stdout, "Options:\n");
     fprintf(stdout, "\t--skip-boot-rom\t\tSkips the boot rom and enters the game code immediately.\n");
+    fprintf(stdout, "\t--run-ahead <frames>\tEmulates <frames> frames ahead of the displayed one to reduce input latency.\n");
+    fprintf(stdout, "\t--sync <video|audio>\tPaces the emulation with the host's timer (default) or with the audio device.\n");
+    fprintf(stdout, "\t--audio-format <s16|f32>\tSample format of the audio output (default s16).\n");
+    fprintf(stdout, "\t--audio-rate <48000|44100>\tSampling rate of the audio output (default 48000).\n");
+    fprintf(stdout, "\t--audio-sink <pulse|null|wav|raw>\tWhere the audio output goes (default pulse, or null when headless).\n");
+    fprintf(stdout, "\t--audio-output <path>\tFile written by the wav and raw sinks (- for the standard output with raw).\n");
+    fprintf(stdout, "\t--video-sink <null|image|y4m|hash>\tWhere frames go in addition to the window (default null).\n");
+    fprintf(stdout, "\t--video-output <path>\tImage path (with %%06d for the frame number) or y4m file (- for the standard output).\n");
+    fprintf(stdout, "\t--video-range <first>:<last>\tFrames dumped by the image sink (default all).\n");
+    fprintf(stdout, "\t--hash-frames <a,b,...>\tFrames whose hash the hash sink prints, or checks against the golden file.\n");
+    fprintf(stdout, "\t--golden <path>\t\tExpected frame hashes, exits with a failure if any differs.\n");
+    fprintf(stdout, "\t--headless\t\tRuns as fast as possible without a window.\n");
+    fprintf(stdout, "\t--frames <frames>\tStops a headless run after <frames> frames (default until interrupted).\n");
+    fprintf(stdout, "\t--instruction-trace <path>\tRecords the cpu state before every instruction, for fuugb-tracedump.\n");
+    fprintf(stdout, "\t--compare-trace <path>\tChecks the cpu state before every instruction against a gameboy-doctor log.\n");
+    fprintf(stdout, "\t--fusions <all|none|a,b,...>\tHot instruction sequences executed as one (default all: copy,poll,poll-mask).\n");
+#ifdef FUUGB_PROFILE
+    fprintf(stdout, "\t--profile-output <path>\tFile the execution profile is written to on exit (default fuugb-profile.json).\n");
+#endif
+#ifdef FUUGB_TRACE
+    fprintf(stdout, "\t--trace-output <path>\tFile the timeline is written to on F12 and on exit (default fuugb-trace.json).\n");
+#endif
+}
+
+std::unique_ptr<AudioSink> createAudioSink() {
+    if (audioSink == "null" || (audioSink.empty() && headless)) {
+        return std::unique_ptr<AudioSink>(new NullAudioSink());
+    }
+
+    if (audioSink == "wav" || audioSink == "raw") {
+        if (audioOutput.empty()) {
+            fprintf(stderr, "the %s audio sink requires an --audio-output path.\n", audioSink.c_str());
+            printUsage();
+            exit(EXIT_FAILURE);
+        }
+
+        if (audioSink == "wav") {
+            return std::unique_ptr<AudioSink>(new WavAudioSink(audioOutput));
+        }
+        return std::unique_ptr<AudioSink>(new RawAudioSink(audioOutput));
+    }
+
+    return std::unique_ptr<AudioSink>(new PulseAudioSink());
+}
+
+std::unique_ptr<VideoSink> createVideoSink() {
+    if (videoSink == "hash") {
+        if (!headless) {
+            fprintf(stderr, "the hash video sink requires --headless.\n");
+            printUsage();
+            exit(EXIT_FAILURE);
+        }
+
+        hashSink = new HashVideoSink(goldenPath, hashFrames);
+        return std::unique_ptr<VideoSink>(hashSink);
+    }
+
+    if (videoSink == "image" || videoSink == "y4m") {
+        if (videoOutput.empty()) {
+            fprintf(stderr, "the %s video sink requires a --video-output path.\n", videoSink.c_str());
+            printUsage();
+            exit(EXIT_FAILURE);
+        }
+
+        if (videoSink == "image") {
+            return std::unique_ptr<VideoSink>(new ImageVideoSink(videoOutput, videoFirstFrame, videoLastFrame));
+        }
+        return std::unique_ptr<VideoSink>(new Y4mVideoSink(videoOutput));
+    }
+
+    return std::unique_ptr<VideoSink>(new NullVideoSink());
 }
 
 void parseArguments(int argc, char** argv) {
@@ -64,6 +179,235 @@ void parseArguments(int argc, char** argv) {
             continue;
         }
 
+        if (token.find("--run-ahead") != std::string::npos) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "missing frame count for --run-ahead.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+
+            runAheadFrames = atoi(argv[++i]);
+            if (runAheadFrames < 0) {
+                fprintf(stderr, "invalid frame count for --run-ahead.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--sync") != std::string::npos) {
+            std::string mode = (i + 1 < argc) ? argv[++i] : "";
+            if (mode == "video") {
+                syncMode = Gameboy::SYNC_VIDEO;
+            }
+            else if (mode == "audio") {
+                syncMode = Gameboy::SYNC_AUDIO;
+            }
+            else {
+                fprintf(stderr, "invalid sync mode passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--audio-format") != std::string::npos) {
+            std::string format = (i + 1 < argc) ? argv[++i] : "";
+            if (format == "s16") {
+                audioFormat = AudioMixer::SAMPLE_FORMAT_S16;
+            }
+            else if (format == "f32") {
+                audioFormat = AudioMixer::SAMPLE_FORMAT_F32;
+            }
+            else {
+                fprintf(stderr, "invalid audio format passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--audio-rate") != std::string::npos) {
+            audioRate = (i + 1 < argc) ? atoi(argv[++i]) : 0;
+            if (audioRate != 48000 && audioRate != 44100) {
+                fprintf(stderr, "invalid audio rate passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--audio-sink") != std::string::npos) {
+            audioSink = (i + 1 < argc) ? argv[++i] : "";
+            if (audioSink != "pulse" && audioSink != "null" && audioSink != "wav" && audioSink != "raw") {
+                fprintf(stderr, "invalid audio sink passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--audio-output") != std::string::npos) {
+            audioOutput = (i + 1 < argc) ? argv[++i] : "";
+            if (audioOutput.empty()) {
+                fprintf(stderr, "invalid audio output passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--video-sink") != std::string::npos) {
+            videoSink = (i + 1 < argc) ? argv[++i] : "";
+            if (videoSink != "null" && videoSink != "image" && videoSink != "y4m" && videoSink != "hash") {
+                fprintf(stderr, "invalid video sink passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--video-output") != std::string::npos) {
+            videoOutput = (i + 1 < argc) ? argv[++i] : "";
+            if (videoOutput.empty()) {
+                fprintf(stderr, "invalid video output passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        // The last frame can be left out, as in "100:", to dump every frame from the first one on.
+        if (token.find("--video-range") != std::string::npos) {
+            std::string range = (i + 1 < argc) ? argv[++i] : "";
+            int fields = sscanf(range.c_str(), "%d:%d", &videoFirstFrame, &videoLastFrame);
+            if (fields < 1 || range.find(':') == std::string::npos || videoFirstFrame < 0 ||
+                (fields == 2 && videoLastFrame < videoFirstFrame)) {
+                fprintf(stderr, "invalid video range passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            if (fields == 1) {
+                videoLastFrame = -1;
+            }
+            continue;
+        }
+
+        if (token.find("--hash-frames") != std::string::npos) {
+            std::string list = (i + 1 < argc) ? argv[++i] : "";
+            std::stringstream stream(list);
+            std::string frame;
+            while (std::getline(stream, frame, ',')) {
+                hashFrames.push_back(atoi(frame.c_str()));
+                if (frame.empty() || hashFrames.back() < 0) {
+                    fprintf(stderr, "invalid hash frames passed.\n");
+                    printUsage();
+                    exit(EXIT_FAILURE);
+                }
+            }
+            continue;
+        }
+
+        if (token.find("--golden") != std::string::npos) {
+            goldenPath = (i + 1 < argc) ? argv[++i] : "";
+            if (goldenPath.empty()) {
+                fprintf(stderr, "invalid golden file passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--headless") != std::string::npos) {
+            headless = true;
+            continue;
+        }
+
+        if (token.find("--frames") != std::string::npos) {
+            headlessFrames = (i + 1 < argc) ? atoi(argv[++i]) : 0;
+            if (headlessFrames <= 0) {
+                fprintf(stderr, "invalid frame count passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--instruction-trace") != std::string::npos) {
+            instructionTracePath = (i + 1 < argc) ? argv[++i] : "";
+            if (instructionTracePath.empty()) {
+                fprintf(stderr, "invalid instruction trace passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--compare-trace") != std::string::npos) {
+            compareTracePath = (i + 1 < argc) ? argv[++i] : "";
+            if (compareTracePath.empty()) {
+                fprintf(stderr, "invalid reference trace passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+        if (token.find("--fusions") != std::string::npos) {
+            std::string list = (i + 1 < argc) ? argv[++i] : "";
+            if (list == "all") {
+                fusions = FUSION_ALL;
+                continue;
+            }
+
+            fusions = 0;
+            if (list == "none")
+                continue;
+
+            std::stringstream stream(list);
+            std::string name;
+            while (std::getline(stream, name, ',')) {
+                int fusion = Cpu::FindFusion(name);
+                if (fusion < 0) {
+                    fprintf(stderr, "invalid fusion passed: %s.\n", name.c_str());
+                    printUsage();
+                    exit(EXIT_FAILURE);
+                }
+                fusions |= 1 << fusion;
+            }
+
+            if (fusions == 0) {
+                fprintf(stderr, "invalid fusions passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+
+#ifdef FUUGB_PROFILE
+        if (token.find("--profile-output") != std::string::npos) {
+            profileOutput = (i + 1 < argc) ? argv[++i] : "";
+            if (profileOutput.empty()) {
+                fprintf(stderr, "invalid profile output passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+#endif
+
+#ifdef FUUGB_TRACE
+        if (token.find("--trace-output") != std::string::npos) {
+            traceOutput = (i + 1 < argc) ? argv[++i] : "";
+            if (traceOutput.empty()) {
+                fprintf(stderr, "invalid trace output passed.\n");
+                printUsage();
+                exit(EXIT_FAILURE);
+            }
+            continue;
+        }
+#endif
+
         // If the user entered another option, it is unrecognized.
         if (token.find("--") != std::string::npos) {
             fprintf(stderr, "invalid option passed.\n");
@@ -75,20 +419,169 @@ void parseArguments(int argc, char** argv) {
         // the expected argument is the rom path.
         romPath = token;
     }
+
+    // Asking for hashes implies the hash sink.
+    if (videoSink.empty() && (!hashFrames.empty() || !goldenPath.empty())) {
+        videoSink = "hash";
+    }
 }
 
+// Reported on stderr, as stdout may be carrying audio or video.
 void signalHandler(int signal) {
-    fprintf(stdout, "caught interrupt signal, terminating.\n");
-    glfwSetWindowShouldClose(window, GL_TRUE);
+    fprintf(stderr, "caught interrupt signal, terminating.\n");
+    interrupted = 1;
+
+    if (window != NULL)
+        glfwSetWindowShouldClose(window, GL_TRUE);
+}
+
+#ifdef FUUGB_PROFILE
+void dumpProfile() {
+    if (!profiler.Dump(profileOutput)) {
+        fprintf(stderr, "error writing profile to %s: %s\n", profileOutput.c_str(), strerror(errno));
+        return;
+    }
+
+    fprintf(stderr, "profile written to %s\n", profileOutput.c_str());
+}
+#endif
+
+#ifdef FUUGB_TRACE
+void exportTrace() {
+    if (!Trace::Export(traceOutput)) {
+        fprintf(stderr, "error writing trace to %s: %s\n", traceOutput.c_str(), strerror(errno));
+        return;
+    }
+
+    fprintf(stderr, "trace written to %s\n", traceOutput.c_str());
+}
+#endif
+
+void startInstructionTrace() {
+    if (!compareTracePath.empty()) {
+        if (!traceComparator.Open(compareTracePath)) {
+            fprintf(stderr, "error reading reference trace %s: %s\n", compareTracePath.c_str(), strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        gameboy->SetTraceComparator(&traceComparator);
+    }
+
+    if (instructionTracePath.empty())
+        return;
+
+    if (!instructionTrace.Open(instructionTracePath)) {
+        fprintf(stderr, "error creating instruction trace %s: %s\n", instructionTracePath.c_str(), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    gameboy->SetInstructionTrace(&instructionTrace);
+}
+
+// Reports the comparison once it stopped, pausing the emulation where the
+// states diverged. Returns whether it stopped.
+bool checkTraceComparison() {
+    if (compareTracePath.empty() || traceComparator.GetStatus() == TraceComparator::COMPARING)
+        return false;
+
+    if (!comparisonReported) {
+        traceComparator.Report(stderr);
+        comparisonReported = true;
+
+        if (traceComparator.GetStatus() == TraceComparator::DIVERGED && !headless)
+            gameboy->Pause();
+    }
+
+    return true;
+}
+
+// Must be called once the gameboy stopped emulating.
+void stopInstructionTrace() {
+    if (instructionTracePath.empty())
+        return;
+
+    if (!instructionTrace.Close()) {
+        fprintf(stderr, "error writing instruction trace to %s: %s\n", instructionTracePath.c_str(), strerror(errno));
+        return;
+    }
+
+    fprintf(stderr, "instruction trace written to %s\n", instructionTracePath.c_str());
 }
 
 void keyboardHandler(GLFWwindow* window, int key, int scancode, int action, int mods) {
+#ifdef FUUGB_TRACE
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS) {
+        exportTrace();
+        return;
+    }
+#endif
+
     if (gameboy != NULL)
         gameboy->HandleKeyboardInput(key, scancode, action, mods);
 }
 
+// Emulates without a window nor a rendering context, as fast as the
+// sinks allow, until the requested amount of frames ran or until interrupted.
+int runHeadless(uBYTE* romData) {
+    gameboy = new Gameboy(romData);
+    gameboy->InitializeAudio(createAudioSink(), audioFormat, audioRate);
+    gameboy->SetVideoSink(createVideoSink());
+    gameboy->SetFusions(fusions);
+
+#ifdef FUUGB_PROFILE
+    gameboy->SetProfiler(&profiler);
+#endif
+
+    if (skipBootRom) {
+        gameboy->SkipBootRom();
+    }
+
+    startInstructionTrace();
+
+    // When hashing, the run ends as soon as every hash is known.
+    if (hashSink != NULL && headlessFrames == 0) {
+        if (hashSink->LastFrame() < 0) {
+            fprintf(stderr, "no frames to hash.\n");
+            return EXIT_FAILURE;
+        }
+        headlessFrames = hashSink->LastFrame() + 1;
+    }
+
+    for (int frame = 0; !interrupted && (headlessFrames == 0 || frame < headlessFrames); frame++) {
+        gameboy->RunFrames(1);
+
+        if (checkTraceComparison())
+            break;
+    }
+
+    bool passed = (hashSink == NULL) || hashSink->Report();
+
+    if (!compareTracePath.empty()) {
+        if (!comparisonReported)
+            traceComparator.Report(stderr);
+        passed = passed && traceComparator.GetStatus() != TraceComparator::DIVERGED;
+    }
+
+    stopInstructionTrace();
+
+#ifdef FUUGB_PROFILE
+    dumpProfile();
+#endif
+
+#ifdef FUUGB_TRACE
+    exportTrace();
+#endif
+
+    delete gameboy;
+    delete[] romData;
+
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char** argv) {
 
+    TRACE_THREAD("Main");
+
     parseArguments(argc, argv);
 
     std::fstream romFile(romPath, std::ios::in | std::ios::binary);
@@ -105,6 +598,10 @@ int main(int argc, char** argv) {
     // Set interrupt signal handler
     signal(SIGINT, signalHandler);
 
+    if (headless) {
+        return runHeadless(romData);
+    }
+
     // Initialize glfw
     if (!glfwInit()) {
         const char* errMsg[1024];
@@ -152,6 +649,13 @@ int main(int argc, char** argv) {
 
     // Create a gameboy instance
     gameboy = new Gameboy(romData, window);
+    gameboy->InitializeAudio(createAudioSink(), audioFormat, audioRate);
+    gameboy->SetVideoSink(createVideoSink());
+    gameboy->SetFusions(fusions);
+
+#ifdef FUUGB_PROFILE
+    gameboy->SetProfiler(&profiler);
+#endif
 
     SideNav sideNav = SideNav(gameboy);
     if (!sideNav.Init(window))
@@ -162,6 +666,10 @@ int main(int argc, char** argv) {
         gameboy->SkipBootRom();
     }
 
+    gameboy->SetRunAheadFrames(runAheadFrames);
+    gameboy->SetSyncMode(syncMode);
+    startInstructionTrace();
+
     // Set viewport
     glViewport(0, 0, NATIVE_SIZE_X * SCALE, NATIVE_SIZE_Y * SCALE);
 
@@ -185,11 +693,27 @@ int main(int argc, char** argv) {
             gameboy->Render();
         }
 
+        checkTraceComparison();
+
         glfwSwapBuffers(window);
     }
 
     // Clean up
     gameboy->Stop();
+    stopInstructionTrace();
+
+    if (!compareTracePath.empty() && !comparisonReported) {
+        traceComparator.Report(stderr);
+    }
+
+#ifdef FUUGB_PROFILE
+    dumpProfile();
+#endif
+
+#ifdef FUUGB_TRACE
+    exportTrace();
+#endif
+
     sideNav.Shutdown();
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -1,19 +1,43 @@
 #include "Memory.hpp"
+#include "Apu.hpp"
 
-Memory::Memory() {
-    rom = new uBYTE[NATIVE_ROM_SIZE];
-    cartridge = new uBYTE[MAX_CART_SIZE];
+std::shared_ptr<uBYTE> allocatePage();
+
+// Page of zeroes that every page of a freshly constructed memory unit
+// refers to, until it is written to for the first time.
+static const std::shared_ptr<uBYTE> zeroPage = allocatePage();
 
-    memset(rom, 0x00, NATIVE_ROM_SIZE);
-    memset(cartridge, 0x00, MAX_CART_SIZE);
+std::shared_ptr<uBYTE> allocatePage() {
+    std::shared_ptr<uBYTE> page(new uBYTE[MEMORY_PAGE_SIZE], std::default_delete<uBYTE[]>());
+    memset(page.get(), 0x00, MEMORY_PAGE_SIZE);
+    return page;
 }
 
-Memory::~Memory() {
-    delete[] rom;
-    delete[] cartridge;
+Memory::Memory() {
+    for (int i = 0; i < MEMORY_PAGE_COUNT; i++) {
+        pageRefs[i] = zeroPage;
+        pages[i] = zeroPage.get();
+    }
+
+    dirtyPages = 0;
+    cartridge = nullptr;
+
+    for (int i = 0; i < VRAM_BLOCK_COUNT; i++) {
+        vramDirty[i] = 1;
+    }
+
+    ClearWatches();
+    memset(suspendedPages, 0, sizeof(suspendedPages));
+    lyStubbed = false;
+    registerWritten = false;
+    pendingInterrupts = 0;
 }
 
+Memory::~Memory() {}
+
 void Memory::ReadRom(uBYTE* data) {
+    cartridgeRef = std::shared_ptr<uBYTE>(new uBYTE[MAX_CART_SIZE], std::default_delete<uBYTE[]>());
+    cartridge = cartridgeRef.get();
     memcpy(cartridge, data, MAX_CART_SIZE);
 
     // Set the joypad buffer bits to HIGH
@@ -239,68 +263,240 @@ void Memory::ReadRom(uBYTE* data) {
     }
 
     // Special case for joypad register, inputs are held high by default
-    rom[JOYPAD_INPUT_REG] = 0xFF;
+    poke(JOYPAD_INPUT_REG, 0xFF);
 }
 
 void Memory::SetPostBootRomState() {
-    rom[JOYPAD_INPUT_REG] = 0xCF;
-    rom[0xFF01] = 0x00;
-    rom[0xFF02] = 0x7E;
-    rom[0xFF04] = 0x00;
-    rom[0xFF05] = 0x00;
-    rom[0xFF06] = 0x00;
-    rom[0xFF07] = 0xF8;
-    rom[0xFF0F] = 0xE1;
-    rom[0xFF10] = 0x80;
-    rom[0xFF11] = 0xBF;
-    rom[0xFF12] = 0xF3;
-    rom[0xFF13] = 0xFF;
-    rom[0xFF14] = 0xBF;
-    rom[0xFF16] = 0x3F;
-    rom[0xFF17] = 0x00;
-    rom[0xFF18] = 0xFF;
-    rom[0xFF19] = 0xBF;
-    rom[0xFF1A] = 0x7F;
-    rom[0xFF1B] = 0xFF;
-    rom[0xFF1C] = 0x9F;
-    rom[0xFF1D] = 0xFF;
-    rom[0xFF1E] = 0xBF;
-    rom[0xFF20] = 0xFF;
-    rom[0xFF21] = 0x00;
-    rom[0xFF22] = 0x00;
-    rom[0xFF23] = 0xBF;
-    rom[0xFF24] = 0x77;
-    rom[0xFF25] = 0xF3;
-    rom[0xFF26] = 0xF1;
-    rom[0xFF40] = 0x91;
-    rom[0xFF41] = 0x81;
-    rom[0xFF42] = 0x00;
-    rom[0xFF43] = 0x00;
-    rom[0xFF44] = 0x91;
-    rom[0xFF45] = 0x00;
-    rom[0xFF46] = 0xFF;
-    rom[0xFF47] = 0xFC;
-    rom[0xFF48] = 0x00;
-    rom[0xFF49] = 0x00;
-    rom[0xFF4A] = 0x00;
-    rom[0xFF4B] = 0x00;
-    rom[0xFF4D] = 0xFF;
-    rom[0xFF4F] = 0xFF;
-    rom[0xFF51] = 0xFF;
-    rom[0xFF52] = 0xFF;
-    rom[0xFF53] = 0xFF;
-    rom[0xFF54] = 0xFF;
-    rom[0xFF55] = 0xFF;
-    rom[0xFF56] = 0xFF;
-    rom[0xFF68] = 0xFF;
-    rom[0xFF69] = 0xFF;
-    rom[0xFF6A] = 0xFF;
-    rom[0xFF6B] = 0xFF;
-    rom[0xFF70] = 0xFF;
-    rom[0xFFFF] = 0x00;
+    poke(JOYPAD_INPUT_REG, 0xCF);
+    poke(0xFF01, 0x00);
+    poke(0xFF02, 0x7E);
+    poke(0xFF04, 0x00);
+    poke(0xFF05, 0x00);
+    poke(0xFF06, 0x00);
+    poke(0xFF07, 0xF8);
+    poke(0xFF0F, 0xE1);
+    poke(0xFF10, 0x80);
+    poke(0xFF11, 0xBF);
+    poke(0xFF12, 0xF3);
+    poke(0xFF13, 0xFF);
+    poke(0xFF14, 0xBF);
+    poke(0xFF16, 0x3F);
+    poke(0xFF17, 0x00);
+    poke(0xFF18, 0xFF);
+    poke(0xFF19, 0xBF);
+    poke(0xFF1A, 0x7F);
+    poke(0xFF1B, 0xFF);
+    poke(0xFF1C, 0x9F);
+    poke(0xFF1D, 0xFF);
+    poke(0xFF1E, 0xBF);
+    poke(0xFF20, 0xFF);
+    poke(0xFF21, 0x00);
+    poke(0xFF22, 0x00);
+    poke(0xFF23, 0xBF);
+    poke(0xFF24, 0x77);
+    poke(0xFF25, 0xF3);
+    poke(0xFF26, 0xF1);
+    poke(0xFF40, 0x91);
+    poke(0xFF41, 0x81);
+    poke(0xFF42, 0x00);
+    poke(0xFF43, 0x00);
+    poke(0xFF44, 0x91);
+    poke(0xFF45, 0x00);
+    poke(0xFF46, 0xFF);
+    poke(0xFF47, 0xFC);
+    poke(0xFF48, 0x00);
+    poke(0xFF49, 0x00);
+    poke(0xFF4A, 0x00);
+    poke(0xFF4B, 0x00);
+    poke(0xFF4D, 0xFF);
+    poke(0xFF4F, 0xFF);
+    poke(0xFF51, 0xFF);
+    poke(0xFF52, 0xFF);
+    poke(0xFF53, 0xFF);
+    poke(0xFF54, 0xFF);
+    poke(0xFF55, 0xFF);
+    poke(0xFF56, 0xFF);
+    poke(0xFF68, 0xFF);
+    poke(0xFF69, 0xFF);
+    poke(0xFF6A, 0xFF);
+    poke(0xFF6B, 0xFF);
+    poke(0xFF70, 0xFF);
+    poke(0xFFFF, 0x00);
+    updatePendingInterrupts();
     closeBootRom();
 }
 
+void Memory::SaveState(State& state) {
+    // The snapshot shares the pages, which are copied
+    // the next time either side writes to them.
+    for (int i = 0; i < MEMORY_PAGE_COUNT; i++) {
+        state.pages[i] = pageRefs[i];
+    }
+    dirtyPages = 0;
+
+    state.timerCounter = timerCounter;
+    state.dmaCyclesCompleted = dmaCyclesCompleted;
+    state.dividerRegisterCounter = dividerRegisterCounter;
+    state.bootRomClosed = bootRomClosed;
+    state.dmaTransferInProgress = dmaTransferInProgress;
+
+    // Only the banking attributes change at runtime, the rest
+    // are fixed by the cartridge header.
+    state.ramEnabled = attributes[ramEnabled];
+    state.romRamMode = attributes[romRamMode];
+    state.currentRomBank = currentRomBank;
+    state.currentRamBank = currentRamBank;
+}
+
+void Memory::LoadState(const State& state) {
+    markVramPagesDirty(state.pages);
+
+    for (int i = 0; i < MEMORY_PAGE_COUNT; i++) {
+        pageRefs[i] = state.pages[i];
+        pages[i] = pageRefs[i].get();
+    }
+    dirtyPages = 0;
+
+    timerCounter = state.timerCounter;
+    dmaCyclesCompleted = state.dmaCyclesCompleted;
+    dividerRegisterCounter = state.dividerRegisterCounter;
+    bootRomClosed = state.bootRomClosed;
+    dmaTransferInProgress = state.dmaTransferInProgress;
+
+    attributes[ramEnabled] = state.ramEnabled;
+    attributes[romRamMode] = state.romRamMode;
+    currentRomBank = state.currentRomBank;
+    currentRamBank = state.currentRamBank;
+
+    updatePendingInterrupts();
+}
+
+// Turns child into a copy of this memory unit. Both units share the
+// cartridge image and every page until one of them writes to a page.
+void Memory::Fork(Memory& child) {
+    child.cartridgeRef = cartridgeRef;
+    child.cartridge = cartridge;
+    child.attributes = attributes;
+    child.romBankCount = romBankCount;
+    child.ramBankCount = ramBankCount;
+    child.ramBankSize = ramBankSize;
+    child.romSize = romSize;
+    child.ramSize = ramSize;
+    child.joypadBuffer = joypadBuffer;
+
+    for (int i = 0; i < MEMORY_PAGE_COUNT; i++) {
+        child.pageRefs[i] = pageRefs[i];
+        child.pages[i] = pages[i];
+    }
+    child.dirtyPages = 0;
+    dirtyPages = 0;
+
+    child.timerCounter = timerCounter;
+    child.dmaCyclesCompleted = dmaCyclesCompleted;
+    child.dividerRegisterCounter = dividerRegisterCounter;
+    child.bootRomClosed = bootRomClosed;
+    child.dmaTransferInProgress = dmaTransferInProgress;
+    child.translatedAddr = translatedAddr;
+    child.currentRomBank = currentRomBank;
+    child.currentRamBank = currentRamBank;
+    child.pendingInterrupts = pendingInterrupts;
+}
+
+void Memory::CopyRange(uWORD addr, int length, uBYTE* dest) {
+    for (int i = 0; i < length; i++) {
+        dest[i] = peek(addr + i);
+    }
+}
+
+void Memory::SetSerialHook(std::function<void(uBYTE)> hook) {
+    serialHook = hook;
+}
+
+void Memory::SetWatchHook(std::function<void(const WatchHit&)> hook) {
+    watchHook = hook;
+}
+
+// Watches the addresses from first to last, both included.
+void Memory::SetWatch(int kind, uWORD first, uWORD last) {
+    for (int addr = first; addr <= last; addr++) {
+        watchBitmap[kind][addr / 64] |= 1ULL << (addr % 64);
+        watchedPages[kind] |= 1 << (addr >> MEMORY_PAGE_SHIFT);
+    }
+}
+
+void Memory::ClearWatches() {
+    memset(watchedPages, 0, sizeof(watchedPages));
+    memset(watchBitmap, 0, sizeof(watchBitmap));
+    resumeAddress = -1;
+}
+
+// Stops checking accesses against the watches, without clearing them,
+// until ResumeWatches is called.
+void Memory::SuspendWatches() {
+    memcpy(suspendedPages, watchedPages, sizeof(watchedPages));
+    memset(watchedPages, 0, sizeof(watchedPages));
+}
+
+void Memory::ResumeWatches() {
+    memcpy(watchedPages, suspendedPages, sizeof(watchedPages));
+}
+
+// Called by the cpu before fetching from a watched page. Returns whether
+// the instruction at addr is to be stopped at rather than executed.
+bool Memory::HitExecuteWatch(uWORD addr) {
+    if (!(watchBitmap[WATCH_EXECUTE][addr / 64] & (1ULL << (addr % 64))))
+        return false;
+
+    if (addr == resumeAddress) {
+        resumeAddress = -1;
+        return false;
+    }
+
+    resumeAddress = addr;
+    if (watchHook) {
+        watchHook({ WATCH_EXECUTE, addr, 0 });
+    }
+    return true;
+}
+
+void Memory::SetLyStubbed(bool stubbed) {
+    lyStubbed = stubbed;
+}
+
+void Memory::checkWatch(int kind, uWORD addr, uBYTE data) {
+    if ((watchBitmap[kind][addr / 64] & (1ULL << (addr % 64))) && watchHook) {
+        watchHook({ kind, addr, data });
+    }
+}
+
+// Restoring pages other than the current ones changes their contents
+// without going through Write, so their video RAM is marked as written.
+// Pages that were not written to since they were shared are left alone.
+void Memory::markVramPagesDirty(const std::shared_ptr<uBYTE>* previousPages) {
+    for (int page = VRAM_ADR >> MEMORY_PAGE_SHIFT; page < (VRAM_ADR + VRAM_SIZE) >> MEMORY_PAGE_SHIFT; page++) {
+        if (previousPages[page] == pageRefs[page])
+            continue;
+
+        int firstBlock = ((page << MEMORY_PAGE_SHIFT) - VRAM_ADR) >> VRAM_BLOCK_SHIFT;
+        for (int i = 0; i < (MEMORY_PAGE_SIZE >> VRAM_BLOCK_SHIFT); i++) {
+            vramDirty[firstBlock + i].store(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+// A page that is still referenced by a fork or a snapshot
+// is copied before the first write to it goes through.
+void Memory::claimPage(unsigned int page) {
+    if (pageRefs[page].use_count() > 1) {
+        std::shared_ptr<uBYTE> copy = allocatePage();
+        memcpy(copy.get(), pages[page], MEMORY_PAGE_SIZE);
+        pageRefs[page] = copy;
+        pages[page] = copy.get();
+    }
+
+    dirtyPages |= (1 << page);
+}
+
 void Memory::closeBootRom() {
     if (!bootRomClosed) {
         bootRomClosed = true;
@@ -309,6 +505,11 @@ void Memory::closeBootRom() {
 
 void Memory::Write(uWORD addr, uBYTE data)
 {
+    BENCHMARK_ZONE(memoryTicks);
+
+    if (IsWatchedPage(WATCH_WRITE, addr))
+        checkWatch(WATCH_WRITE, addr, data);
+
     // Writing to memory takes 4 cycles
     UpdateTimers(4);
 
@@ -337,7 +538,8 @@ void Memory::Write(uWORD addr, uBYTE data)
 
         if (mode == 0 || mode == 1 || mode == 2)
         {
-            rom[addr] = data;
+            poke(addr, data);
+            markVramDirty(addr);
         }
     }
     else if ((addr >= 0xA000) && (addr < 0xC000) && !dmaTransferInProgress) // External RAM
@@ -347,34 +549,34 @@ void Memory::Write(uWORD addr, uBYTE data)
         {
             if (attributes[romOnly])
             {
-                cart_ram[0][addr - 0xA000] = data;
+                poke(CART_RAM_OFFSET + (addr - 0xA000), data);
             }
             else if (attributes[mbc1])
             {
                 if (attributes[romRamMode])
                 {
-                    cart_ram[currentRamBank][addr - 0xA000] = data;
+                    poke(CART_RAM_OFFSET + (currentRamBank * CART_RAM_BANK_SIZE) + (addr - 0xA000), data);
                     // cartridge[translatedAddr + (0xA000 * currentRamBank)] = data;
                 }
                 else
                 {
-                    cart_ram[0][addr - 0xA000] = data;
+                    poke(CART_RAM_OFFSET + (addr - 0xA000), data);
                 }
             }
         }
     }
     else if ((addr >= 0xC000) && (addr < 0xD000) && !dmaTransferInProgress) // Work RAM 0
     {
-        rom[addr] = data;
+        poke(addr, data);
     }
     else if ((addr >= 0xD000) && (addr < 0xE000) && !dmaTransferInProgress) // Work RAM 1
     {
-        rom[addr] = data;
+        poke(addr, data);
     }
     else if ((addr >= 0xE000) && (addr < 0xFE00) && !dmaTransferInProgress) //Echo of Work RAM, typically not used
     {
-        rom[addr] = data;
-        rom[addr - 0x2000] = data;
+        poke(addr, data);
+        poke(addr - 0x2000, data);
     }
     else if ((addr >= 0xFE00) && (addr < 0xFEA0) && !dmaTransferInProgress) //OAM RAM
     {
@@ -382,7 +584,7 @@ void Memory::Write(uWORD addr, uBYTE data)
 
         if (mode == 0 || mode == 1)
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
     }
     else if ((addr >= 0xFEA0) && (addr < 0xFF00) && !dmaTransferInProgress) // Not Usable
@@ -391,34 +593,57 @@ void Memory::Write(uWORD addr, uBYTE data)
     }
     else if ((addr >= 0xFF00) && (addr < 0xFF80) && !dmaTransferInProgress) // I/O Registers
     {
+        registerWritten = true;
+
         if (addr == 0xFF00) // Joypad register
         {
             handleJoypadTranslation(data);
         }
-        else if (addr == 0xFF01) // Serial Transfer Data
+        else if (addr == SB_ADR) // Serial Transfer Data
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
-        else if (addr == 0xFF02) // Serial Transfer Control Register
+        else if (addr == SC_ADR) // Serial Transfer Control Register
         {
-            rom[addr] = data;
+            poke(addr, data);
+
+            // A transfer started on the internal clock sends out the data register.
+            // No link partner is ever connected, so it completes right away,
+            // having shifted in 0xFF.
+            if ((data & 0x81) == 0x81)
+            {
+                uBYTE sent = peek(SB_ADR);
+                if (serialHook)
+                {
+                    serialHook(sent);
+                }
+#ifdef FUUGB_DEBUG
+                else
+                {
+                    printf("%c", sent);
+                }
+#endif
+                poke(SB_ADR, 0xFF);
+                poke(SC_ADR, data & 0x7F);
+                RequestInterupt(SER_TRF_INT);
+            }
         }
         else if (addr == 0xFF04) // Divider Register
         {
-            rom[addr] = 0x00;
+            poke(addr, 0x00);
         }
         else if (addr == 0xFF05) // Timer Counter Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF06) // Timer Modulo Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF07) // Timer Controller Register
         {
-            rom[addr] = data;
-            switch (rom[addr] & 0x03)
+            poke(addr, data);
+            switch (peek(addr) & 0x03)
             {
             case 0:
                 this->timerCounter = 1024;
@@ -436,154 +661,57 @@ void Memory::Write(uWORD addr, uBYTE data)
         }
         else if (addr == 0xFF0F) // Interrupt Flag Register
         {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF10) // Channel 1 Sweep Register
-        {
-            rom[addr] = data;
-            reloadCh1LengthTimer = true;
-        }
-        else if (addr == 0xFF11) // Channel 1 Sound length/wave pattern duty Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF12) // Channel 1 Volume Envelope Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF13) // Channel 1 Frequency lo Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF14) // Channel 1 Freqency hi Register
-        {
-            rom[addr] = data;
-
-            // Writing a byte with bit 7 set causes a
-            // trigger event for channel 1 in the APU
-            if (data & (1 << 7)) {
-                triggerEventCh1 = true;
-            }
-        }
-        else if (addr == 0xFF16) // Channel 2 Sound length/wave pattern duty Register
-        {
-            rom[addr] = data;
-            reloadCh2LengthTimer = true;
-        }
-        else if (addr == 0xFF17) // Channel 2 Volume Envelope Register
-        {
-            rom[addr] = data;
+            poke(addr, data);
+            updatePendingInterrupts();
         }
-        else if (addr == 0xFF18) // Channel 2 Frequency lo Register
+        else if ((addr >= 0xFF10) && (addr < 0xFF27)) // Sound Registers
         {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF19) // Channel 2 Freqency hi Register
-        {
-            rom[addr] = data;
+            if (addr == 0xFF26) // Sound On/Off
+                data = (peek(addr) & 0x7F) | (data & (1 << 7)); // Only bit 7 is writeable
 
-            // Writing a byte with bit 7 set causes a
-            // trigger event for channel 2 in the APU
-            if (data & (1 << 7)) {
-                triggerEventCh2 = true;
-            }
-        }
-        else if (addr == 0xFF1A) // Channel 3 Sound On/Off Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF1B) // Channel 3 Sound Length Register
-        {
-            rom[addr] = data;
-            reloadCh3LengthTimer = true;
-        }
-        else if (addr == 0xFF1C) // Channel 3 Select Output Level Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF1D) // Channel 3 Frequency lo Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF1E) // Channel 3 Frequency hi Register
-        {
-            rom[addr] = data;
+            poke(addr, data);
 
-            // Writing a byte with bit 7 set causes a
-            // trigger event for channel 1 in the APU
-            if (data & (1 << 7)) {
-                triggerEventCh3 = true;
-            }
-        }
-        else if (addr == 0xFF20) // Channel 4 Sound length/wave pattern duty Register
-        {
-            rom[addr] = data;
-            reloadCh4LengthTimer = true;
-        }
-        else if (addr == 0xFF21) // Channel 4 Volume Envelope Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF22) // Channel 4 Polynomial Counter Register
-        {
-            rom[addr] = data;
+            if (apuRef != NULL)
+                apuRef->WriteRegister(addr, data);
         }
-        else if (addr == 0xFF23) // Channel 4 Counter/Consecutive Register
+        else if ((addr >= 0xFF30) && (addr < 0xFF40)) // Wave Pattern RAM
         {
-            rom[addr] = data;
+            if (!(peek(0xFF1A) & (1 << 7))) { // Only accessible if CH3 bit 7 is reset
+                poke(addr, data);
 
-            // Writing a byte with bit 7 set causes a
-            // trigger event for channel 1 in the APU
-            if (data & (1 << 7)) {
-                triggerEventCh4 = true;
+                if (apuRef != NULL)
+                    apuRef->WriteRegister(addr, data);
             }
         }
-        else if (addr == 0xFF24) // Channel Control Register
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF25) // Selection of Sound Output Terminal
-        {
-            rom[addr] = data;
-        }
-        else if (addr == 0xFF26) // Sound On/Off
-        {
-            rom[addr] |= (data & (1 << 7)); // Only bit 7 is writeable
-        }
-        else if ((addr >= 0xFF30) && (addr < 0xFF40)) // Wave Pattern RAM
-        {
-            if (!(rom[0xFF1A] & (1 << 7))) // Only accessible if CH3 bit 7 is reset
-                rom[addr] = data;
-        }
         else if (addr == 0xFF40) // LCDC Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF41) // STAT Register
         {
             // This weird hackery is to ensure that read only bits
             // are not being overwritten. (bits 0-2 are read only)
-            uBYTE temp = rom[addr] & 0x07;
+            uBYTE temp = peek(addr) & 0x07;
             data |= 0x80;
             data = data & 0xF8;
             data |= temp;
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF42) // Scroll Y Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF43) // Scroll X Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF44) // LY Register
         {
-            rom[addr] = 0;
+            poke(addr, 0);
         }
         else if (addr == 0xFF45) // LY Compare Register
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF46) // Request for dma transfer
         {
@@ -591,19 +719,19 @@ void Memory::Write(uWORD addr, uBYTE data)
         }
         else if (addr == 0xFF47) // BG Palette Data
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF48) // Object Palette 0 Data
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF49) // Object Palette 1 Data
         {
-            rom[addr] = data;
+            poke(addr, data);
         }
         else if (addr == 0xFF50)
         {
-            rom[addr] = data;
+            poke(addr, data);
             closeBootRom();
         }
         else if (addr == 0xFF51) // New DMA source, high
@@ -633,16 +761,23 @@ void Memory::Write(uWORD addr, uBYTE data)
     }
     else if ((addr >= 0xFF80) && (addr < 0xFFFE)) // HRAM
     {
-        rom[addr] = data;
+        poke(addr, data);
     }
     else if ((addr == 0xFFFF) && !dmaTransferInProgress) // Interrupt Enable Register
     {
-        rom[addr] = data;
+        registerWritten = true;
+        poke(addr, data);
+        updatePendingInterrupts();
     }
 }
 
 uBYTE Memory::Read(uWORD addr, bool debugRead)
 {
+    BENCHMARK_ZONE(memoryTicks);
+
+    if (IsWatchedPage(WATCH_READ, addr) && !debugRead)
+        checkWatch(WATCH_READ, addr, 0);
+
     // Reading from memory takes 4 cycles
     if (!debugRead)
         UpdateTimers(4);
@@ -695,7 +830,7 @@ uBYTE Memory::Read(uWORD addr, bool debugRead)
         if (mode == 3)
             return 0xFF;
 
-        return rom[addr];
+        return peek(addr);
     }
     else if ((addr >= 0xA000) && (addr < 0xC000) && !dmaTransferInProgress) // External RAM
     {
@@ -704,17 +839,17 @@ uBYTE Memory::Read(uWORD addr, bool debugRead)
         {
             if (attributes[romOnly])
             {
-                return cart_ram[0][addr - 0xA000];
+                return peek(CART_RAM_OFFSET + (addr - 0xA000));
             }
 
             if (attributes[mbc1])
             {
                 if (attributes[romRamMode])
                 {
-                    return cart_ram[currentRamBank][addr - 0xA000];
+                    return peek(CART_RAM_OFFSET + (currentRamBank * CART_RAM_BANK_SIZE) + (addr - 0xA000));
                 }
 
-                return cart_ram[0][addr - 0xA000];
+                return peek(CART_RAM_OFFSET + (addr - 0xA000));
             }
         }
 
@@ -722,22 +857,22 @@ uBYTE Memory::Read(uWORD addr, bool debugRead)
     }
     else if ((addr >= 0xC000) && (addr < 0xD000) && !dmaTransferInProgress) // Work RAM 0
     {
-        return rom[addr];
+        return peek(addr);
     }
     else if ((addr >= 0xD000) && (addr < 0xE000) && !dmaTransferInProgress) // Work RAM 1
     {
-        return rom[addr];
+        return peek(addr);
     }
     else if ((addr >= 0xE000) && (addr < 0xFE00) && !dmaTransferInProgress) // Echo of Work RAM
     {
-        return rom[addr];
+        return peek(addr);
     }
     else if ((addr >= 0xFE00) && (addr < 0xFEA0) && !dmaTransferInProgress) //OAM RAM
     {
         uBYTE mode = getStatMode();
 
         if (mode == 0 || mode == 1)
-            return rom[addr];
+            return peek(addr);
         else
             return 0xFF;
     }
@@ -747,19 +882,22 @@ uBYTE Memory::Read(uWORD addr, bool debugRead)
     }
     else if ((addr >= 0xFF00) && (addr < 0xFF80) && !dmaTransferInProgress) // I/O Registers
     {
-        return rom[addr];
+        if (addr == LY_ADR && lyStubbed)
+            return LY_STUB_VALUE;
+
+        return peek(addr);
     }
     else if ((addr >= 0xFF80) && (addr < 0xFFFE)) // HRAM
     {
-        return rom[addr];
+        return peek(addr);
     }
     // Interrupt Enable Register 0xFFFF
-    return rom[addr];
+    return peek(addr);
 }
 
 uBYTE Memory::DmaRead(uWORD addr)
 {
-    return rom[addr];
+    return peek(addr);
 }
 
 void Memory::DmaWrite(uWORD addr, uBYTE data)
@@ -768,18 +906,33 @@ void Memory::DmaWrite(uWORD addr, uBYTE data)
     {
         data |= 0x80;
     }
-    rom[addr] = data;
+    poke(addr, data);
+
+    if ((addr >= VRAM_ADR) && (addr < VRAM_ADR + VRAM_SIZE))
+    {
+        markVramDirty(addr);
+    }
+
+    if ((addr >= 0xFF10) && (addr < 0xFF40) && (apuRef != NULL))
+    {
+        apuRef->WriteRegister(addr, data);
+    }
+
+    if ((addr == IF_ADR) || (addr == IE_ADR))
+    {
+        updatePendingInterrupts();
+    }
 }
 
 void Memory::UpdateTimers(int cycles)
 {
-    uBYTE TAC = rom[TAC_ADR];
+    uBYTE TAC = peek(TAC_ADR);
 
     // Update the divider register
     dividerRegisterCounter += cycles;
     if (dividerRegisterCounter >= 256)
     {
-        rom[DIV_ADR]++;
+        poke(DIV_ADR, peek(DIV_ADR) + 1);
         dividerRegisterCounter -= 256;
     }
 
@@ -811,14 +964,14 @@ void Memory::UpdateTimers(int cycles)
             timerCounter += remainder;
 
             // Timer Overflow
-            if (rom[TIMA_ADR] == 0xFF)
+            if (peek(TIMA_ADR) == 0xFF)
             {
-                rom[TIMA_ADR] = rom[TIM_MOD_ADR];
+                poke(TIMA_ADR, peek(TIM_MOD_ADR));
                 RequestInterupt(TIMER_OVERFLOW_INT);
             }
             else
             {
-                rom[TIMA_ADR]++;
+                poke(TIMA_ADR, peek(TIMA_ADR) + 1);
             }
         }
     }
@@ -929,31 +1082,33 @@ void Memory::changeRamBank(uBYTE data)
 
 void Memory::RequestInterupt(int code)
 {
-    uBYTE IF = rom[IF_ADR];
+    uBYTE IF = peek(IF_ADR);
 
     switch (code)
     {
     case VBLANK_INT:
         IF |= 0x01;
-        rom[IF_ADR] = IF;
+        poke(IF_ADR, IF);
         break;
     case LCDC_INT:
         IF |= 0x02;
-        rom[IF_ADR] = IF;
+        poke(IF_ADR, IF);
         break;
     case TIMER_OVERFLOW_INT:
         IF |= 0x04;
-        rom[IF_ADR] = IF;
+        poke(IF_ADR, IF);
         break;
     case SER_TRF_INT:
         IF |= 0x08;
-        rom[IF_ADR] = IF;
+        poke(IF_ADR, IF);
         break;
     case CONTROL_INT:
         IF |= 0x10;
-        rom[IF_ADR] = IF;
+        poke(IF_ADR, IF);
         break;
     }
+
+    updatePendingInterrupts();
 }
 
 void Memory::UpdateDmaCycles(int cyclesToAdd)
@@ -985,13 +1140,13 @@ void Memory::dmaTransfer(uBYTE data)
     // Begin Transfer
     for (uBYTE i = 0; i < 0xA0; i++)
     {
-        rom[0xFE00 + i] = rom[(data << 8) | i];
+        poke(0xFE00 + i, peek((data << 8) | i));
     }
 }
 
 uBYTE Memory::getStatMode()
 {
-    return rom[0xFF41] & 0x03;
+    return peek(0xFF41) & 0x03;
 }
 
 void Memory::handleJoypadTranslation(uBYTE data) {
@@ -1019,82 +1174,10 @@ void Memory::handleJoypadTranslation(uBYTE data) {
 
     if (actionRead) {
         result = data | (joypadBuffer & 0x0F);
-        rom[JOYPAD_INPUT_REG] = result;
+        poke(JOYPAD_INPUT_REG, result);
     }
     else if (directionRead) {
         result = data | ((joypadBuffer & 0xF0) >> 4);
-        rom[JOYPAD_INPUT_REG] = result;
-    }
-}
-
-bool Memory::RequiresCh1LengthReload() {
-    if (reloadCh1LengthTimer) {
-        reloadCh1LengthTimer = false;
-        return true;
-    }
-
-    return reloadCh1LengthTimer;
-}
-
-bool Memory::RequiresCh2LengthReload() {
-    if (reloadCh2LengthTimer) {
-        reloadCh2LengthTimer = false;
-        return true;
-    }
-
-    return reloadCh2LengthTimer;
-}
-
-bool Memory::RequiresCh3LengthReload() {
-    if (reloadCh3LengthTimer) {
-        reloadCh3LengthTimer = false;
-        return true;
-    }
-
-    return reloadCh3LengthTimer;
-}
-
-bool Memory::RequiresCh4LengthReload() {
-    if (reloadCh4LengthTimer) {
-        reloadCh4LengthTimer = false;
-        return true;
-    }
-
-    return reloadCh4LengthTimer;
-}
-
-bool Memory::TriggerEventCh1() {
-    if (triggerEventCh1) {
-        triggerEventCh1 = false;
-        return true;
-    }
-
-    return false;
-}
-
-bool Memory::TriggerEventCh2() {
-    if (triggerEventCh2) {
-        triggerEventCh2 = false;
-        return true;
-    }
-
-    return false;
-}
-
-bool Memory::TriggerEventCh3() {
-    if (triggerEventCh3) {
-        triggerEventCh3 = false;
-        return true;
+        poke(JOYPAD_INPUT_REG, result);
     }
-
-    return false;
-}
-
-bool Memory::TriggerEventCh4() {
-    if (triggerEventCh4) {
-        triggerEventCh4 = false;
-        return true;
-    }
-
-    return false;
 }
@@ -1,10 +1,54 @@
 #include "Ppu.hpp"
 
+#include <climits>
+
 Ppu::Ppu() {
-    pixels = new pixel * [NATIVE_SIZE_X];
-    for (int i = 0; i < NATIVE_SIZE_X; i++)
-        pixels[i] = new pixel[NATIVE_SIZE_Y];
+    pixels = new pixel[NATIVE_SIZE_X * NATIVE_SIZE_Y];
+
+    // GL resources are only created once a rendering context is
+    // attached, see InitializeGLBuffers.
+    positionVertices = nullptr;
+    positionVBO = nullptr;
+    colorVBO = nullptr;
+    vao = nullptr;
+
+    renderingEnabled = true;
+}
+
+Ppu::~Ppu() {
+    delete[] pixels;
+    delete[] positionVertices;
+
+    delete vao;
+    delete colorVBO;
+    delete positionVBO;
+}
+
+void Ppu::SetMemory(Memory* memory) {
+    memoryRef = memory;
+}
+
+void Ppu::SetRenderingEnabled(bool enabled) {
+    renderingEnabled = enabled;
+}
+
+// The pixel buffer, as NATIVE_SIZE_Y rows of NATIVE_SIZE_X pixels, each of
+// which is 4 bytes: red, green, blue and the color code it was drawn from.
+const uBYTE* Ppu::GetFrameBuffer() {
+    return (const uBYTE*)pixels;
+}
 
+void Ppu::SaveState(State& state) {
+    state.currentScanline = currentScanline;
+    state.scanlineCounter = scanlineCounter;
+}
+
+void Ppu::LoadState(const State& state) {
+    currentScanline = state.currentScanline;
+    scanlineCounter = state.scanlineCounter;
+}
+
+void Ppu::InitializeGLBuffers() {
     positionVertices = new GLfloat[NATIVE_SIZE_X * NATIVE_SIZE_Y * 12];
 
     // Coordinates for translation from regular video coordinates
@@ -42,25 +86,6 @@ Ppu::Ppu() {
     colorVBO = new Vbo();
     vao = new Vao();
 
-}
-
-Ppu::~Ppu() {
-    for (int i = 0; i < NATIVE_SIZE_X; i++)
-        delete[] pixels[i];
-
-    delete[] pixels;
-    delete[] positionVertices;
-
-    delete vao;
-    delete colorVBO;
-    delete positionVBO;
-}
-
-void Ppu::SetMemory(Memory* memory) {
-    memoryRef = memory;
-}
-
-void Ppu::InitializeGLBuffers() {
     // Generate the position vertex buffer (remains static)
     positionVBO->Generate(positionVertices, sizeof(GLfloat) * NATIVE_SIZE_X * NATIVE_SIZE_Y * 12);
 
@@ -70,6 +95,7 @@ void Ppu::InitializeGLBuffers() {
 }
 
 void Ppu::Render() {
+    TRACE_ZONE("Ppu::Render");
     DrawPixels();
     glFlush();
 }
@@ -91,24 +117,24 @@ void Ppu::DrawPixels() {
     auto x = 0;
     auto y = 0;
     for (auto i = 0; i < (NATIVE_SIZE_X * NATIVE_SIZE_Y * 18); i += 18) {
-        colorVertices[i] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 1] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 2] = pixels[x][y].b / 255.0f;
-        colorVertices[i + 3] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 4] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 5] = pixels[x][y].b / 255.0f;
-        colorVertices[i + 6] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 7] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 8] = pixels[x][y].b / 255.0f;
-        colorVertices[i + 9] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 10] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 11] = pixels[x][y].b / 255.0f;
-        colorVertices[i + 12] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 13] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 14] = pixels[x][y].b / 255.0f;
-        colorVertices[i + 15] = pixels[x][y].r / 255.0f;
-        colorVertices[i + 16] = pixels[x][y].g / 255.0f;
-        colorVertices[i + 17] = pixels[x][y].b / 255.0f;
+        colorVertices[i] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 1] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 2] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
+        colorVertices[i + 3] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 4] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 5] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
+        colorVertices[i + 6] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 7] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 8] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
+        colorVertices[i + 9] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 10] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 11] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
+        colorVertices[i + 12] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 13] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 14] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
+        colorVertices[i + 15] = pixels[(y * NATIVE_SIZE_X) + x].r / 255.0f;
+        colorVertices[i + 16] = pixels[(y * NATIVE_SIZE_X) + x].g / 255.0f;
+        colorVertices[i + 17] = pixels[(y * NATIVE_SIZE_X) + x].b / 255.0f;
 
         x++;
         if (x == (NATIVE_SIZE_X)) {
@@ -127,6 +153,7 @@ void Ppu::DrawPixels() {
 
 void Ppu::DrawScanline()
 {
+    TRACE_ZONE("Ppu::DrawScanline");
     LCDC = GetLCDC();
 
     if (LCDC & (1 << 0)) {
@@ -139,6 +166,7 @@ void Ppu::DrawScanline()
 }
 
 void Ppu::UpdateGraphics(int cycles) {
+    BENCHMARK_ZONE(ppuTicks);
 
     LCDC = GetLCDC();
     SetLCDStatus();
@@ -156,7 +184,8 @@ void Ppu::UpdateGraphics(int cycles) {
 
         // If we are not yet at scanline 144, draw the next scanline
         if (currentScanline < 144) {
-            DrawScanline();
+            if (renderingEnabled)
+                DrawScanline();
         }
 
         // If we are in vblank, request an interupt
@@ -175,6 +204,51 @@ void Ppu::UpdateGraphics(int cycles) {
     }
 }
 
+// How many cycles the ppu can be updated by, in steps of any size, with none
+// but the last of them changing anything the cpu could see: the status each
+// step sets must already be the current one, and neither the mode nor the
+// scanline may change before the last step. 0 if the next update changes
+// something already.
+int Ppu::CyclesUntilEvent() {
+    uBYTE stat = memoryRef->DmaRead(STAT_ADR);
+    uBYTE ly = memoryRef->DmaRead(LY_ADR);
+
+    if (!(GetLCDC() & (1 << 7))) {
+        bool settled = (ly == 0) && ((stat & 0x03) == 0) && (scanlineCounter == 456);
+        return settled ? INT_MAX : 0;
+    }
+
+    // Every update requests the interrupt again while LY matches LYC.
+    bool coincidence = (ly == memoryRef->DmaRead(LYC_ADR));
+    if (coincidence != ((stat & (1 << 2)) != 0) || (coincidence && (stat & (1 << 6)))) {
+        return 0;
+    }
+
+    int mode2BOUND = 456 - 80;
+    int mode3BOUND = mode2BOUND - 172;
+    uBYTE mode;
+    int cycles;
+
+    if (ly >= 144) {
+        mode = 0x01;
+        cycles = scanlineCounter - 1;
+    }
+    else if (scanlineCounter >= mode2BOUND) {
+        mode = 0x02;
+        cycles = scanlineCounter - mode2BOUND;
+    }
+    else if (scanlineCounter >= mode3BOUND) {
+        mode = 0x03;
+        cycles = scanlineCounter - mode3BOUND;
+    }
+    else {
+        mode = 0x00;
+        cycles = scanlineCounter - 1;
+    }
+
+    return ((stat & 0x03) == mode) ? cycles : 0;
+}
+
 void Ppu::RenderTiles() {
     // Determine the current scanline we are on
     currentScanline = memoryRef->DmaRead(LY_ADR);
@@ -277,7 +351,7 @@ void Ppu::RenderTiles() {
             ColorCode |= 0x01;
         }
 
-        pixels[pixel][currentScanline] = DeterminePixelRGB(ColorCode, 0xFF47);
+        pixels[(currentScanline * NATIVE_SIZE_X) + pixel] = DeterminePixelRGB(ColorCode, 0xFF47);
     }
 }
 
@@ -362,11 +436,11 @@ void Ppu::RenderSprites()
                     continue;
 
                 // Determine if sprite pixel has priority over background or window
-                if (!priority && pixels[pixel][currentScanline].colorCode != 0x00) {
+                if (!priority && pixels[(currentScanline * NATIVE_SIZE_X) + pixel].colorCode != 0x00) {
                     continue;
                 }
 
-                pixels[pixel][currentScanline] = tempPixel;
+                pixels[(currentScanline * NATIVE_SIZE_X) + pixel] = tempPixel;
             }
         }
     }
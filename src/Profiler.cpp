@@ -0,0 +1,160 @@
+#include "Profiler.hpp"
+#include "Cpu.hpp"
+
+#include <algorithm>
+#include <inttypes.h>
+
+Profiler::Profiler() : locations(PROFILER_LOCATION_COUNT) {
+    resetRequested = false;
+    Reset();
+}
+
+Profiler::~Profiler() {}
+
+void Profiler::Reset() {
+    memset(opcodes, 0, sizeof(opcodes));
+    memset(fusions, 0, sizeof(fusions));
+    std::fill(locations.begin(), locations.end(), Counter{ 0, 0 });
+}
+
+// Has the counters reset by the thread recording into them, at its next
+// call to ResetIfRequested. Safe to call from any thread.
+void Profiler::RequestReset() {
+    resetRequested = true;
+}
+
+// Called by the thread recording into the counters, between frames.
+void Profiler::ResetIfRequested() {
+    if (resetRequested.exchange(false)) {
+        Reset();
+    }
+}
+
+Profiler::Counter Profiler::GetTotal() {
+    Counter total = { 0, 0 };
+
+    for (int i = 0; i < PROFILER_OPCODE_COUNT; i++) {
+        total.executions += opcodes[i].executions;
+        total.cycles += opcodes[i].cycles;
+    }
+
+    return total;
+}
+
+Profiler::Counter Profiler::GetOpcode(int opcode) {
+    return opcodes[opcode];
+}
+
+uint64_t Profiler::GetFusion(int fusion) {
+    return fusions[fusion];
+}
+
+// Fills hotSpots with the count locations the most cycles were spent
+// executing from, hottest first. A count of 0 returns every location executed.
+void Profiler::GetHotSpots(std::vector<HotSpot>& hotSpots, size_t count) {
+    hotSpots.clear();
+
+    for (unsigned int i = 0; i < PROFILER_LOCATION_COUNT; i++) {
+        if (locations[i].executions != 0) {
+            hotSpots.push_back(toHotSpot(i, locations[i]));
+        }
+    }
+
+    if (count == 0 || count > hotSpots.size()) {
+        count = hotSpots.size();
+    }
+
+    std::partial_sort(hotSpots.begin(), hotSpots.begin() + count, hotSpots.end(),
+        [](const HotSpot& a, const HotSpot& b) { return a.counter.cycles > b.counter.cycles; });
+    hotSpots.resize(count);
+}
+
+// Writes the profile as JSON: the totals, every opcode executed and every
+// location executed from, each sorted by the cycles spent on them, and how
+// many times each fusion could have been executed.
+bool Profiler::Dump(const std::string& path) {
+    FILE* output = fopen(path.c_str(), "w");
+    if (output == NULL) {
+        return false;
+    }
+
+    Counter total = GetTotal();
+
+    std::vector<int> executedOpcodes;
+    for (int i = 0; i < PROFILER_OPCODE_COUNT; i++) {
+        if (opcodes[i].executions != 0) {
+            executedOpcodes.push_back(i);
+        }
+    }
+
+    std::sort(executedOpcodes.begin(), executedOpcodes.end(),
+        [this](int a, int b) { return opcodes[a].cycles > opcodes[b].cycles; });
+
+    std::vector<HotSpot> hotSpots;
+    GetHotSpots(hotSpots, 0);
+
+    fprintf(output, "{\n");
+    fprintf(output, "  \"instructions\": %" PRIu64 ",\n", total.executions);
+    fprintf(output, "  \"cycles\": %" PRIu64 ",\n", total.cycles);
+    fprintf(output, "  \"opcodes\": [");
+
+    for (size_t i = 0; i < executedOpcodes.size(); i++) {
+        const Counter& counter = opcodes[executedOpcodes[i]];
+        fprintf(output, "%s\n    { \"opcode\": \"%s\", \"executions\": %" PRIu64 ", \"cycles\": %" PRIu64 " }",
+            i == 0 ? "" : ",", OpcodeName(executedOpcodes[i]).c_str(), counter.executions, counter.cycles);
+    }
+
+    fprintf(output, "\n  ],\n");
+    fprintf(output, "  \"hotspots\": [");
+
+    for (size_t i = 0; i < hotSpots.size(); i++) {
+        const HotSpot& hotSpot = hotSpots[i];
+        fprintf(output, "%s\n    { \"bank\": %d, \"pc\": \"%04X\", \"executions\": %" PRIu64 ", \"cycles\": %" PRIu64 " }",
+            i == 0 ? "" : ",", hotSpot.bank, hotSpot.pc, hotSpot.counter.executions, hotSpot.counter.cycles);
+    }
+
+    fprintf(output, "\n  ],\n");
+    fprintf(output, "  \"fusions\": [");
+
+    for (int i = 0; i < FUSION_COUNT; i++) {
+        fprintf(output, "%s\n    { \"fusion\": \"%s\", \"executions\": %" PRIu64 " }",
+            i == 0 ? "" : ",", Cpu::FusionName(i), fusions[i]);
+    }
+
+    fprintf(output, "\n  ]\n}\n");
+
+    bool written = !ferror(output);
+    return (fclose(output) == 0) && written;
+}
+
+// Opcodes are named by their encoding, "3E" or "CB 7C".
+std::string Profiler::OpcodeName(int opcode) {
+    char name[8];
+
+    if (opcode >= PROFILER_CB_OPCODES)
+        snprintf(name, sizeof(name), "CB %02X", (unsigned)(opcode - PROFILER_CB_OPCODES) & 0xFF);
+    else
+        snprintf(name, sizeof(name), "%02X", (unsigned)opcode & 0xFF);
+
+    return std::string(name);
+}
+
+Profiler::HotSpot Profiler::toHotSpot(unsigned int location, const Counter& counter) {
+    HotSpot hotSpot;
+    hotSpot.counter = counter;
+
+    if (location >= PROFILER_RAM_LOCATIONS) {
+        hotSpot.bank = -1;
+        hotSpot.pc = 0x8000 + (location - PROFILER_RAM_LOCATIONS);
+    }
+    else if (location < PROFILER_ROM_BANK_SIZE) {
+        hotSpot.bank = 0;
+        hotSpot.pc = location;
+    }
+    else {
+        hotSpot.bank = location / PROFILER_ROM_BANK_SIZE;
+        hotSpot.pc = PROFILER_ROM_BANK_SIZE + (location % PROFILER_ROM_BANK_SIZE);
+    }
+
+    return hotSpot;
+}
@@ -0,0 +1,79 @@
+#include "RingBuffer.hpp"
+
+#include <algorithm>
+
+RingBuffer::RingBuffer(size_t capacity) {
+    this->capacity = capacity;
+    mask = capacity - 1;
+    buffer = new uBYTE[capacity];
+    memset(buffer, 0x00, capacity);
+
+    head.store(0);
+    tail.store(0);
+}
+
+RingBuffer::~RingBuffer() {
+    delete[] buffer;
+}
+
+// Copies as much of data as there is room for and returns the amount copied.
+// Must only be called from the producer thread.
+size_t RingBuffer::Write(const uBYTE* data, size_t length) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    size_t currentTail = tail.load(std::memory_order_acquire);
+
+    size_t available = capacity - (currentHead - currentTail);
+    if (length > available)
+        length = available;
+
+    // The write might wrap around the end of the buffer.
+    size_t offset = currentHead & mask;
+    size_t firstPart = capacity - offset;
+    if (firstPart > length)
+        firstPart = length;
+
+    memcpy(buffer + offset, data, firstPart);
+    memcpy(buffer, data + firstPart, length - firstPart);
+
+    head.store(currentHead + length, std::memory_order_release);
+    return length;
+}
+
+// Copies up to length bytes into data and returns the amount copied.
+// Must only be called from the consumer thread.
+size_t RingBuffer::Read(uBYTE* data, size_t length) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    size_t currentHead = head.load(std::memory_order_acquire);
+
+    size_t available = currentHead - currentTail;
+    if (length > available)
+        length = available;
+
+    size_t offset = currentTail & mask;
+    size_t firstPart = capacity - offset;
+    if (firstPart > length)
+        firstPart = length;
+
+    memcpy(data, buffer + offset, firstPart);
+    memcpy(data + firstPart, buffer, length - firstPart);
+
+    tail.store(currentTail + length, std::memory_order_release);
+    return length;
+}
+
+// Amount of bytes waiting to be read. On the producer and consumer threads
+// the other side can only make it shrink or grow respectively, so it is a
+// safe bound on how much can be written or read. Any other thread, like the
+// gui reading the fill level, only gets an estimate: both sides may move
+// between the two loads, which is why the tail is loaded first, so that it
+// can never be ahead of the head, and the result is clamped to the capacity.
+size_t RingBuffer::Size() {
+    size_t currentTail = tail.load(std::memory_order_acquire);
+    size_t currentHead = head.load(std::memory_order_acquire);
+
+    return std::min(currentHead - currentTail, capacity);
+}
+
+size_t RingBuffer::Capacity() {
+    return capacity;
+}
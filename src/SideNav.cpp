@@ -1,9 +1,16 @@
 #include "SideNav.hpp"
 
+#include <algorithm>
+#include <cfloat>
+#include <inttypes.h>
+
 const ImVec4 tabSelectedColor = ImVec4(0.0f, 0.0f, 200.0f, 255.0f);
+const ImVec4 watchHitColor = ImVec4(1.0f, 0.3f, 0.3f, 1.0f);
 
 SideNav::SideNav(Gameboy* gbRef) {
     this->gbRef = gbRef;
+    snapshot = NULL;
+    debugRegions.Clear();
 }
 
 SideNav::~SideNav() {}
@@ -25,15 +32,26 @@ bool SideNav::Init(GLFWwindow* windowRef) {
 }
 
 void SideNav::Render() {
+    TRACE_ZONE("SideNav::Render");
+    double startTime = glfwGetTime();
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    snapshot = &gbRef->AcquireDebugSnapshot();
+    debugRegions.Clear();
+
     renderEmulatorControlsWindow();
     renderDebuggerWindow();
 
+    gbRef->SetDebugRegions(debugRegions);
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+    imguiTimes[imguiTimeIndex] = glfwGetTime() - startTime;
+    imguiTimeIndex = (imguiTimeIndex + 1) % FRAME_STATS_HISTORY;
 }
 
 void SideNav::renderEmulatorControlsWindow() {
@@ -55,16 +73,43 @@ void SideNav::renderEmulatorControlsWindow() {
         pauseLabelIdx = (pauseLabelIdx + 1) % 2;
     }
 
-    ImGui::Text("PC: %04X", gbRef->cpu.PC);
-    ImGui::Text("SP: %04X", gbRef->cpu.SP);
-    ImGui::Text("A: %02X", gbRef->cpu.AF.hi); ImGui::SameLine(); ImGui::Text("F: %02X", gbRef->cpu.AF.lo);
-    ImGui::Text("B: %02X", gbRef->cpu.BC.hi); ImGui::SameLine(); ImGui::Text("C: %02X", gbRef->cpu.BC.lo);
-    ImGui::Text("D: %02X", gbRef->cpu.DE.hi); ImGui::SameLine(); ImGui::Text("E: %02X", gbRef->cpu.DE.lo);
-    ImGui::Text("H: %02X", gbRef->cpu.HL.hi); ImGui::SameLine(); ImGui::Text("L: %02X", gbRef->cpu.HL.lo);
+    renderWatchHit();
+
+    const Cpu::State& cpu = snapshot->cpu;
+    if (snapshot->watchHitCount != 0 && snapshot->watchHit.kind == WATCH_EXECUTE && snapshot->watchHit.addr == cpu.PC)
+        ImGui::TextColored(watchHitColor, "PC: %04X", cpu.PC);
+    else
+        ImGui::Text("PC: %04X", cpu.PC);
+    ImGui::Text("SP: %04X", cpu.SP);
+    ImGui::Text("A: %02X", cpu.AF >> 8); ImGui::SameLine(); ImGui::Text("F: %02X", cpu.AF & 0xFF);
+    ImGui::Text("B: %02X", cpu.BC >> 8); ImGui::SameLine(); ImGui::Text("C: %02X", cpu.BC & 0xFF);
+    ImGui::Text("D: %02X", cpu.DE >> 8); ImGui::SameLine(); ImGui::Text("E: %02X", cpu.DE & 0xFF);
+    ImGui::Text("H: %02X", cpu.HL >> 8); ImGui::SameLine(); ImGui::Text("L: %02X", cpu.HL & 0xFF);
 
     ImGui::End();
 }
 
+// The emulation pauses itself on hitting a watchpoint, so the pause
+// button is switched to resuming when a new hit shows up.
+void SideNav::renderWatchHit() {
+    if (snapshot->watchHitCount == 0)
+        return;
+
+    if (snapshot->watchHitCount != watchHitCount) {
+        watchHitCount = snapshot->watchHitCount;
+        watchHitPending = true;
+        pauseLabelIdx = 1;
+    }
+
+    const Memory::WatchHit& hit = snapshot->watchHit;
+    if (hit.kind == WATCH_EXECUTE)
+        ImGui::TextColored(watchHitColor, "Breakpoint hit at %04X", hit.addr);
+    else if (hit.kind == WATCH_WRITE)
+        ImGui::TextColored(watchHitColor, "Watchpoint hit writing %02X to %04X", hit.data, hit.addr);
+    else
+        ImGui::TextColored(watchHitColor, "Watchpoint hit reading from %04X", hit.addr);
+}
+
 void SideNav::renderDebuggerWindow() {
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0.0f, 0.0f));
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2(0.0f, 0.0f));
@@ -90,6 +135,12 @@ void SideNav::renderDebuggerWindow() {
     case AUDIO:
         renderAudioPane();
         break;
+    case PROFILER:
+        renderProfilerPane();
+        break;
+    case PERFORMANCE:
+        renderPerformancePane();
+        break;
     case MEMORY:
     default:
         renderMemoryPane();
@@ -103,43 +154,387 @@ void SideNav::renderDebuggerWindow() {
 }
 
 void SideNav::renderMemoryPane() {
+    if (ImGui::CollapsingHeader("Breakpoints & Watchpoints")) {
+        renderWatchpoints();
+    }
     if (ImGui::CollapsingHeader("Cartridge ROM")) {
         memoryEditor.DrawContents(gbRef->memory.cartridge, gbRef->memory.romSize);
     }
     if (ImGui::CollapsingHeader("Video RAM")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x2000, 0x8000);
+        renderMemoryRegion(0x8000, 0x2000);
     }
     if (ImGui::CollapsingHeader("Work RAM 0")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x1000, 0xC000);
+        renderMemoryRegion(0xC000, 0x1000);
     }
     if (ImGui::CollapsingHeader("Work RAM 1")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x1000, 0xD000);
+        renderMemoryRegion(0xD000, 0x1000);
     }
     if (ImGui::CollapsingHeader("Sprite Attribute Table")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x100, 0xFE00);
+        renderMemoryRegion(0xFE00, 0x100);
     }
     if (ImGui::CollapsingHeader("I/O Registers")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x80, 0xFF00);
+        renderMemoryRegion(0xFF00, 0x80);
     }
     if (ImGui::CollapsingHeader("High RAM")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x7F, 0xFF80);
+        renderMemoryRegion(0xFF80, 0x7F);
     }
     if (ImGui::CollapsingHeader("Interrupt Enable Register")) {
-        memoryEditor.DrawContents(gbRef->memory.rom, 0x1, 0xFFFF);
+        renderMemoryRegion(0xFFFF, 0x1);
+    }
+}
+
+// The editor works on a copy of the region from the snapshot, and any
+// byte modified through it is queued to be written to the emulated memory.
+// A region that was just expanded is only in the snapshot from the next frame.
+void SideNav::renderMemoryRegion(uWORD base, int length) {
+    debugRegions.Add(base, length);
+    if (!snapshot->regions.Contains(base, length)) {
+        ImGui::Text("Waiting for the next frame...");
+        return;
+    }
+
+    memcpy(memoryView, &snapshot->memory[base - DEBUG_SNAPSHOT_BASE], length);
+    memcpy(memoryViewShadow, memoryView, length);
+
+    uWORD hitAddr = snapshot->watchHit.addr;
+    if (watchHitPending && hitAddr >= base && hitAddr < base + length) {
+        memoryEditor.GotoAddrAndHighlight(hitAddr - base, hitAddr - base + 1);
+        watchHitPending = false;
+    }
+
+    memoryEditor.DrawContents(memoryView, length, base);
+
+    for (int i = 0; i < length; i++) {
+        if (memoryView[i] != memoryViewShadow[i]) {
+            gbRef->QueueDebugWrite(base + i, memoryView[i]);
+        }
+    }
+}
+
+// Ranges are entered as "C000" or "C000-C0FF", in hexadecimal.
+void SideNav::renderWatchpoints() {
+    bool changed = false;
+
+    ImGui::PushItemWidth(120);
+    ImGui::InputText("##range", watchRange, sizeof(watchRange));
+    ImGui::PopItemWidth();
+    ImGui::SameLine(); ImGui::Checkbox("R", &watchRead);
+    ImGui::SameLine(); ImGui::Checkbox("W", &watchWrite);
+    ImGui::SameLine(); ImGui::Checkbox("X", &watchExecute);
+    ImGui::SameLine();
+
+    if (ImGui::Button("Add")) {
+        unsigned int first = 0;
+        unsigned int last = 0;
+        int fields = sscanf(watchRange, "%x-%x", &first, &last);
+        if (fields == 1)
+            last = first;
+
+        if (fields >= 1 && first <= last && last <= 0xFFFF && (watchRead || watchWrite || watchExecute)) {
+            watchpoints.push_back({ (uWORD)first, (uWORD)last, watchRead, watchWrite, watchExecute });
+            watchRange[0] = '\0';
+            changed = true;
+        }
+    }
+
+    for (size_t i = 0; i < watchpoints.size(); i++) {
+        const Gameboy::Watchpoint& watchpoint = watchpoints[i];
+
+        ImGui::PushID(i);
+        if (ImGui::Button("Remove")) {
+            watchpoints.erase(watchpoints.begin() + i);
+            changed = true;
+            ImGui::PopID();
+            break;
+        }
+        ImGui::PopID();
+
+        ImGui::SameLine();
+        ImGui::Text(" %04X-%04X %s%s%s", watchpoint.first, watchpoint.last,
+            watchpoint.read ? "R" : "-", watchpoint.write ? "W" : "-", watchpoint.execute ? "X" : "-");
     }
+
+    if (changed) {
+        gbRef->SetWatchpoints(watchpoints);
+    }
+}
+
+// Byte of the snapshot at the given address, which must be among its regions.
+uBYTE SideNav::snapshotRead(uWORD addr) {
+    return snapshot->memory[addr - DEBUG_SNAPSHOT_BASE];
 }
 
+// Everything shown comes from the snapshot, which has to hold VRAM, OAM
+// and the LCD registers first.
 void SideNav::renderVideoPane() {
-    // TODO
+    debugRegions.Add(VRAM_ADR, VRAM_SIZE);
+    debugRegions.Add(OAM_ADR, OAM_SPRITE_COUNT * 4);
+    debugRegions.Add(LCDC_ADR, LCD_REGISTERS_SIZE);
+    if (!snapshot->regions.Contains(VRAM_ADR, VRAM_SIZE) ||
+        !snapshot->regions.Contains(OAM_ADR, OAM_SPRITE_COUNT * 4) ||
+        !snapshot->regions.Contains(LCDC_ADR, LCD_REGISTERS_SIZE)) {
+        ImGui::Text("Waiting for the next frame...");
+        return;
+    }
+
+    vramViewer.Update(*snapshot);
+
+    uBYTE lcdc = snapshotRead(LCDC_ADR);
+    int backgroundMap = (lcdc & (1 << 3)) ? 1 : 0;
+
+    if (ImGui::CollapsingHeader("Tile Data")) {
+        ImGui::Image((ImTextureID)(intptr_t)vramViewer.GetTilesTexture(),
+            ImVec2(VRAM_TILES_SIZE_X * VIDEO_PANE_SCALE, VRAM_TILES_SIZE_Y * VIDEO_PANE_SCALE));
+    }
+    if (ImGui::CollapsingHeader("Tile Map 0 (0x9800)")) {
+        renderTileMap(0, backgroundMap == 0);
+    }
+    if (ImGui::CollapsingHeader("Tile Map 1 (0x9C00)")) {
+        renderTileMap(1, backgroundMap == 1);
+    }
+    if (ImGui::CollapsingHeader("Sprite Attribute Table")) {
+        renderOamTable();
+    }
+}
+
+// The map the background is drawn from gets the screen's viewport outlined,
+// which wraps around the edges of the map.
+void SideNav::renderTileMap(int map, bool background) {
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float size = VRAM_MAP_SIZE * VIDEO_PANE_SCALE;
+
+    ImGui::Image((ImTextureID)(intptr_t)vramViewer.GetMapTexture(map), ImVec2(size, size));
+
+    if (!background)
+        return;
+
+    uBYTE scrollX = snapshotRead(SCR_X_ADR);
+    uBYTE scrollY = snapshotRead(SCR_Y_ADR);
+
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->PushClipRect(origin, ImVec2(origin.x + size, origin.y + size), true);
+
+    for (int wrapX = 0; wrapX < 2; wrapX++) {
+        for (int wrapY = 0; wrapY < 2; wrapY++) {
+            float x = origin.x + ((scrollX - (wrapX * VRAM_MAP_SIZE)) * VIDEO_PANE_SCALE);
+            float y = origin.y + ((scrollY - (wrapY * VRAM_MAP_SIZE)) * VIDEO_PANE_SCALE);
+            drawList->AddRect(ImVec2(x, y),
+                ImVec2(x + (NATIVE_SIZE_X * VIDEO_PANE_SCALE), y + (NATIVE_SIZE_Y * VIDEO_PANE_SCALE)),
+                IM_COL32(255, 0, 0, 255), 0.0f, 0, 2.0f);
+        }
+    }
+
+    drawList->PopClipRect();
+}
+
+// Sprites are shown out of the tile data texture, and so with the
+// background palette rather than their own.
+void SideNav::renderOamTable() {
+    const uBYTE* oam = &snapshot->memory[OAM_ADR - DEBUG_SNAPSHOT_BASE];
+    bool tallSprites = snapshotRead(LCDC_ADR) & (1 << 2);
+
+    ImGui::Columns(6, "oam");
+    ImGui::Text("#"); ImGui::NextColumn();
+    ImGui::Text("Sprite"); ImGui::NextColumn();
+    ImGui::Text("X"); ImGui::NextColumn();
+    ImGui::Text("Y"); ImGui::NextColumn();
+    ImGui::Text("Tile"); ImGui::NextColumn();
+    ImGui::Text("Flags"); ImGui::NextColumn();
+
+    for (int i = 0; i < OAM_SPRITE_COUNT; i++) {
+        uBYTE yPos = oam[(i * 4)];
+        uBYTE xPos = oam[(i * 4) + 1];
+        uBYTE tile = oam[(i * 4) + 2];
+        uBYTE attributes = oam[(i * 4) + 3];
+
+        ImGui::Text("%d", i); ImGui::NextColumn();
+
+        // 8x16 sprites are made of an even tile and the one after it.
+        int tiles = tallSprites ? 2 : 1;
+        for (int part = 0; part < tiles; part++) {
+            int spriteTile = tallSprites ? ((tile & 0xFE) + ((attributes & (1 << 6)) ? 1 - part : part)) : tile;
+            ImVec2 uv0(((spriteTile % VRAM_TILES_PER_ROW) * 8.0f) / VRAM_TILES_SIZE_X,
+                ((spriteTile / VRAM_TILES_PER_ROW) * 8.0f) / VRAM_TILES_SIZE_Y);
+            ImVec2 uv1(uv0.x + (8.0f / VRAM_TILES_SIZE_X), uv0.y + (8.0f / VRAM_TILES_SIZE_Y));
+
+            if (attributes & (1 << 5))
+                std::swap(uv0.x, uv1.x);
+            if (attributes & (1 << 6))
+                std::swap(uv0.y, uv1.y);
+
+            ImGui::Image((ImTextureID)(intptr_t)vramViewer.GetTilesTexture(),
+                ImVec2(8 * VIDEO_PANE_SCALE, 8 * VIDEO_PANE_SCALE), uv0, uv1);
+        }
+        ImGui::NextColumn();
+
+        ImGui::Text("%d", xPos - 8); ImGui::NextColumn();
+        ImGui::Text("%d", yPos - 16); ImGui::NextColumn();
+        ImGui::Text("%02X", tile); ImGui::NextColumn();
+        ImGui::Text("%s%s%s%s",
+            (attributes & (1 << 7)) ? "behind " : "",
+            (attributes & (1 << 6)) ? "yflip " : "",
+            (attributes & (1 << 5)) ? "xflip " : "",
+            (attributes & (1 << 4)) ? "OBP1" : "OBP0");
+        ImGui::NextColumn();
+    }
+
+    ImGui::Columns(1);
 }
 
 void SideNav::renderAudioPane() {
     ImGui::Text("Sound channel toggles:");
     ImGui::Checkbox("Channel 1", &gbRef->apu.debuggerCh1Toggle);
     ImGui::Checkbox("Channel 2", &gbRef->apu.debuggerCh2Toggle);
+    ImGui::Checkbox("Channel 4", &gbRef->apu.debuggerCh4Toggle);
+}
+
+// The cpu only records into the profiler in builds made with FUUGB_PROFILE defined.
+void SideNav::renderProfilerPane() {
+    Profiler* profiler = gbRef->cpu.profiler;
+    if (profiler == NULL) {
+        ImGui::TextWrapped("Profiling is only available in profiling builds (make profile).");
+        return;
+    }
+
+    Profiler::Counter total = profiler->GetTotal();
+    ImGui::Text("Instructions: %" PRIu64, total.executions);
+    ImGui::Text("Cycles: %" PRIu64, total.cycles);
+
+    if (ImGui::Button("Reset", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
+        profiler->RequestReset();
+        hotSpots.clear();
+    }
+
+    double totalCycles = (total.cycles != 0) ? (double)total.cycles : 1.0;
+
+    if (ImGui::CollapsingHeader("Opcodes", ImGuiTreeNodeFlags_DefaultOpen)) {
+        int opcodes[PROFILER_OPCODE_COUNT];
+        for (int i = 0; i < PROFILER_OPCODE_COUNT; i++) {
+            opcodes[i] = i;
+        }
+
+        std::partial_sort(opcodes, opcodes + PROFILER_PANE_ROWS, opcodes + PROFILER_OPCODE_COUNT,
+            [profiler](int a, int b) { return profiler->GetOpcode(a).cycles > profiler->GetOpcode(b).cycles; });
+
+        ImGui::Columns(4, "opcodes");
+        ImGui::Text("Opcode"); ImGui::NextColumn();
+        ImGui::Text("Executions"); ImGui::NextColumn();
+        ImGui::Text("Cycles"); ImGui::NextColumn();
+        ImGui::Text("Share"); ImGui::NextColumn();
+
+        for (int i = 0; i < PROFILER_PANE_ROWS; i++) {
+            Profiler::Counter counter = profiler->GetOpcode(opcodes[i]);
+            if (counter.executions == 0)
+                break;
+
+            ImGui::Text("%s", Profiler::OpcodeName(opcodes[i]).c_str()); ImGui::NextColumn();
+            ImGui::Text("%" PRIu64, counter.executions); ImGui::NextColumn();
+            ImGui::Text("%" PRIu64, counter.cycles); ImGui::NextColumn();
+            ImGui::Text("%.2f%%", (counter.cycles * 100.0) / totalCycles); ImGui::NextColumn();
+        }
+
+        ImGui::Columns(1);
+    }
+
+    if (ImGui::CollapsingHeader("Hot spots", ImGuiTreeNodeFlags_DefaultOpen)) {
+        // Going through every location is too slow to be done on each frame,
+        // so the hottest ones are only gathered once a second.
+        if (ImGui::GetTime() - hotSpotsTimestamp >= 1.0) {
+            profiler->GetHotSpots(hotSpots, PROFILER_PANE_ROWS);
+            hotSpotsTimestamp = ImGui::GetTime();
+        }
+
+        ImGui::Columns(4, "hotspots");
+        ImGui::Text("Bank:PC"); ImGui::NextColumn();
+        ImGui::Text("Executions"); ImGui::NextColumn();
+        ImGui::Text("Cycles"); ImGui::NextColumn();
+        ImGui::Text("Share"); ImGui::NextColumn();
+
+        for (const Profiler::HotSpot& hotSpot : hotSpots) {
+            if (hotSpot.bank < 0)
+                ImGui::Text("--:%04X", hotSpot.pc);
+            else
+                ImGui::Text("%02X:%04X", hotSpot.bank, hotSpot.pc);
+            ImGui::NextColumn();
+            ImGui::Text("%" PRIu64, hotSpot.counter.executions); ImGui::NextColumn();
+            ImGui::Text("%" PRIu64, hotSpot.counter.cycles); ImGui::NextColumn();
+            ImGui::Text("%.2f%%", (hotSpot.counter.cycles * 100.0) / totalCycles); ImGui::NextColumn();
+        }
+
+        ImGui::Columns(1);
+    }
+}
+
+// Everything shown here comes from the statistics the emulation thread
+// publishes once per frame, so looking at them never stalls it.
+void SideNav::renderPerformancePane() {
+    int count = gbRef->GetFrameStats(frameStats, FRAME_STATS_HISTORY);
+    if (count == 0) {
+        ImGui::Text("Waiting for the first frame...");
+        return;
+    }
+
+    float frameTimes[FRAME_STATS_HISTORY];
+    float speeds[FRAME_STATS_HISTORY];
+    float instructions[FRAME_STATS_HISTORY];
+    double frameTime = 0, emulationTime = 0, capTime = 0, renderWaitTime = 0, imguiTime = 0;
+    double frameInstructions = 0, frameInterrupts = 0;
+
+    for (int i = 0; i < count; i++) {
+        const Gameboy::FrameStats& stats = frameStats[i];
+        frameTimes[i] = stats.frameTime * 1000.0f;
+        speeds[i] = (stats.frameTime > 0) ? (stats.emulatedTime * 100.0f) / stats.frameTime : 0;
+        instructions[i] = stats.instructions;
+
+        frameTime += stats.frameTime;
+        emulationTime += stats.emulationTime;
+        capTime += stats.capTime;
+        renderWaitTime += stats.renderWaitTime;
+        frameInstructions += stats.instructions;
+        frameInterrupts += stats.interrupts;
+        imguiTime += imguiTimes[(imguiTimeIndex + FRAME_STATS_HISTORY - 1 - i) % FRAME_STATS_HISTORY];
+    }
+
+    const Gameboy::FrameStats& last = frameStats[count - 1];
+    char overlay[32];
+
+    if (ImGui::CollapsingHeader("Frame time", ImGuiTreeNodeFlags_DefaultOpen)) {
+        snprintf(overlay, sizeof(overlay), "%.2f ms", last.frameTime * 1000.0f);
+        ImGui::PlotLines("##frametime", frameTimes, count, 0, overlay, 0.0f, 50.0f, ImVec2(IMGUI_SIZE_X, 60));
+
+        snprintf(overlay, sizeof(overlay), "%.0f%% speed", speeds[count - 1]);
+        ImGui::PlotLines("##speed", speeds, count, 0, overlay, 0.0f, 200.0f, ImVec2(IMGUI_SIZE_X, 60));
+    }
+
+    // Averaged over the frames kept, as fractions of the whole frame. The
+    // side panel is drawn on the main thread while the emulation thread is
+    // running or waiting for the render, so its share overlaps those.
+    if (ImGui::CollapsingHeader("Time split", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Text("Emulation: %.2f ms", (emulationTime * 1000.0) / count);
+        ImGui::ProgressBar(emulationTime / frameTime, ImVec2(IMGUI_SIZE_X, 0));
+        ImGui::Text("Frame cap spin-wait: %.2f ms", (capTime * 1000.0) / count);
+        ImGui::ProgressBar(capTime / frameTime, ImVec2(IMGUI_SIZE_X, 0));
+        ImGui::Text("WaitRender: %.2f ms", (renderWaitTime * 1000.0) / count);
+        ImGui::ProgressBar(renderWaitTime / frameTime, ImVec2(IMGUI_SIZE_X, 0));
+        ImGui::Text("ImGui: %.2f ms", (imguiTime * 1000.0) / count);
+        ImGui::ProgressBar(imguiTime / frameTime, ImVec2(IMGUI_SIZE_X, 0));
+    }
+
+    if (ImGui::CollapsingHeader("Audio", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Text("Ring fill:");
+        ImGui::ProgressBar(last.audioRingFill, ImVec2(IMGUI_SIZE_X, 0));
+        ImGui::Text("Underruns: %" PRIu64, last.underruns);
+    }
+
+    if (ImGui::CollapsingHeader("Cpu", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGui::Text("Instructions per frame: %u (average %.0f)", last.instructions, frameInstructions / count);
+        ImGui::Text("Interrupts per frame: %u (average %.1f)", last.interrupts, frameInterrupts / count);
+        ImGui::PlotLines("##instructions", instructions, count, 0, NULL, 0.0f, FLT_MAX, ImVec2(IMGUI_SIZE_X, 60));
+    }
 }
 
 void SideNav::Shutdown() {
+    vramViewer.Shutdown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -153,7 +548,7 @@ void SideNav::renderDebuggerTabButtons() {
         requiresStylePopping = true;
     }
 
-    if (ImGui::Button("Memory", ImVec2(IMGUI_SIZE_X / 3, 20))) {
+    if (ImGui::Button("Memory", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
         selection = MEMORY;
     }
 
@@ -168,7 +563,7 @@ void SideNav::renderDebuggerTabButtons() {
     }
 
     ImGui::SameLine();
-    if (ImGui::Button("Video", ImVec2(IMGUI_SIZE_X / 3, 20))) {
+    if (ImGui::Button("Video", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
         selection = VIDEO;
     }
 
@@ -183,7 +578,7 @@ void SideNav::renderDebuggerTabButtons() {
     }
 
     ImGui::SameLine();
-    if (ImGui::Button("Audio", ImVec2(IMGUI_SIZE_X / 3, 20))) {
+    if (ImGui::Button("Audio", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
         selection = AUDIO;
     }
 
@@ -191,4 +586,34 @@ void SideNav::renderDebuggerTabButtons() {
         ImGui::PopStyleColor();
         requiresStylePopping = false;
     }
+
+    if (selection == PROFILER) {
+        ImGui::PushStyleColor(ImGuiCol_Button, tabSelectedColor);
+        requiresStylePopping = true;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Profiler", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
+        selection = PROFILER;
+    }
+
+    if (requiresStylePopping) {
+        ImGui::PopStyleColor();
+        requiresStylePopping = false;
+    }
+
+    if (selection == PERFORMANCE) {
+        ImGui::PushStyleColor(ImGuiCol_Button, tabSelectedColor);
+        requiresStylePopping = true;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Performance", ImVec2(IMGUI_SIZE_X / DEBUGGER_TAB_COUNT, 20))) {
+        selection = PERFORMANCE;
+    }
+
+    if (requiresStylePopping) {
+        ImGui::PopStyleColor();
+        requiresStylePopping = false;
+    }
 }
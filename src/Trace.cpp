@@ -0,0 +1,82 @@
+#include "Trace.hpp"
+
+#include <stdio.h>
+#include <algorithm>
+
+const std::chrono::steady_clock::time_point Trace::epoch = std::chrono::steady_clock::now();
+thread_local TraceRing* Trace::threadRing = NULL;
+std::mutex Trace::ringsMtx;
+std::vector<std::unique_ptr<TraceRing>> Trace::rings;
+
+TraceRing::TraceRing(int threadId) : threadId(threadId), head(0) {
+    threadName = "Thread " + std::to_string(threadId);
+}
+
+TraceRing::~TraceRing() {}
+
+// Copies the events currently held, oldest first. Events the owning thread
+// overwrote while they were being copied are left out.
+void TraceRing::Snapshot(std::vector<TraceEvent>& snapshot) {
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = (end > TRACE_RING_SIZE) ? end - TRACE_RING_SIZE : 0;
+
+    snapshot.clear();
+    for (uint64_t i = begin; i < end; i++) {
+        snapshot.push_back(events[i & (TRACE_RING_SIZE - 1)]);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t current = head.load(std::memory_order_relaxed);
+    uint64_t firstIntact = (current > TRACE_RING_SIZE) ? current - TRACE_RING_SIZE : 0;
+
+    if (firstIntact > begin) {
+        snapshot.erase(snapshot.begin(), snapshot.begin() + std::min(firstIntact - begin, end - begin));
+    }
+}
+
+// Names the calling thread in the exported timeline.
+void Trace::SetThreadName(const char* name) {
+    TraceRing* ring = GetRing();
+
+    std::lock_guard<std::mutex> lock(ringsMtx);
+    ring->threadName = name;
+}
+
+TraceRing* Trace::registerThread() {
+    std::lock_guard<std::mutex> lock(ringsMtx);
+
+    rings.push_back(std::unique_ptr<TraceRing>(new TraceRing(rings.size() + 1)));
+    return rings.back().get();
+}
+
+// Writes the events of every thread as a Chrome trace. Threads keep
+// recording while this runs.
+bool Trace::Export(const std::string& path) {
+    FILE* output = fopen(path.c_str(), "w");
+    if (output == NULL) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(ringsMtx);
+    std::vector<TraceEvent> events;
+    bool first = true;
+
+    fprintf(output, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    for (const std::unique_ptr<TraceRing>& ring : rings) {
+        fprintf(output, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",", ring->threadId, ring->threadName.c_str());
+        first = false;
+
+        ring->Snapshot(events);
+        for (const TraceEvent& event : events) {
+            fprintf(output, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, ring->threadId, event.start / 1000.0, (event.end - event.start) / 1000.0);
+        }
+    }
+
+    fprintf(output, "\n]}\n");
+
+    bool written = !ferror(output);
+    return (fclose(output) == 0) && written;
+}
@@ -0,0 +1,250 @@
+#include "TraceComparator.hpp"
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TraceComparator::TraceComparator() {
+    data = NULL;
+    size = 0;
+    cursor = NULL;
+    lineNumber = 0;
+    failedLine = NULL;
+    status = COMPARING;
+}
+
+TraceComparator::~TraceComparator() {
+    Close();
+}
+
+// Maps the reference log. Pages are read in by the kernel as the
+// comparison reaches them, and can be dropped once it is past them.
+bool TraceComparator::Open(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return false;
+    }
+
+    size = info.st_size;
+    if (size > 0) {
+        void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = (const char*)mapping;
+    }
+    close(fd);
+
+    this->path = path;
+    cursor = data;
+    lineNumber = 0;
+    failedLine = NULL;
+    memset(context, 0, sizeof(context));
+    status = (size > 0) ? COMPARING : FINISHED;
+
+    return true;
+}
+
+void TraceComparator::Close() {
+    if (data != NULL) {
+        munmap((void*)data, size);
+        data = NULL;
+    }
+}
+
+// Compares the state before an instruction with the next line of the
+// reference. Returns false once the states differed or the reference ended.
+bool TraceComparator::Compare(const Cpu::State& state, const uBYTE* pcmem) {
+    if (status.load(std::memory_order_relaxed) != COMPARING)
+        return false;
+
+    const char* end = data + size;
+
+    // Blank lines are not instructions.
+    while (cursor < end && (*cursor == '\n' || *cursor == '\r'))
+        cursor++;
+
+    if (cursor >= end) {
+        status.store(FINISHED, std::memory_order_release);
+        return false;
+    }
+
+    const char* begin = cursor;
+    cursor = lineEnd(begin);
+    lineNumber++;
+
+    emulated.af = state.AF;
+    emulated.bc = state.BC;
+    emulated.de = state.DE;
+    emulated.hl = state.HL;
+    emulated.sp = state.SP;
+    emulated.pc = state.PC;
+    memcpy(emulated.pcmem, pcmem, sizeof(emulated.pcmem));
+    emulated.hasPcmem = true;
+
+    bool parsed = parseLine(begin, cursor, expected);
+    bool matched = parsed &&
+        expected.af == emulated.af &&
+        expected.bc == emulated.bc &&
+        expected.de == emulated.de &&
+        expected.hl == emulated.hl &&
+        expected.sp == emulated.sp &&
+        expected.pc == emulated.pc &&
+        (!expected.hasPcmem || memcmp(expected.pcmem, emulated.pcmem, sizeof(expected.pcmem)) == 0);
+
+    if (!matched) {
+        failedLine = begin;
+        status.store(DIVERGED, std::memory_order_release);
+        return false;
+    }
+
+    context[lineNumber % TRACE_COMPARE_CONTEXT] = begin;
+    return true;
+}
+
+// Describes how the comparison went, with the reference lines leading
+// to a divergence and the registers that differed.
+void TraceComparator::Report(FILE* output) {
+    Status result = status.load(std::memory_order_acquire);
+
+    if (result == COMPARING) {
+        fprintf(output, "trace matched %s for %" PRIu64 " instructions so far\n", path.c_str(), lineNumber);
+        return;
+    }
+
+    if (result == FINISHED) {
+        fprintf(output, "trace matched all %" PRIu64 " instructions of %s\n", lineNumber, path.c_str());
+        return;
+    }
+
+    fprintf(output, "trace diverged from %s at line %" PRIu64 ":\n", path.c_str(), lineNumber);
+
+    uint64_t first = (lineNumber > TRACE_COMPARE_CONTEXT) ? lineNumber - TRACE_COMPARE_CONTEXT + 1 : 1;
+    for (uint64_t i = first; i < lineNumber; i++) {
+        const char* begin = context[i % TRACE_COMPARE_CONTEXT];
+        fprintf(output, "  %10" PRIu64 "  %.*s\n", i, (int)(lineEnd(begin) - begin), begin);
+    }
+
+    fprintf(output, "  expected    %.*s\n", (int)(lineEnd(failedLine) - failedLine), failedLine);
+    printLine(output, "  emulated    ", emulated);
+
+    if (!parseLine(failedLine, lineEnd(failedLine), expected)) {
+        fprintf(output, "  the expected line could not be parsed\n");
+        return;
+    }
+
+    fprintf(output, "  differs in ");
+    if ((expected.af >> 8) != (emulated.af >> 8)) fprintf(output, " A");
+    if ((expected.af & 0xFF) != (emulated.af & 0xFF)) fprintf(output, " F");
+    if ((expected.bc >> 8) != (emulated.bc >> 8)) fprintf(output, " B");
+    if ((expected.bc & 0xFF) != (emulated.bc & 0xFF)) fprintf(output, " C");
+    if ((expected.de >> 8) != (emulated.de >> 8)) fprintf(output, " D");
+    if ((expected.de & 0xFF) != (emulated.de & 0xFF)) fprintf(output, " E");
+    if ((expected.hl >> 8) != (emulated.hl >> 8)) fprintf(output, " H");
+    if ((expected.hl & 0xFF) != (emulated.hl & 0xFF)) fprintf(output, " L");
+    if (expected.sp != emulated.sp) fprintf(output, " SP");
+    if (expected.pc != emulated.pc) fprintf(output, " PC");
+    if (expected.hasPcmem && memcmp(expected.pcmem, emulated.pcmem, sizeof(expected.pcmem)) != 0) fprintf(output, " PCMEM");
+    fprintf(output, "\n");
+}
+
+TraceComparator::Status TraceComparator::GetStatus() {
+    return status.load(std::memory_order_acquire);
+}
+
+// Lines are made of KEY:VALUE fields separated by spaces, in any order.
+// Fields other than the registers and PCMEM are ignored. All registers
+// must be present.
+bool TraceComparator::parseLine(const char* begin, const char* end, Line& line) {
+    int found = 0;
+    line.hasPcmem = false;
+
+    const char* p = begin;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\r'))
+            p++;
+
+        const char* key = p;
+        while (p < end && *p != ':' && *p != ' ')
+            p++;
+        if (p >= end || *p != ':')
+            break;
+
+        int keyLength = p - key;
+        p++;
+
+        // PCMEM is 4 comma separated bytes, the others a single hex value.
+        int bytes = 0;
+        unsigned int value = 0;
+        while (p < end && *p != ' ' && *p != '\r') {
+            char c = *p++;
+            if (c == ',') {
+                if (bytes < 4)
+                    line.pcmem[bytes] = value;
+                bytes++;
+                value = 0;
+                continue;
+            }
+
+            int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else return false;
+            value = (value << 4) | digit;
+        }
+
+        if (keyLength == 1) {
+            switch (key[0]) {
+            case 'A': line.af = (line.af & 0x00FF) | (value << 8); found |= 1 << 0; break;
+            case 'F': line.af = (line.af & 0xFF00) | (value & 0xFF); found |= 1 << 1; break;
+            case 'B': line.bc = (line.bc & 0x00FF) | (value << 8); found |= 1 << 2; break;
+            case 'C': line.bc = (line.bc & 0xFF00) | (value & 0xFF); found |= 1 << 3; break;
+            case 'D': line.de = (line.de & 0x00FF) | (value << 8); found |= 1 << 4; break;
+            case 'E': line.de = (line.de & 0xFF00) | (value & 0xFF); found |= 1 << 5; break;
+            case 'H': line.hl = (line.hl & 0x00FF) | (value << 8); found |= 1 << 6; break;
+            case 'L': line.hl = (line.hl & 0xFF00) | (value & 0xFF); found |= 1 << 7; break;
+            }
+        }
+        else if (keyLength == 2 && key[0] == 'S' && key[1] == 'P') {
+            line.sp = value;
+            found |= 1 << 8;
+        }
+        else if (keyLength == 2 && key[0] == 'P' && key[1] == 'C') {
+            line.pc = value;
+            found |= 1 << 9;
+        }
+        else if (keyLength == 5 && memcmp(key, "PCMEM", 5) == 0) {
+            if (bytes != 3)
+                return false;
+            line.pcmem[3] = value;
+            line.hasPcmem = true;
+        }
+    }
+
+    return found == (1 << 10) - 1;
+}
+
+void TraceComparator::printLine(FILE* output, const char* label, const Line& line) {
+    fprintf(output, "%sA:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X PCMEM:%02X,%02X,%02X,%02X\n",
+        label, line.af >> 8, line.af & 0xFF, line.bc >> 8, line.bc & 0xFF,
+        line.de >> 8, line.de & 0xFF, line.hl >> 8, line.hl & 0xFF, line.sp, line.pc,
+        line.pcmem[0], line.pcmem[1], line.pcmem[2], line.pcmem[3]);
+}
+
+const char* TraceComparator::lineEnd(const char* begin) {
+    const char* end = (const char*)memchr(begin, '\n', (data + size) - begin);
+    return (end != NULL) ? end : data + size;
+}
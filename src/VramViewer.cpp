@@ -0,0 +1,178 @@
+#include "VramViewer.hpp"
+
+#define BGP_ADR 0xFF47
+#define VRAM_MAP_OFFSET 0x1800
+#define VRAM_MAP_ENTRIES (VRAM_MAP_TILES * VRAM_MAP_TILES)
+
+// Same shades as the ppu draws the four colors of a palette with.
+static const uBYTE shades[4] = { 245, 211, 169, 0 };
+
+VramViewer::VramViewer() {
+    texturesInitialized = false;
+    tilesTexture = 0;
+    mapTextures[0] = 0;
+    mapTextures[1] = 0;
+    palette = 0;
+    signedTileIds = false;
+    memset(vramSerials, 0x00, sizeof(vramSerials));
+}
+
+VramViewer::~VramViewer() {}
+
+void VramViewer::initializeTextures() {
+    glGenTextures(1, &tilesTexture);
+    glGenTextures(VRAM_MAP_COUNT, mapTextures);
+
+    glBindTexture(GL_TEXTURE_2D, tilesTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, VRAM_TILES_SIZE_X, VRAM_TILES_SIZE_Y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    for (int map = 0; map < VRAM_MAP_COUNT; map++) {
+        glBindTexture(GL_TEXTURE_2D, mapTextures[map]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, VRAM_MAP_SIZE, VRAM_MAP_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Redraws whatever changed since the last update. The palette or the tile
+// addressing mode changing affects every tile or map entry at once.
+void VramViewer::Update(const Gameboy::DebugSnapshot& snapshot) {
+    bool redrawTiles = !texturesInitialized;
+    if (!texturesInitialized) {
+        initializeTextures();
+        texturesInitialized = true;
+    }
+
+    uBYTE lcdc = snapshot.memory[LCDC_ADR - DEBUG_SNAPSHOT_BASE];
+    uBYTE bgp = snapshot.memory[BGP_ADR - DEBUG_SNAPSHOT_BASE];
+    bool signedIds = !(lcdc & (1 << 4));
+
+    redrawTiles = redrawTiles || (bgp != palette);
+    bool redrawMaps = redrawTiles || (signedIds != signedTileIds);
+    palette = bgp;
+    signedTileIds = signedIds;
+
+    // A block changed if it was written to as of a later snapshot than
+    // the one of the last update.
+    bool blockDirty[VRAM_BLOCK_COUNT];
+    for (int block = 0; block < VRAM_BLOCK_COUNT; block++) {
+        blockDirty[block] = snapshot.vramSerials[block] != vramSerials[block];
+    }
+
+    memcpy(vramSerials, snapshot.vramSerials, sizeof(vramSerials));
+    memcpy(vram, &snapshot.memory[VRAM_ADR - DEBUG_SNAPSHOT_BASE], VRAM_SIZE);
+
+    // Tiles are 16 bytes, a block each.
+    for (int tile = 0; tile < VRAM_TILE_COUNT; tile++) {
+        tileChanged[tile] = blockDirty[tile] || redrawTiles;
+        if (!tileChanged[tile])
+            continue;
+
+        int x = (tile % VRAM_TILES_PER_ROW) * 8;
+        int y = (tile / VRAM_TILES_PER_ROW) * 8;
+        decodeTile(tile, &tilesTexels[((y * VRAM_TILES_SIZE_X) + x) * 4], VRAM_TILES_SIZE_X);
+
+        if (!redrawTiles)
+            uploadTile(tilesTexture, tilesTexels, VRAM_TILES_SIZE_X, x, y);
+    }
+
+    if (redrawTiles) {
+        glBindTexture(GL_TEXTURE_2D, tilesTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VRAM_TILES_SIZE_X, VRAM_TILES_SIZE_Y, GL_RGBA, GL_UNSIGNED_BYTE, tilesTexels);
+    }
+
+    for (int map = 0; map < VRAM_MAP_COUNT; map++) {
+        int mapOffset = VRAM_MAP_OFFSET + (map * VRAM_MAP_ENTRIES);
+        bool blockChanged = false;
+
+        for (int entry = 0; entry < VRAM_MAP_ENTRIES; entry++) {
+            // Entries share a dirty flag with the rest of their block.
+            if ((entry % (1 << VRAM_BLOCK_SHIFT)) == 0) {
+                blockChanged = blockDirty[(mapOffset + entry) >> VRAM_BLOCK_SHIFT] || redrawMaps;
+            }
+
+            int tile = mapEntryTile(vram[mapOffset + entry]);
+            if (!blockChanged && !tileChanged[tile])
+                continue;
+
+            int tileX = (tile % VRAM_TILES_PER_ROW) * 8;
+            int tileY = (tile / VRAM_TILES_PER_ROW) * 8;
+            int x = (entry % VRAM_MAP_TILES) * 8;
+            int y = (entry / VRAM_MAP_TILES) * 8;
+
+            for (int row = 0; row < 8; row++) {
+                memcpy(&mapTexels[map][(((y + row) * VRAM_MAP_SIZE) + x) * 4],
+                    &tilesTexels[(((tileY + row) * VRAM_TILES_SIZE_X) + tileX) * 4], 8 * 4);
+            }
+
+            if (!redrawMaps)
+                uploadTile(mapTextures[map], mapTexels[map], VRAM_MAP_SIZE, x, y);
+        }
+
+        if (redrawMaps) {
+            glBindTexture(GL_TEXTURE_2D, mapTextures[map]);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, VRAM_MAP_SIZE, VRAM_MAP_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, mapTexels[map]);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Must be called while the rendering context still exists.
+void VramViewer::Shutdown() {
+    if (!texturesInitialized)
+        return;
+
+    glDeleteTextures(1, &tilesTexture);
+    glDeleteTextures(VRAM_MAP_COUNT, mapTextures);
+    texturesInitialized = false;
+}
+
+GLuint VramViewer::GetTilesTexture() {
+    return tilesTexture;
+}
+
+GLuint VramViewer::GetMapTexture(int map) {
+    return mapTextures[map];
+}
+
+// Each row of a tile is 2 bytes, the first holding the low bit of
+// each pixel's color code and the second the high bit.
+void VramViewer::decodeTile(int tile, uBYTE* texels, int stride) {
+    const uBYTE* data = &vram[tile * 16];
+
+    for (int row = 0; row < 8; row++) {
+        uBYTE* texel = &texels[row * stride * 4];
+
+        for (int column = 0; column < 8; column++) {
+            int bit = 7 - column;
+            int colorCode = ((data[(row * 2) + 1] >> bit) & 0x01) << 1 | ((data[row * 2] >> bit) & 0x01);
+            uBYTE shade = shades[(palette >> (colorCode * 2)) & 0x03];
+
+            texel[0] = shade;
+            texel[1] = shade;
+            texel[2] = shade;
+            texel[3] = 0xFF;
+            texel += 4;
+        }
+    }
+}
+
+void VramViewer::uploadTile(GLuint texture, const uBYTE* texels, int stride, int x, int y) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, 8, 8, GL_RGBA, GL_UNSIGNED_BYTE, &texels[((y * stride) + x) * 4]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// With signed identifiers, tiles are addressed relative to 0x9000.
+int VramViewer::mapEntryTile(uBYTE tileId) {
+    if (signedTileIds)
+        return 256 + (signed char)tileId;
+
+    return tileId;
+}
@@ -0,0 +1,17 @@
+#include "audio/NullAudioSink.hpp"
+
+bool NullAudioSink::Open(AudioMixer::SampleFormat format, int sampleRate) {
+    return true;
+}
+
+void NullAudioSink::Write(const uBYTE* data, size_t size) {}
+
+void NullAudioSink::Close() {}
+
+bool NullAudioSink::IsRealTime() {
+    return false;
+}
+
+bool NullAudioSink::IsNull() {
+    return true;
+}
@@ -0,0 +1,73 @@
+#include "audio/PulseAudioSink.hpp"
+
+PulseAudioSink::PulseAudioSink() {
+    audioClient = NULL;
+}
+
+bool PulseAudioSink::Open(AudioMixer::SampleFormat format, int sampleRate) {
+    // Sampling specification for the pulse audio client
+    //
+    // Format:      Signed 16-bit or 32-bit float PCM encoded sound data.
+    //  Rate:       48000Hz (or 44100Hz) sampling rate. This essentially means this emulator is sending the
+    //              audio server 48000 PCM data points per second.
+    //  Channels:   2. This is because the original DMG supported stereo sound with its two output speakers.
+    pa_sample_spec samplingSpec = pa_sample_spec();
+    samplingSpec.format = (format == AudioMixer::SAMPLE_FORMAT_S16) ? PA_SAMPLE_S16LE : PA_SAMPLE_FLOAT32LE;
+    samplingSpec.rate = sampleRate;
+    samplingSpec.channels = 2;
+
+    // Initialize the pulse audio client
+    int errorCode = 0;
+    audioClient = pa_simple_new(NULL,
+        "FuuGBEmuAPU",
+        PA_STREAM_PLAYBACK,
+        NULL,
+        "FuuGBEmuAPU",
+        &samplingSpec,
+        NULL,
+        NULL,
+        &errorCode);
+
+    // Error checking
+    if (errorCode) {
+        fprintf(stderr, "error initializing audio: %s\n", pa_strerror(errorCode));
+        audioClient = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// Blocks whenever the audio server's buffers are full.
+void PulseAudioSink::Write(const uBYTE* data, size_t size) {
+    int errorCode = 0;
+    pa_simple_write(audioClient, data, size, &errorCode);
+    if (errorCode) {
+#ifdef FUUGB_DEBUG
+        fprintf(stderr, "error playing back audio: %s\n", pa_strerror(errorCode));
+#endif
+        exit(EXIT_FAILURE);
+    }
+}
+
+void PulseAudioSink::Close() {
+    if (audioClient == NULL)
+        return;
+
+    // Drain any remaining audio samples sent to the audio server.
+    int errorCode = 0;
+    pa_simple_drain(audioClient, &errorCode);
+    if (errorCode) {
+#ifdef FUUGB_DEBUG
+        fprintf(stderr, "error flushing audio buffer: %s\n", pa_strerror(errorCode));
+#endif
+        exit(EXIT_FAILURE);
+    }
+
+    pa_simple_free(audioClient);
+    audioClient = NULL;
+}
+
+bool PulseAudioSink::IsRealTime() {
+    return true;
+}
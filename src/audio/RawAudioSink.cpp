@@ -0,0 +1,53 @@
+#include "audio/RawAudioSink.hpp"
+
+RawAudioSink::RawAudioSink(std::string path) {
+    this->path = path;
+    fd = -1;
+}
+
+bool RawAudioSink::Open(AudioMixer::SampleFormat format, int sampleRate) {
+    if (path == "-") {
+        fd = STDOUT_FILENO;
+    }
+    else {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (fd < 0) {
+        fprintf(stderr, "error opening raw audio output %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // A reader going away would otherwise kill the emulator with SIGPIPE,
+    // rather than letting the write report it.
+    signal(SIGPIPE, SIG_IGN);
+    return true;
+}
+
+void RawAudioSink::Write(const uBYTE* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            fprintf(stderr, "error writing raw audio output %s: %s\n", path.c_str(), strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        data += written;
+        size -= written;
+    }
+}
+
+void RawAudioSink::Close() {
+    if (fd >= 0 && fd != STDOUT_FILENO) {
+        close(fd);
+    }
+    fd = -1;
+}
+
+bool RawAudioSink::IsRealTime() {
+    return false;
+}
@@ -0,0 +1,91 @@
+#include "audio/WavAudioSink.hpp"
+
+// Writes a 32-bit value in little endian, as every WAV field is.
+static void putLE32(uBYTE* dest, uint32_t value) {
+    dest[0] = value & 0xFF;
+    dest[1] = (value >> 8) & 0xFF;
+    dest[2] = (value >> 16) & 0xFF;
+    dest[3] = (value >> 24) & 0xFF;
+}
+
+static void putLE16(uBYTE* dest, uint16_t value) {
+    dest[0] = value & 0xFF;
+    dest[1] = (value >> 8) & 0xFF;
+}
+
+WavAudioSink::WavAudioSink(std::string path) {
+    this->path = path;
+    file = NULL;
+    format = AudioMixer::SAMPLE_FORMAT_S16;
+    sampleRate = 0;
+    dataSize = 0;
+}
+
+bool WavAudioSink::Open(AudioMixer::SampleFormat format, int sampleRate) {
+    this->format = format;
+    this->sampleRate = sampleRate;
+
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "error opening wav file %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    writeHeader(0xFFFFFFFF);
+    return true;
+}
+
+void WavAudioSink::Write(const uBYTE* data, size_t size) {
+    if (fwrite(data, 1, size, file) != size) {
+        fprintf(stderr, "error writing wav file %s: %s\n", path.c_str(), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    dataSize += size;
+}
+
+void WavAudioSink::Close() {
+    if (file == NULL)
+        return;
+
+    // Sizes are limited to 32 bits, anything longer is left as unknown.
+    // Files being piped somewhere can't be rewound, and keep them unknown as well.
+    if (dataSize + WAV_HEADER_SIZE < 0xFFFFFFFF && fseek(file, 0, SEEK_SET) == 0) {
+        writeHeader((uint32_t)dataSize);
+    }
+
+    fclose(file);
+    file = NULL;
+}
+
+bool WavAudioSink::IsRealTime() {
+    return false;
+}
+
+// RIFF header, followed by the format chunk and the data chunk's header.
+// https://www.mmsp.ece.mcgill.ca/Documents/AudioFormats/WAVE/WAVE.html
+void WavAudioSink::writeHeader(uint32_t dataSize) {
+    uBYTE header[WAV_HEADER_SIZE];
+    int frameSize = AudioMixer::FrameSize(format);
+
+    memcpy(header, "RIFF", 4);
+    putLE32(header + 4, (dataSize == 0xFFFFFFFF) ? 0xFFFFFFFF : dataSize + WAV_HEADER_SIZE - 8);
+    memcpy(header + 8, "WAVE", 4);
+
+    memcpy(header + 12, "fmt ", 4);
+    putLE32(header + 16, 16);
+    putLE16(header + 20, (format == AudioMixer::SAMPLE_FORMAT_S16) ? 1 : 3); // PCM or IEEE float
+    putLE16(header + 22, 2);
+    putLE32(header + 24, sampleRate);
+    putLE32(header + 28, sampleRate * frameSize);
+    putLE16(header + 32, frameSize);
+    putLE16(header + 34, (frameSize / 2) * 8);
+
+    memcpy(header + 36, "data", 4);
+    putLE32(header + 40, dataSize);
+
+    if (fwrite(header, 1, WAV_HEADER_SIZE, file) != WAV_HEADER_SIZE) {
+        fprintf(stderr, "error writing wav file %s: %s\n", path.c_str(), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
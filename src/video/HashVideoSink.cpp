@@ -0,0 +1,198 @@
+#include "video/HashVideoSink.hpp"
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t value, int amount) {
+    return (value << amount) | (value >> (64 - amount));
+}
+
+static inline uint64_t read64(const uBYTE* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint32_t read32(const uBYTE* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline uint64_t xxhRound(uint64_t accumulator, uint64_t input) {
+    accumulator += input * XXH_PRIME64_2;
+    accumulator = rotl64(accumulator, 31);
+    return accumulator * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxhMergeRound(uint64_t accumulator, uint64_t value) {
+    accumulator ^= xxhRound(0, value);
+    return (accumulator * XXH_PRIME64_1) + XXH_PRIME64_4;
+}
+
+HashVideoSink::HashVideoSink(std::string goldenPath, std::vector<int> frames) {
+    this->goldenPath = goldenPath;
+    currentFrame = 0;
+    frameSize = 0;
+
+    for (int frame : frames) {
+        hashes[frame] = 0;
+        reached[frame] = false;
+    }
+}
+
+bool HashVideoSink::Open(int width, int height) {
+    frameSize = width * height * VIDEO_PIXEL_SIZE;
+    frame.resize(frameSize);
+
+    if (!goldenPath.empty() && !readGolden())
+        return false;
+
+    return true;
+}
+
+void HashVideoSink::Write(const uBYTE* frame) {
+    int frameNumber = currentFrame++;
+    if (hashes.find(frameNumber) == hashes.end())
+        return;
+
+    memcpy(this->frame.data(), frame, frameSize);
+    for (size_t i = 3; i < frameSize; i += VIDEO_PIXEL_SIZE) {
+        this->frame[i] = 0x00;
+    }
+
+    hashes[frameNumber] = Hash(this->frame.data(), frameSize);
+    reached[frameNumber] = true;
+}
+
+void HashVideoSink::Close() {}
+
+// Last frame that has to be emulated for every hash to be known.
+int HashVideoSink::LastFrame() {
+    return hashes.empty() ? -1 : hashes.rbegin()->first;
+}
+
+// Without a golden file, prints the hashes to the standard output. Otherwise,
+// reports any frame whose hash differs or that was never reached to stderr.
+// Returns whether all hashes matched.
+bool HashVideoSink::Report() {
+    if (goldenPath.empty()) {
+        for (auto& entry : hashes) {
+            if (reached[entry.first]) {
+                fprintf(stdout, "%d %016" PRIx64 "\n", entry.first, entry.second);
+            }
+        }
+        return true;
+    }
+
+    int mismatches = 0;
+    for (auto& entry : expected) {
+        if (!reached[entry.first]) {
+            fprintf(stderr, "frame %d: not reached, expected %016" PRIx64 "\n", entry.first, entry.second);
+            mismatches++;
+        }
+        else if (hashes[entry.first] != entry.second) {
+            fprintf(stderr, "frame %d: hash %016" PRIx64 ", expected %016" PRIx64 "\n",
+                entry.first, hashes[entry.first], entry.second);
+            mismatches++;
+        }
+    }
+
+    if (mismatches > 0) {
+        fprintf(stderr, "%d of %zu frames did not match %s\n", mismatches, expected.size(), goldenPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// XXH64, with a seed of 0.
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+uint64_t HashVideoSink::Hash(const uBYTE* data, size_t size) {
+    const uBYTE* end = data + size;
+    uint64_t hash;
+
+    if (size >= 32) {
+        uint64_t v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = XXH_PRIME64_2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - XXH_PRIME64_1;
+
+        for (; data + 32 <= end; data += 32) {
+            v1 = xxhRound(v1, read64(data));
+            v2 = xxhRound(v2, read64(data + 8));
+            v3 = xxhRound(v3, read64(data + 16));
+            v4 = xxhRound(v4, read64(data + 24));
+        }
+
+        hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        hash = xxhMergeRound(hash, v1);
+        hash = xxhMergeRound(hash, v2);
+        hash = xxhMergeRound(hash, v3);
+        hash = xxhMergeRound(hash, v4);
+    }
+    else {
+        hash = XXH_PRIME64_5;
+    }
+
+    hash += size;
+
+    for (; data + 8 <= end; data += 8) {
+        hash ^= xxhRound(0, read64(data));
+        hash = (rotl64(hash, 27) * XXH_PRIME64_1) + XXH_PRIME64_4;
+    }
+
+    if (data + 4 <= end) {
+        hash ^= read32(data) * XXH_PRIME64_1;
+        hash = (rotl64(hash, 23) * XXH_PRIME64_2) + XXH_PRIME64_3;
+        data += 4;
+    }
+
+    for (; data < end; data++) {
+        hash ^= (*data) * XXH_PRIME64_5;
+        hash = rotl64(hash, 11) * XXH_PRIME64_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= XXH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Blank lines and lines starting with # are skipped.
+bool HashVideoSink::readGolden() {
+    FILE* file = fopen(goldenPath.c_str(), "r");
+    if (file == NULL) {
+        fprintf(stderr, "error opening golden file %s: %s\n", goldenPath.c_str(), strerror(errno));
+        return false;
+    }
+
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+
+        int frameNumber;
+        uint64_t hash;
+        if (line[0] == '#' || strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        if (sscanf(line, "%d %" SCNx64, &frameNumber, &hash) != 2 || frameNumber < 0) {
+            fprintf(stderr, "error reading golden file %s: invalid line %d\n", goldenPath.c_str(), lineNumber);
+            fclose(file);
+            return false;
+        }
+
+        expected[frameNumber] = hash;
+        hashes[frameNumber] = 0;
+        reached[frameNumber] = false;
+    }
+
+    fclose(file);
+    return true;
+}
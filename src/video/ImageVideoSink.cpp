@@ -0,0 +1,191 @@
+#include "video/ImageVideoSink.hpp"
+
+// Stored deflate blocks hold at most 65535 bytes each.
+#define DEFLATE_MAX_STORED_BLOCK 65535
+
+static void putBE32(uBYTE* dest, uint32_t value) {
+    dest[0] = (value >> 24) & 0xFF;
+    dest[1] = (value >> 16) & 0xFF;
+    dest[2] = (value >> 8) & 0xFF;
+    dest[3] = value & 0xFF;
+}
+
+// CRC-32 used by PNG chunks, computed with the usual 256 entry table.
+static uint32_t crc32(const uBYTE* data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    static bool tableReady = false;
+
+    if (!tableReady) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const uBYTE* data, size_t size) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    for (size_t i = 0; i < size; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void writeBytes(FILE* file, const uBYTE* data, size_t size) {
+    if (fwrite(data, 1, size, file) != size) {
+        fprintf(stderr, "error writing image file: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void writePngChunk(FILE* file, const char* type, const uBYTE* data, size_t size) {
+    uBYTE header[8];
+    putBE32(header, size);
+    memcpy(header + 4, type, 4);
+
+    uBYTE trailer[4];
+    putBE32(trailer, crc32(data, size, crc32(header + 4, 4)));
+
+    writeBytes(file, header, 8);
+    if (size > 0) {
+        writeBytes(file, data, size);
+    }
+    writeBytes(file, trailer, 4);
+}
+
+ImageVideoSink::ImageVideoSink(std::string pathPattern, int firstFrame, int lastFrame) {
+    this->pathPattern = pathPattern;
+    this->firstFrame = firstFrame;
+    this->lastFrame = lastFrame;
+    currentFrame = 0;
+    width = 0;
+    height = 0;
+
+    std::string extension = (pathPattern.size() >= 4) ? pathPattern.substr(pathPattern.size() - 4) : "";
+    png = (strcasecmp(extension.c_str(), ".png") == 0);
+}
+
+bool ImageVideoSink::Open(int width, int height) {
+    this->width = width;
+    this->height = height;
+    rgb.resize(width * height * 3);
+    return true;
+}
+
+void ImageVideoSink::Write(const uBYTE* frame) {
+    int frameNumber = currentFrame++;
+    if (frameNumber < firstFrame || (lastFrame >= 0 && frameNumber > lastFrame))
+        return;
+
+    std::string path = framePath(frameNumber);
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        fprintf(stderr, "error opening image file %s: %s\n", path.c_str(), strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < width * height; i++) {
+        rgb[(i * 3)] = frame[(i * VIDEO_PIXEL_SIZE)];
+        rgb[(i * 3) + 1] = frame[(i * VIDEO_PIXEL_SIZE) + 1];
+        rgb[(i * 3) + 2] = frame[(i * VIDEO_PIXEL_SIZE) + 2];
+    }
+
+    if (png) {
+        writePng(file, rgb.data());
+    }
+    else {
+        writePpm(file, rgb.data());
+    }
+
+    fclose(file);
+}
+
+void ImageVideoSink::Close() {}
+
+// Substitutes the frame number for the first %d or %0<width>d of the pattern.
+std::string ImageVideoSink::framePath(int frame) {
+    size_t start = pathPattern.find('%');
+    if (start == std::string::npos)
+        return pathPattern;
+
+    size_t end = start + 1;
+    while (end < pathPattern.size() && isdigit(pathPattern[end]))
+        end++;
+
+    if (end >= pathPattern.size() || pathPattern[end] != 'd')
+        return pathPattern;
+
+    int padding = atoi(pathPattern.substr(start + 1, end - start - 1).c_str());
+    char number[32];
+    snprintf(number, sizeof(number), "%0*d", padding, frame);
+
+    return pathPattern.substr(0, start) + number + pathPattern.substr(end + 1);
+}
+
+void ImageVideoSink::writePpm(FILE* file, const uBYTE* frame) {
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    writeBytes(file, frame, width * height * 3);
+}
+
+// Writes an 8-bit RGB PNG. The image data is left uncompressed, in stored
+// deflate blocks, since frames are small and this keeps the dump cheap.
+// https://www.w3.org/TR/png/
+void ImageVideoSink::writePng(FILE* file, const uBYTE* frame) {
+    static const uBYTE signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    writeBytes(file, signature, 8);
+
+    uBYTE header[13];
+    putBE32(header, width);
+    putBE32(header + 4, height);
+    header[8] = 8;  // Bit depth
+    header[9] = 2;  // Truecolor
+    header[10] = 0; // Deflate
+    header[11] = 0; // Adaptive filtering
+    header[12] = 0; // No interlacing
+    writePngChunk(file, "IHDR", header, sizeof(header));
+
+    // Every row is preceded by its filter type, none in this case.
+    size_t rowSize = (width * 3) + 1;
+    std::vector<uBYTE> scanlines(rowSize * height);
+    for (int y = 0; y < height; y++) {
+        scanlines[y * rowSize] = 0;
+        memcpy(&scanlines[(y * rowSize) + 1], frame + (y * width * 3), width * 3);
+    }
+
+    // zlib stream: header, stored blocks, then the adler32 of the scanlines.
+    std::vector<uBYTE> data;
+    data.push_back(0x78);
+    data.push_back(0x01);
+
+    for (size_t offset = 0; offset < scanlines.size(); offset += DEFLATE_MAX_STORED_BLOCK) {
+        size_t size = std::min(scanlines.size() - offset, (size_t)DEFLATE_MAX_STORED_BLOCK);
+        bool last = (offset + size == scanlines.size());
+
+        data.push_back(last ? 0x01 : 0x00);
+        data.push_back(size & 0xFF);
+        data.push_back((size >> 8) & 0xFF);
+        data.push_back(~size & 0xFF);
+        data.push_back((~size >> 8) & 0xFF);
+        data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+    }
+
+    uBYTE checksum[4];
+    putBE32(checksum, adler32(scanlines.data(), scanlines.size()));
+    data.insert(data.end(), checksum, checksum + 4);
+
+    writePngChunk(file, "IDAT", data.data(), data.size());
+    writePngChunk(file, "IEND", NULL, 0);
+}
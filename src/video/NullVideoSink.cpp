@@ -0,0 +1,13 @@
+#include "video/NullVideoSink.hpp"
+
+bool NullVideoSink::Open(int width, int height) {
+    return true;
+}
+
+void NullVideoSink::Write(const uBYTE* frame) {}
+
+void NullVideoSink::Close() {}
+
+bool NullVideoSink::IsNull() {
+    return true;
+}
@@ -0,0 +1,195 @@
+#include "video/Y4mVideoSink.hpp"
+
+// Full range BT.601 coefficients, scaled by 256.
+#define Y_R 77
+#define Y_G 150
+#define Y_B 29
+#define U_R -43
+#define U_G -85
+#define U_B 128
+#define V_R 128
+#define V_G -107
+#define V_B -21
+
+Y4mVideoSink::Y4mVideoSink(std::string path) : frameRing(Y4M_RING_BUFFER_SIZE) {
+    this->path = path;
+    fd = -1;
+    width = 0;
+    height = 0;
+    frameSize = 0;
+    writerRunning = false;
+}
+
+bool Y4mVideoSink::Open(int width, int height) {
+    this->width = width;
+    this->height = height;
+    frameSize = width * height * VIDEO_PIXEL_SIZE;
+
+    if (frameSize > frameRing.Capacity()) {
+        fprintf(stderr, "error opening y4m output %s: frames are too large\n", path.c_str());
+        return false;
+    }
+
+    if (path == "-") {
+        fd = STDOUT_FILENO;
+    }
+    else {
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (fd < 0) {
+        fprintf(stderr, "error opening y4m output %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    // A reader going away would otherwise kill the emulator with SIGPIPE,
+    // rather than letting the write report it.
+    signal(SIGPIPE, SIG_IGN);
+
+    // Square pixels at the rate frames are emulated, see Gameboy::RunFrame.
+    char header[128];
+    int headerSize = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C444 XCOLORRANGE=FULL\n", width, height);
+    writeBytes(header, headerSize);
+
+    frame.resize(frameSize);
+    planes.resize(width * height * 3);
+
+    writerRunning = true;
+    writer = std::unique_ptr<std::thread>(new std::thread(&Y4mVideoSink::WriterRoutine, this));
+    return true;
+}
+
+// Queues the frame for the writer thread. Recordings must not skip frames,
+// so should the writer fall a whole ring behind, this waits for it.
+void Y4mVideoSink::Write(const uBYTE* frame) {
+    std::unique_lock<std::mutex> lock(writerMtx);
+    while (frameRing.Capacity() - frameRing.Size() < frameSize) {
+        ringSpaceCv.wait_for(lock, std::chrono::milliseconds(5));
+    }
+    lock.unlock();
+
+    frameRing.Write(frame, frameSize);
+    writerCv.notify_one();
+}
+
+void Y4mVideoSink::Close() {
+    if (fd < 0)
+        return;
+
+    writerRunning = false;
+    writerCv.notify_one();
+    writer->join();
+
+    // Write out whatever the writer had not gotten to yet.
+    while (frameRing.Size() >= frameSize) {
+        frameRing.Read(frame.data(), frameSize);
+        writeFrame(frame.data());
+    }
+
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+    fd = -1;
+}
+
+void Y4mVideoSink::WriterRoutine() {
+    while (writerRunning) {
+        if (frameRing.Size() < frameSize) {
+            std::unique_lock<std::mutex> lock(writerMtx);
+            writerCv.wait_for(lock, std::chrono::milliseconds(100), [this] {
+                return !writerRunning || frameRing.Size() >= frameSize;
+            });
+            continue;
+        }
+
+        frameRing.Read(frame.data(), frameSize);
+        ringSpaceCv.notify_one();
+
+        writeFrame(frame.data());
+    }
+}
+
+void Y4mVideoSink::writeFrame(const uBYTE* frame) {
+    int pixelCount = width * height;
+    ConvertToYuv(frame, pixelCount, planes.data(), planes.data() + pixelCount, planes.data() + (pixelCount * 2));
+
+    writeBytes("FRAME\n", 6);
+    writeBytes(planes.data(), planes.size());
+}
+
+void Y4mVideoSink::writeBytes(const void* data, size_t size) {
+    const uBYTE* bytes = (const uBYTE*)data;
+
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            fprintf(stderr, "error writing y4m output %s: %s\n", path.c_str(), strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        bytes += written;
+        size -= written;
+    }
+}
+
+// Converts pixels of a frame into separate Y, U and V planes. With SSE2,
+// 8 pixels are converted at once: each pixel's channels are widened to 16
+// bits so that pmaddwd computes two of its weighted sums at a time.
+void Y4mVideoSink::ConvertToYuv(const uBYTE* frame, int pixelCount, uBYTE* y, uBYTE* u, uBYTE* v) {
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i yWeights = _mm_setr_epi16(Y_R, Y_G, Y_B, 0, Y_R, Y_G, Y_B, 0);
+    const __m128i uWeights = _mm_setr_epi16(U_R, U_G, U_B, 0, U_R, U_G, U_B, 0);
+    const __m128i vWeights = _mm_setr_epi16(V_R, V_G, V_B, 0, V_R, V_G, V_B, 0);
+    const __m128i rounding = _mm_set1_epi32(128);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+
+    for (; i + 8 <= pixelCount; i += 8) {
+        __m128i first = _mm_loadu_si128((const __m128i*)(frame + (i * VIDEO_PIXEL_SIZE)));
+        __m128i second = _mm_loadu_si128((const __m128i*)(frame + ((i + 4) * VIDEO_PIXEL_SIZE)));
+
+        // Two pixels per register, as R G B X R G B X.
+        __m128i pixels[4] = {
+            _mm_unpacklo_epi8(first, zero),
+            _mm_unpackhi_epi8(first, zero),
+            _mm_unpacklo_epi8(second, zero),
+            _mm_unpackhi_epi8(second, zero)
+        };
+
+        // pmaddwd leaves R*wR+G*wG and B*wB for each pixel, which are then
+        // added together by gathering the even and odd lanes of two registers.
+        auto weigh = [&](__m128i weights, int pair) {
+            __m128 a = _mm_castsi128_ps(_mm_madd_epi16(pixels[pair], weights));
+            __m128 b = _mm_castsi128_ps(_mm_madd_epi16(pixels[pair + 1], weights));
+            __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+            __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+            return _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(even, odd), rounding), 8);
+        };
+
+        __m128i luma = _mm_packs_epi32(weigh(yWeights, 0), weigh(yWeights, 2));
+        __m128i blue = _mm_add_epi16(_mm_packs_epi32(weigh(uWeights, 0), weigh(uWeights, 2)), chromaOffset);
+        __m128i red = _mm_add_epi16(_mm_packs_epi32(weigh(vWeights, 0), weigh(vWeights, 2)), chromaOffset);
+
+        _mm_storel_epi64((__m128i*)(y + i), _mm_packus_epi16(luma, zero));
+        _mm_storel_epi64((__m128i*)(u + i), _mm_packus_epi16(blue, zero));
+        _mm_storel_epi64((__m128i*)(v + i), _mm_packus_epi16(red, zero));
+    }
+#endif
+
+    // Remaining pixels, or all of them without SIMD support.
+    for (; i < pixelCount; i++) {
+        int r = frame[(i * VIDEO_PIXEL_SIZE)];
+        int g = frame[(i * VIDEO_PIXEL_SIZE) + 1];
+        int b = frame[(i * VIDEO_PIXEL_SIZE) + 2];
+
+        y[i] = std::min(std::max(((Y_R * r) + (Y_G * g) + (Y_B * b) + 128) >> 8, 0), 255);
+        u[i] = std::min(std::max((((U_R * r) + (U_G * g) + (U_B * b) + 128) >> 8) + 128, 0), 255);
+        v[i] = std::min(std::max((((V_R * r) + (V_G * g) + (V_B * b) + 128) >> 8) + 128, 0), 255);
+    }
+}
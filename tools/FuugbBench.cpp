@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <initializer_list>
+
+#include "Gameboy.hpp"
+#include "audio/RawAudioSink.hpp"
+
+// fuugb-bench: runs a fixed set of synthetic workloads headless for a fixed
+// amount of frames, and reports the emulation's throughput as JSON.
+//
+// Each workload is run twice. The first run is timed as a whole, for the
+// throughput figures. The second enables the core's benchmark zones (see
+// Benchmark.hpp), for the breakdown of where that time goes. Emulation is
+// deterministic, so both runs execute exactly the same instructions.
+
+#define DEFAULT_BENCHMARK_FRAMES 3600
+#define CYCLES_PER_FRAME (CPU_FREQUENCY_HZ / 60)
+
+BenchmarkCounters benchmarkCounters;
+
+// Assembles the workloads' roms: 32 KiB, no mapper, with the entry point
+// jumping to the workload's code at 0x150.
+class RomBuilder {
+
+public:
+    RomBuilder() : rom(MAX_CART_SIZE, 0x00) {
+        at(0x0100);
+        emit({ 0x00, 0xC3, 0x50, 0x01 });  // nop; jp 0x150
+        at(0x0150);
+        emit({ 0xF3, 0x31, 0xFE, 0xFF });  // di; ld sp, 0xFFFE
+    }
+
+    void at(int address) {
+        pc = address;
+    }
+
+    void emit(std::initializer_list<int> bytes) {
+        for (int byte : bytes) {
+            rom[pc++] = byte;
+        }
+    }
+
+    uBYTE* Data() {
+        return rom.data();
+    }
+
+private:
+    std::vector<uBYTE> rom;
+    int pc;
+};
+
+struct Workload {
+    const char* name;
+    const char* description;
+    void (*build)(RomBuilder& rom);
+};
+
+// Arithmetic and logic between registers, without any memory access
+// besides fetching the instructions.
+static void buildAluWorkload(RomBuilder& rom) {
+    rom.emit({
+        0x78,           // loop: ld a, b
+        0x81,           // add a, c
+        0xAA,           // xor d
+        0x47,           // ld b, a
+        0x0C,           // inc c
+        0x15,           // dec d
+        0x07,           // rlca
+        0xA3,           // and e
+        0xB4,           // or h
+        0x5F,           // ld e, a
+        0xCB, 0x25,     // sla l
+        0x8D,           // adc a, l
+        0x90,           // sub b
+        0x18, 0xF0,     // jr loop
+    });
+}
+
+// Copies 4 KiB of rom to work ram, over and over.
+static void buildMemoryCopyWorkload(RomBuilder& rom) {
+    rom.emit({
+        0x21, 0x00, 0x10,   // outer: ld hl, 0x1000
+        0x11, 0x00, 0xC0,   // ld de, 0xC000
+        0x01, 0x00, 0x10,   // ld bc, 0x1000
+        0x2A,               // inner: ld a, (hl+)
+        0x12,               // ld (de), a
+        0x13,               // inc de
+        0x0B,               // dec bc
+        0x78,               // ld a, b
+        0xB1,               // or c
+        0x20, 0xF8,         // jr nz, inner
+        0x18, 0xED,         // jr outer
+    });
+
+    rom.at(0x1000);
+    for (int i = 0; i < 0x1000; i++) {
+        rom.emit({ (i * 7) & 0xFF });
+    }
+}
+
+// Halts until the next vblank interrupt, which returns right away.
+static void buildHaltWorkload(RomBuilder& rom) {
+    rom.emit({
+        0x3E, 0x01,     // ld a, 0x01
+        0xE0, 0xFF,     // ldh (IE), a
+        0xAF,           // xor a
+        0xE0, 0x0F,     // ldh (IF), a
+        0xFB,           // ei
+        0x76,           // loop: halt
+        0x00,           // nop
+        0x18, 0xFC,     // jr loop
+    });
+
+    rom.at(0x0040);
+    rom.emit({ 0xD9 }); // reti
+}
+
+// Fills OAM with 40 sprites spread over the screen, then idles while the
+// ppu draws them on every scanline.
+static void buildSpriteWorkload(RomBuilder& rom) {
+    rom.emit({
+        0xAF,               // xor a
+        0xE0, 0x40,         // ldh (LCDC), a
+        0x21, 0x10, 0x80,   // ld hl, 0x8010
+        0x06, 0x10,         // ld b, 16
+        0x3E, 0xAA,         // ld a, 0xAA
+        0x22,               // tile: ld (hl+), a
+        0x2F,               // cpl
+        0x05,               // dec b
+        0x20, 0xFB,         // jr nz, tile
+        0x21, 0x00, 0x20,   // ld hl, 0x2000
+        0x11, 0x00, 0xFE,   // ld de, OAM
+        0x06, 0xA0,         // ld b, 160
+        0x2A,               // oam: ld a, (hl+)
+        0x12,               // ld (de), a
+        0x13,               // inc de
+        0x05,               // dec b
+        0x20, 0xFA,         // jr nz, oam
+        0x3E, 0x93,         // ld a, 0x93
+        0xE0, 0x40,         // ldh (LCDC), a
+        0x18, 0xFE,         // idle: jr idle
+    });
+
+    rom.at(0x2000);
+    for (int i = 0; i < 40; i++) {
+        rom.emit({ 16 + ((i * 11) % 144), 8 + ((i * 13) % 160), 0x01, (i & 0x03) << 5 });
+    }
+}
+
+static const Workload workloads[] = {
+    { "alu", "register arithmetic loop", buildAluWorkload },
+    { "memcpy", "rom to work ram copy loop", buildMemoryCopyWorkload },
+    { "halt", "idle in halt between vblanks", buildHaltWorkload },
+    { "sprites", "40 sprites drawn every frame", buildSpriteWorkload },
+};
+
+struct BenchmarkResult {
+    double seconds;
+    uint64_t cycles;
+    uint64_t instructions;
+    double cpuShare;
+    double memoryShare;
+    double ppuShare;
+    double apuShare;
+};
+
+// Runs the workload on a fresh gameboy. Sound is emulated and its samples
+// discarded through /dev/null, as the null sink would skip the apu.
+static double runWorkload(const Workload& workload, int frames, uint64_t& cycles) {
+    RomBuilder rom;
+    workload.build(rom);
+
+    Gameboy gameboy(rom.Data());
+    gameboy.InitializeAudio(std::unique_ptr<AudioSink>(new RawAudioSink("/dev/null")), AudioMixer::SAMPLE_FORMAT_S16, AUDIO_SAMPLING_FREQUENCY_HZ);
+    gameboy.SkipBootRom();
+
+    auto start = std::chrono::steady_clock::now();
+    gameboy.RunFrames(frames);
+    auto end = std::chrono::steady_clock::now();
+
+    cycles = gameboy.GetCycleCount();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static BenchmarkResult benchmark(const Workload& workload, int frames) {
+    BenchmarkResult result = BenchmarkResult();
+
+    benchmarkCounters = BenchmarkCounters();
+    result.seconds = runWorkload(workload, frames, result.cycles);
+
+    uint64_t cycles;
+    benchmarkCounters.enabled = true;
+    uint64_t start = __rdtsc();
+    runWorkload(workload, frames, cycles);
+    uint64_t total = __rdtsc() - start;
+    benchmarkCounters.enabled = false;
+
+    // Memory accesses happen from within the cpu's instructions.
+    result.instructions = benchmarkCounters.instructions;
+    result.cpuShare = (double)(benchmarkCounters.cpuTicks - benchmarkCounters.memoryTicks) / total;
+    result.memoryShare = (double)benchmarkCounters.memoryTicks / total;
+    result.ppuShare = (double)benchmarkCounters.ppuTicks / total;
+    result.apuShare = (double)benchmarkCounters.apuTicks / total;
+    return result;
+}
+
+void printUsage() {
+    fprintf(stdout, "fuugb-bench\n");
+    fprintf(stdout, "Usage:\n");
+    fprintf(stdout, "\tfuugb-bench [OPTIONS]\n");
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "\t--frames <frames>\tFrames emulated per workload (default %d).\n", DEFAULT_BENCHMARK_FRAMES);
+    fprintf(stdout, "\t--workload <name>\tOnly runs the given workload (alu, memcpy, halt or sprites).\n");
+    fprintf(stdout, "\t--output <path>\t\tWrites the JSON results to <path> instead of the standard output.\n");
+}
+
+int main(int argc, char** argv) {
+    int frames = DEFAULT_BENCHMARK_FRAMES;
+    std::string selected = "";
+    std::string outputPath = "";
+
+    for (int i = 1; i < argc; i++) {
+        std::string token = argv[i];
+
+        if (token.find("--frames") != std::string::npos) {
+            frames = (i + 1 < argc) ? atoi(argv[++i]) : 0;
+            if (frames <= 0) {
+                fprintf(stderr, "invalid frame count passed.\n");
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        if (token.find("--workload") != std::string::npos) {
+            selected = (i + 1 < argc) ? argv[++i] : "";
+            continue;
+        }
+
+        if (token.find("--output") != std::string::npos) {
+            outputPath = (i + 1 < argc) ? argv[++i] : "";
+            continue;
+        }
+
+        fprintf(stderr, "invalid option passed.\n");
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    FILE* output = stdout;
+    if (!outputPath.empty()) {
+        output = fopen(outputPath.c_str(), "w");
+        if (output == NULL) {
+            fprintf(stderr, "error opening %s: %s\n", outputPath.c_str(), strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    fprintf(output, "{\n");
+    fprintf(output, "  \"frames\": %d,\n", frames);
+    fprintf(output, "  \"workloads\": [");
+
+    bool first = true;
+    for (const Workload& workload : workloads) {
+        if (!selected.empty() && selected != workload.name)
+            continue;
+
+        BenchmarkResult result = benchmark(workload, frames);
+        double framesPerSecond = frames / result.seconds;
+        double megahertz = result.cycles / result.seconds / 1e6;
+        double nsPerInstruction = (result.seconds * 1e9) / result.instructions;
+        double otherShare = 1.0 - result.cpuShare - result.memoryShare - result.ppuShare - result.apuShare;
+
+        fprintf(stderr, "%-8s %9.1f frames/s %8.1f MHz %7.2f ns/instruction  cpu %4.1f%% memory %4.1f%% ppu %4.1f%% apu %4.1f%%\n",
+            workload.name, framesPerSecond, megahertz, nsPerInstruction,
+            result.cpuShare * 100, result.memoryShare * 100, result.ppuShare * 100, result.apuShare * 100);
+
+        fprintf(output, "%s\n    {\n", first ? "" : ",");
+        fprintf(output, "      \"name\": \"%s\",\n", workload.name);
+        fprintf(output, "      \"description\": \"%s\",\n", workload.description);
+        fprintf(output, "      \"seconds\": %.6f,\n", result.seconds);
+        fprintf(output, "      \"cycles\": %" PRIu64 ",\n", result.cycles);
+        fprintf(output, "      \"instructions\": %" PRIu64 ",\n", result.instructions);
+        fprintf(output, "      \"frames_per_second\": %.2f,\n", framesPerSecond);
+        fprintf(output, "      \"emulated_mhz\": %.3f,\n", megahertz);
+        fprintf(output, "      \"ns_per_instruction\": %.3f,\n", nsPerInstruction);
+        fprintf(output, "      \"breakdown\": {\n");
+        fprintf(output, "        \"cpu\": %.4f,\n", result.cpuShare);
+        fprintf(output, "        \"memory\": %.4f,\n", result.memoryShare);
+        fprintf(output, "        \"ppu\": %.4f,\n", result.ppuShare);
+        fprintf(output, "        \"apu\": %.4f,\n", result.apuShare);
+        fprintf(output, "        \"other\": %.4f\n", otherShare);
+        fprintf(output, "      }\n");
+        fprintf(output, "    }");
+        first = false;
+    }
+
+    fprintf(output, "\n  ]\n}\n");
+
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    if (first) {
+        fprintf(stderr, "unknown workload %s.\n", selected.c_str());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "Gameboy.hpp"
+
+// fuugb-test: runs test roms (such as Blargg's) headless and as fast as
+// possible, and reports whether they passed based on what they print
+// through the serial port.
+
+// Cycles a rom gets to report its result: two minutes of emulated time,
+// well above what any of cpu_instrs' roms need.
+#define DEFAULT_CYCLE_BUDGET (120ULL * CPU_FREQUENCY_HZ)
+
+struct TestResult {
+    bool passed;
+    bool finished;
+    uint64_t cycles;
+    double seconds;
+    std::string output;
+};
+
+void printUsage() {
+    fprintf(stdout, "fuugb-test\n");
+    fprintf(stdout, "Usage:\n");
+    fprintf(stdout, "\tfuugb-test [OPTIONS] <rom path>...\n");
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "\t--cycles <cycles>\tCycles each rom is given to pass or fail (default 2 emulated minutes).\n");
+}
+
+TestResult runTest(uBYTE* romData, uint64_t cycleBudget) {
+    TestResult result = TestResult();
+
+    Gameboy gameboy(romData);
+    gameboy.SetSerialHook([&result](uBYTE data) {
+        result.output += (char)data;
+    });
+    gameboy.SkipBootRom();
+
+    auto start = std::chrono::steady_clock::now();
+    size_t checkedLength = 0;
+
+    while (!result.finished && gameboy.GetCycleCount() < cycleBudget) {
+        gameboy.RunFrames(1);
+
+        // Only the output received since the last frame needs to be looked at,
+        // along with enough of what came before to catch a word split in two.
+        if (result.output.size() != checkedLength) {
+            size_t from = (checkedLength > 6) ? checkedLength - 6 : 0;
+            if (result.output.find("Passed", from) != std::string::npos) {
+                result.passed = true;
+                result.finished = true;
+            }
+            else if (result.output.find("Failed", from) != std::string::npos) {
+                result.finished = true;
+            }
+            checkedLength = result.output.size();
+        }
+    }
+
+    result.cycles = gameboy.GetCycleCount();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+int main(int argc, char** argv) {
+    uint64_t cycleBudget = DEFAULT_CYCLE_BUDGET;
+    std::vector<std::string> romPaths;
+
+    for (int i = 1; i < argc; i++) {
+        std::string token = argv[i];
+
+        if (token.find("--cycles") != std::string::npos) {
+            cycleBudget = (i + 1 < argc) ? strtoull(argv[++i], NULL, 10) : 0;
+            if (cycleBudget == 0) {
+                fprintf(stderr, "invalid cycle budget passed.\n");
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        if (token.find("--") != std::string::npos) {
+            fprintf(stderr, "invalid option passed.\n");
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        romPaths.push_back(token);
+    }
+
+    if (romPaths.empty()) {
+        fprintf(stderr, "missing arguments\n");
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    uBYTE* romData = new uBYTE[MAX_CART_SIZE];
+    int passedCount = 0;
+    uint64_t totalCycles = 0;
+    double totalSeconds = 0.0;
+
+    for (std::string& romPath : romPaths) {
+        std::fstream romFile(romPath, std::ios::in | std::ios::binary);
+        if (!romFile.good()) {
+            fprintf(stderr, "error reading rom file %s: %s\n", romPath.c_str(), strerror(errno));
+            delete[] romData;
+            return EXIT_FAILURE;
+        }
+
+        memset(romData, 0x00, MAX_CART_SIZE);
+        romFile.read((char*)romData, MAX_CART_SIZE);
+
+        TestResult result = runTest(romData, cycleBudget);
+        totalCycles += result.cycles;
+        totalSeconds += result.seconds;
+
+        const char* status = result.passed ? "PASS" : (result.finished ? "FAIL" : "TIMEOUT");
+        fprintf(stdout, "%-7s %s (%.2f s emulated, %.1f MHz)\n",
+            status,
+            romPath.c_str(),
+            (double)result.cycles / CPU_FREQUENCY_HZ,
+            result.cycles / result.seconds / 1e6);
+
+        if (result.passed) {
+            passedCount++;
+        }
+        else if (!result.output.empty()) {
+            fprintf(stdout, "%s\n", result.output.c_str());
+        }
+    }
+
+    fprintf(stdout, "%d/%zu passed, %.1f MHz overall\n", passedCount, romPaths.size(), totalCycles / totalSeconds / 1e6);
+
+    delete[] romData;
+    return (passedCount == (int)romPaths.size()) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string>
+
+#include "InstructionTrace.hpp"
+
+// fuugb-tracedump: prints the instruction traces written with
+// --instruction-trace as text, one instruction per line.
+
+void printUsage() {
+    fprintf(stdout, "fuugb-tracedump\n");
+    fprintf(stdout, "Usage:\n");
+    fprintf(stdout, "\tfuugb-tracedump [OPTIONS] <trace path>\n");
+    fprintf(stdout, "Options:\n");
+    fprintf(stdout, "\t--skip <records>\tRecords left out from the start of the trace (default 0).\n");
+    fprintf(stdout, "\t--count <records>\tRecords printed at most (default all).\n");
+}
+
+int main(int argc, char** argv) {
+    uint64_t skip = 0;
+    uint64_t count = UINT64_MAX;
+    std::string tracePath = "";
+
+    for (int i = 1; i < argc; i++) {
+        std::string token = argv[i];
+
+        if (token.find("--skip") != std::string::npos) {
+            skip = (i + 1 < argc) ? strtoull(argv[++i], NULL, 10) : 0;
+            continue;
+        }
+
+        if (token.find("--count") != std::string::npos) {
+            count = (i + 1 < argc) ? strtoull(argv[++i], NULL, 10) : 0;
+            if (count == 0) {
+                fprintf(stderr, "invalid record count passed.\n");
+                printUsage();
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+
+        if (token.find("--") != std::string::npos) {
+            fprintf(stderr, "invalid option passed.\n");
+            printUsage();
+            return EXIT_FAILURE;
+        }
+
+        tracePath = token;
+    }
+
+    if (tracePath.empty()) {
+        fprintf(stderr, "missing arguments\n");
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    InstructionTraceReader reader;
+    if (!reader.Open(tracePath)) {
+        fprintf(stderr, "error reading trace file %s: %s\n", tracePath.c_str(),
+            errno != 0 ? strerror(errno) : "not an instruction trace");
+        return EXIT_FAILURE;
+    }
+
+    // Registers come first, in the order gameboy-doctor logs them, so
+    // that the lines can be compared with its logs once cut down.
+    InstructionRecord record;
+    for (uint64_t index = 0; index < skip + count && reader.Next(record); index++) {
+        if (index < skip)
+            continue;
+
+        fprintf(stdout, "A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X BANK:%02X OP:%02X CYC:%" PRIu64 "\n",
+            record.af >> 8, record.af & 0xFF, record.bc >> 8, record.bc & 0xFF,
+            record.de >> 8, record.de & 0xFF, record.hl >> 8, record.hl & 0xFF,
+            record.sp, record.pc, record.bank, record.opcode, reader.GetCycle());
+    }
+
+    return EXIT_SUCCESS;
+}